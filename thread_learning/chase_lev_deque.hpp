@@ -0,0 +1,110 @@
+#ifndef CHASE_LEV_DEQUE_HPP
+#define CHASE_LEV_DEQUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// ===================== Chase-Lev 工作窃取双端队列 =====================
+// 按 Lê 等人 "Correct and Efficient Work-Stealing for Weak Memory Models"（PPoPP'13）里的 C11 版本实现：
+// 1) 只有所属线程调用 push / pop，在底部（bottom）进出，后进先出：刚产生的任务趁缓存还热先执行
+// 2) 别的线程调用 steal，从顶部（top）拿最老的任务；只有剩最后一个元素时 pop 和 steal 才用 CAS 抢
+// 3) 环形数组满了换一个两倍大的：旧数组可能还有小偷在读，留到析构时一起释放（只增不减，总量不超过最终大小的 2 倍）
+// 槽位按 release 写、acquire 读（论文里是 relaxed；x86 上都是普通 mov），任务对象的发布不单靠栅栏，TSan 也认得
+// 元素类型 T 要能无锁地放进 std::atomic（这里存任务指针），空队列 / 抢失败返回 T{}
+template<typename T>
+class ChaseLevDeque {
+public:
+    explicit ChaseLevDeque(size_t capacity = 256) {
+        size_t cap = 1;
+        while (cap < capacity) cap <<= 1;
+        m_arrays.emplace_back(new Array(cap));
+        m_array.store(m_arrays.back().get(), std::memory_order_relaxed);
+    }
+
+    ChaseLevDeque(const ChaseLevDeque&) = delete;
+    ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+
+    // 只能由所属线程调用
+    void push(T x) {
+        int64_t b = m_bottom.load(std::memory_order_relaxed);
+        int64_t t = m_top.load(std::memory_order_acquire);
+        Array* a = m_array.load(std::memory_order_relaxed);
+        if (b - t > static_cast<int64_t>(a->mask)) a = grow(a, t, b);
+        a->put(b, x);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // 只能由所属线程调用
+    T pop() {
+        int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+        Array* a = m_array.load(std::memory_order_relaxed);
+        m_bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = m_top.load(std::memory_order_relaxed);
+        if (t > b) {
+            m_bottom.store(b + 1, std::memory_order_relaxed); // 本来就是空的
+            return T{};
+        }
+        T x = a->get(b);
+        if (t == b) {
+            // 最后一个元素：和小偷抢 top
+            if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                x = T{};
+            }
+            m_bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return x;
+    }
+
+    // 任意线程调用；空队列或者和别人抢输了都返回 T{}
+    T steal() {
+        int64_t t = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = m_bottom.load(std::memory_order_acquire);
+        if (t >= b) return T{};
+        Array* a = m_array.load(std::memory_order_acquire);
+        T x = a->get(t);
+        if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return T{};
+        }
+        return x;
+    }
+
+    // 近似长度（并发时只能当提示用）
+    size_t sizeApprox() const {
+        int64_t b = m_bottom.load(std::memory_order_relaxed);
+        int64_t t = m_top.load(std::memory_order_relaxed);
+        return b > t ? static_cast<size_t>(b - t) : 0;
+    }
+    bool emptyApprox() const { return sizeApprox() == 0; }
+
+private:
+    struct Array {
+        size_t mask;
+        std::unique_ptr<std::atomic<T>[]> slots;
+        explicit Array(size_t cap) : mask(cap - 1), slots(new std::atomic<T>[cap]) {}
+        T get(int64_t i) const { return slots[static_cast<size_t>(i) & mask].load(std::memory_order_acquire); }
+        void put(int64_t i, T x) { slots[static_cast<size_t>(i) & mask].store(x, std::memory_order_release); }
+    };
+
+    // 只在所属线程 push 时调用：[t, b) 拷进两倍大的新数组
+    Array* grow(Array* a, int64_t t, int64_t b) {
+        m_arrays.emplace_back(new Array((a->mask + 1) * 2));
+        Array* bigger = m_arrays.back().get();
+        for (int64_t i = t; i < b; ++i) bigger->put(i, a->get(i));
+        m_array.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+    // top 和 bottom 分在不同的缓存行：小偷改 top 不会让所属线程的 bottom 失效
+    alignas(64) std::atomic<int64_t> m_top{0};
+    alignas(64) std::atomic<int64_t> m_bottom{0};
+    alignas(64) std::atomic<Array*> m_array{nullptr};
+    std::vector<std::unique_ptr<Array>> m_arrays; // 用过的所有数组（只有所属线程改）
+};
+
+#endif // CHASE_LEV_DEQUE_HPP
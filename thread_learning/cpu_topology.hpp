@@ -0,0 +1,143 @@
+#ifndef CPU_TOPOLOGY_HPP
+#define CPU_TOPOLOGY_HPP
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+
+// ===================== CPU / NUMA 拓扑 =====================
+// 不依赖 libnuma：NUMA 节点和它们的 CPU 从 /sys/devices/system/node/node*/cpulist 读，
+// 再和进程当前允许的 CPU（sched_getaffinity，taskset / cgroup cpuset 的限制）取交集。
+// 没有 /sys 的 node 目录（容器、非 NUMA 内核）时当成一个节点。
+// 另外放几个线程工具：绑核（pthread_setaffinity_np）、起名字（pthread_setname_np，top -H / perf / gdb 里看得到）
+class CpuTopology {
+public:
+    // 节点下标 -> 这个节点上允许用的 CPU（升序）；只保留至少有一个 CPU 的节点
+    std::vector<std::vector<int>> nodes;
+
+    size_t cpuCount() const {
+        size_t n = 0;
+        for (const auto& cpus : nodes) n += cpus.size();
+        return n;
+    }
+    // 所有 CPU，按节点排好（同一节点的挨在一起）
+    std::vector<int> allCpus() const {
+        std::vector<int> out;
+        for (const auto& cpus : nodes) out.insert(out.end(), cpus.begin(), cpus.end());
+        return out;
+    }
+    // CPU 所在的节点下标；不认识的 CPU 返回 0
+    size_t nodeOf(int cpu) const {
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            if (std::binary_search(nodes[i].begin(), nodes[i].end(), cpu)) return i;
+        }
+        return 0;
+    }
+    // 调用线程当前在哪个节点上跑
+    size_t currentNode() const {
+        if (nodes.size() <= 1) return 0;
+        int cpu = sched_getcpu();
+        return cpu < 0 ? 0 : nodeOf(cpu);
+    }
+
+    // only 非空时只看这些 CPU（再和进程允许的取交集）；交集为空时当成没给，用进程允许的全部 CPU。
+    // 所以返回的 nodes 至少有一个节点、一个 CPU
+    static CpuTopology detect(const std::vector<int>& only = {}) {
+        std::vector<int> allowed = allowedCpus();
+        if (!only.empty()) {
+            std::vector<int> want(only);
+            std::sort(want.begin(), want.end());
+            std::vector<int> both;
+            std::set_intersection(allowed.begin(), allowed.end(), want.begin(), want.end(), std::back_inserter(both));
+            if (!both.empty()) allowed.swap(both);
+        }
+
+        CpuTopology topo;
+        std::vector<int> seen;
+        for (int node : parseCpuList(readLine("/sys/devices/system/node/online"))) { // 节点编号也是 "0-1" 这种格式
+            std::vector<int> cpus;
+            for (int cpu : parseCpuList(readLine("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"))) {
+                if (std::binary_search(allowed.begin(), allowed.end(), cpu)) cpus.push_back(cpu);
+            }
+            if (cpus.empty()) continue;
+            seen.insert(seen.end(), cpus.begin(), cpus.end());
+            topo.nodes.push_back(std::move(cpus));
+        }
+        // 读不到 node 目录，或者有 CPU 不属于任何节点：剩下的归到一个节点里
+        std::sort(seen.begin(), seen.end());
+        std::vector<int> rest;
+        std::set_difference(allowed.begin(), allowed.end(), seen.begin(), seen.end(), std::back_inserter(rest));
+        if (!rest.empty()) {
+            if (topo.nodes.empty()) topo.nodes.push_back(std::move(rest));
+            else topo.nodes.front().insert(topo.nodes.front().end(), rest.begin(), rest.end());
+            std::sort(topo.nodes.front().begin(), topo.nodes.front().end());
+        }
+        return topo;
+    }
+
+    // "0-3,8,10-11" -> {0,1,2,3,8,10,11}
+    static std::vector<int> parseCpuList(const std::string& s) {
+        std::vector<int> out;
+        size_t i = 0;
+        while (i < s.size()) {
+            size_t end = s.find(',', i);
+            if (end == std::string::npos) end = s.size();
+            std::string part = s.substr(i, end - i);
+            size_t dash = part.find('-');
+            if (!part.empty() && part.find_first_not_of("0123456789- \n") == std::string::npos) {
+                int lo = std::atoi(part.c_str());
+                int hi = dash == std::string::npos ? lo : std::atoi(part.c_str() + dash + 1);
+                for (int c = lo; c <= hi; ++c) out.push_back(c);
+            }
+            i = end + 1;
+        }
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+        return out;
+    }
+
+    // 进程当前允许运行的 CPU（升序）
+    static std::vector<int> allowedCpus() {
+        std::vector<int> out;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (int c = 0; c < CPU_SETSIZE; ++c) {
+                if (CPU_ISSET(c, &set)) out.push_back(c);
+            }
+        }
+        if (out.empty()) out.push_back(0);
+        return out;
+    }
+
+    // 把调用线程限制在 cpus 上；失败（比如 CPU 不在 cpuset 里）返回 false，线程照常运行
+    static bool pinCurrentThread(const std::vector<int>& cpus) {
+        if (cpus.empty()) return false;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int c : cpus) {
+            if (c >= 0 && c < CPU_SETSIZE) CPU_SET(c, &set);
+        }
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    }
+
+    // Linux 线程名最多 15 个字符，超出的截掉
+    static void nameCurrentThread(const std::string& name) {
+        pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+    }
+
+private:
+    static std::string readLine(const std::string& path) {
+        std::ifstream in(path);
+        std::string line;
+        if (in) std::getline(in, line);
+        return line;
+    }
+};
+
+#endif // CPU_TOPOLOGY_HPP
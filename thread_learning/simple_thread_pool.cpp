@@ -1,55 +1,375 @@
 #include "simple_thread_pool.hpp"
+#include <algorithm>
 
-// [MOD] getInstance：给 threadNum 做 fallback，避免 0 线程
-SimpleThreadPool& SimpleThreadPool::getInstance(size_t threadNum) {
-    if (threadNum == 0) {
-        threadNum = std::thread::hardware_concurrency();//hardware_concurrency获取线程（核心数）
-        if (threadNum == 0) threadNum = 4; // fallback
-    }
-    static SimpleThreadPool instance(threadNum);
+thread_local SimpleThreadPool::Worker* SimpleThreadPool::t_worker = nullptr;
+
+// 自旋等待时的 CPU 提示：让出流水线给同核的超线程，也降低功耗
+static inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+static SimpleThreadPool::Options makeOptions(size_t threadNum, SimpleThreadPool::Mode mode) {
+    SimpleThreadPool::Options opts;
+    opts.threads = threadNum;
+    opts.mode = mode;
+    return opts;
+}
+
+// [MOD] getInstance：给 threadNum 做 fallback，避免 0 线程（fallback 在构造函数里）
+SimpleThreadPool& SimpleThreadPool::getInstance(size_t threadNum, Mode mode) {
+    return getInstance(makeOptions(threadNum, mode));
+}
+
+SimpleThreadPool& SimpleThreadPool::getInstance(const Options& opts) {
+    static SimpleThreadPool instance(opts);
     return instance;
 }
 
-SimpleThreadPool::SimpleThreadPool(size_t threadNum)
-    : m_stop(false) {
+SimpleThreadPool::SimpleThreadPool(size_t threadNum, Mode mode)
+    : SimpleThreadPool(makeOptions(threadNum, mode)) {}
+
+SimpleThreadPool::SimpleThreadPool(const Options& opts)
+    : m_tasks(opts.lane_weights), m_stop(false), m_mode(opts.mode) {
+    // 先定每个 worker 绑在哪些 CPU 上、属于哪个节点
+    size_t threadNum = opts.threads;
+    size_t nodeCount = 1;
+    std::vector<std::vector<int>> cpusOf;
+    std::vector<size_t> nodeOf;
+    if (opts.affinity == Affinity::None) {
+        if (threadNum == 0) {
+            threadNum = std::thread::hardware_concurrency();//hardware_concurrency获取线程（核心数）
+            if (threadNum == 0) threadNum = 4; // fallback
+        }
+        cpusOf.resize(threadNum);
+        nodeOf.assign(threadNum, 0);
+    } else {
+        m_topology = CpuTopology::detect(opts.cpus);
+        if (threadNum == 0) threadNum = m_topology.cpuCount();
+        nodeCount = m_topology.nodes.size();
+        std::vector<int> all = m_topology.allCpus();
+        for (size_t i = 0; i < threadNum; ++i) {
+            if (opts.affinity == Affinity::Core) {
+                int cpu = all[i % all.size()];
+                cpusOf.push_back({cpu});
+                nodeOf.push_back(m_topology.nodeOf(cpu));
+            } else {
+                size_t node = i * nodeCount / threadNum;
+                cpusOf.push_back(m_topology.nodes[node]);
+                nodeOf.push_back(node);
+            }
+        }
+    }
     m_workers.reserve(threadNum);
 
+    if (m_mode == Mode::WorkStealing) {
+        for (size_t i = 0; i < nodeCount; ++i) m_nodes.emplace_back(std::make_unique<NodeQueue>(opts.lane_weights));
+        m_queues.resize(threadNum);
+    }
     for (size_t i = 0; i < threadNum; ++i) {
-        m_workers.emplace_back([this]() {
-            while (true) {
-                std::function<void()> task;
+        m_workers.emplace_back([this, i, cpus = std::move(cpusOf[i]), node = nodeOf[i],
+                                name = opts.name + "-" + std::to_string(i)]() {
+            CpuTopology::nameCurrentThread(name);
+            if (!cpus.empty()) CpuTopology::pinCurrentThread(cpus);
+            if (m_mode == Mode::Shared) {
+                sharedLoop();
+                return;
+            }
+            // 绑好核再分配自己的队列，内存按 first-touch 落在本节点
+            auto w = std::make_unique<Worker>();
+            w->pool = this;
+            w->node = node;
+            w->rng = 0x9e3779b97f4a7c15ull * (i + 1);
+            Worker& self = *w;
+            {
+                std::unique_lock<std::mutex> lock(m_start_mtx);
+                m_queues[i] = std::move(w);
+                ++m_ready;
+                m_start_cv.notify_all();
+                m_start_cv.wait(lock, [this]() { return m_ready == m_queues.size(); }); // 别人的队列都建好了才能去偷
+            }
+            stealingLoop(self);
+        });
+    }
+    if (m_mode == Mode::WorkStealing) {
+        std::unique_lock<std::mutex> lock(m_start_mtx);
+        m_start_cv.wait(lock, [this]() { return m_ready == m_queues.size(); });
+    }
+}
+
+void SimpleThreadPool::sharedLoop() {
+    while (true) {
+        Task task;
 
-                {
-                    std::unique_lock<std::mutex> lock(m_mtx);
-                    m_cv.wait(lock, [this]() {
-                        return m_stop || !m_tasks.empty();
-                    });
+        {
+            std::unique_lock<std::mutex> lock(m_mtx);
+            m_cv.wait(lock, [this]() {
+                return m_stop || !m_tasks.empty();
+            });
 
-                    if (m_stop && m_tasks.empty()) {
-                        return;
-                    }
+            if (m_stop && m_tasks.empty()) {
+                return;
+            }
+
+            uint64_t now = 0;
+            task = m_tasks.pop(now);
+        }
 
-                    task = std::move(m_tasks.front());
-                    m_tasks.pop();
-                }
+        task();
+    }
+}
 
-                task();
+void SimpleThreadPool::enqueue(Task task, Lane lane, bool local, const char* stopped_msg) {
+    if (m_mode == Mode::Shared) {
+        uint64_t stamp = LaneQueues::stamp();
+        {
+            std::unique_lock<std::mutex> lock(m_mtx);
+            if (m_stop) {
+                throw std::runtime_error(stopped_msg);
             }
-        });
+            m_tasks.push(lane, std::move(task), stamp);
+        }
+        m_cv.notify_one();
+        return;
+    }
+
+    Worker* w = t_worker;
+    if (local && w && w->pool == this) {
+        // worker 自己派生的任务：进自己的队列，不碰任何锁（停止后它退出前会自己把队列清空）
+        if (m_stop.load(std::memory_order_acquire)) {
+            throw std::runtime_error(stopped_msg);
+        }
+        w->deque.push(newNode(std::move(task)));
+    } else {
+        // 检查 m_stop 和入队在同一把锁里：析构也拿着这把锁置位，不会有任务在 worker 都退出以后才进队
+        uint64_t stamp = LaneQueues::stamp();
+        NodeQueue& q = submitQueue();
+        std::lock_guard<std::mutex> lock(q.mtx);
+        if (m_stop) {
+            throw std::runtime_error(stopped_msg);
+        }
+        q.tasks.push(lane, std::move(task), stamp);
+        q.size.store(q.tasks.size(), std::memory_order_relaxed);
     }
+    notifyWork();
+}
+
+// ===================== WorkStealing =====================
+// 任务节点的每线程空闲链表：节点大多在同一个 worker 上取出、执行、归还（自己派生的任务、从注入队列搬来的任务），
+// 被偷走的进小偷的链表。每线程最多留 kMaxFree 个，多的还给系统
+namespace {
+class NodePool {
+public:
+    static constexpr size_t kMaxFree = 1024;
+    ~NodePool() {
+        for (SmallTask* n : m_free) ::operator delete(n);
+        dead() = true;
+    }
+    SmallTask* get() {
+        if (m_free.empty()) return static_cast<SmallTask*>(::operator new(sizeof(SmallTask)));
+        SmallTask* n = m_free.back();
+        m_free.pop_back();
+        return n;
+    }
+    void put(SmallTask* n) {
+        if (m_free.size() < kMaxFree) m_free.push_back(n);
+        else ::operator delete(n);
+    }
+    // 线程退出时池可能先于别的 thread_local 析构：之后再还的节点直接释放
+    static bool& dead() {
+        thread_local bool d = false;
+        return d;
+    }
+    static NodePool& local() {
+        thread_local NodePool pool;
+        return pool;
+    }
+
+private:
+    std::vector<SmallTask*> m_free;
+};
+} // namespace
+
+SimpleThreadPool::Task* SimpleThreadPool::newNode(Task&& task) {
+    void* mem = NodePool::dead() ? ::operator new(sizeof(Task)) : NodePool::local().get();
+    return ::new (mem) Task(std::move(task));
+}
+
+void SimpleThreadPool::freeNode(Task* node) {
+    node->~Task();
+    if (NodePool::dead()) ::operator delete(node);
+    else NodePool::local().put(node);
+}
+
+void SimpleThreadPool::stealingLoop(Worker& w) {
+    t_worker = &w;
+    while (true) {
+        Task* t = findTask(w);
+        if (!t) {
+            // 先自旋：任务间隔很短时省掉一次 futex 睡眠 + 唤醒
+            m_searching.fetch_add(1, std::memory_order_seq_cst);
+            uint64_t epoch = 0;
+            for (int i = 0; i < kSpinRounds && !t; ++i) {
+                epoch = m_epoch.load(std::memory_order_seq_cst);
+                t = findTask(w);
+                if (t) break;
+                if (i < kSpinRounds / 2) cpuRelax();
+                else std::this_thread::yield();
+            }
+            bool last = m_searching.fetch_sub(1, std::memory_order_seq_cst) == 1;
+            if (!t && m_stop.load(std::memory_order_acquire)) {
+                // 停止前提交的任务一定看得见了：再找一遍，真空了才退出
+                t = findTask(w);
+                if (!t) return;
+            }
+            if (!t) {
+                park(epoch);
+                continue;
+            }
+            // 最后一个找活的找到了：如果还有剩的，叫醒下一个接着干（每次提交只叫醒一个，靠这里接力）
+            if (last && hasVisibleWork()) notifyWork();
+        }
+        (*t)();
+        freeNode(t);
+    }
+}
+
+SimpleThreadPool::Task* SimpleThreadPool::findTask(Worker& w) {
+    if (Task* t = w.deque.pop()) return t;
+    if (Task* t = takeInjected(w)) return t;
+    if (Task* t = stealFrom(w, true)) return t;
+    if (m_nodes.size() > 1) return stealFrom(w, false);
+    return nullptr;
+}
+
+// 从随机位置开始挨个偷，避免所有空闲 worker 都盯着同一个队列；local 为 true 只偷本节点的，否则只偷别的节点的
+SimpleThreadPool::Task* SimpleThreadPool::stealFrom(Worker& w, bool local) {
+    size_t n = m_queues.size();
+    w.rng ^= w.rng << 13;
+    w.rng ^= w.rng >> 7;
+    w.rng ^= w.rng << 17;
+    size_t start = static_cast<size_t>(w.rng % n);
+    for (size_t i = 0; i < n; ++i) {
+        Worker& victim = *m_queues[(start + i) % n];
+        if (&victim == &w || (victim.node == w.node) != local) continue;
+        if (Task* t = victim.deque.steal()) return t;
+    }
+    return nullptr;
+}
+
+// 先取本节点的注入队列，空了再看别的节点的
+SimpleThreadPool::Task* SimpleThreadPool::takeInjected(Worker& w) {
+    if (Task* t = takeInjectedFrom(w, *m_nodes[w.node])) return t;
+    for (size_t i = 1; i < m_nodes.size(); ++i) {
+        if (Task* t = takeInjectedFrom(w, *m_nodes[(w.node + i) % m_nodes.size()])) return t;
+    }
+    return nullptr;
+}
+
+// 从注入队列成批搬：按权重选一条通道，第一个直接执行，剩下的进自己的队列（别的 worker 可以再从这里偷）
+SimpleThreadPool::Task* SimpleThreadPool::takeInjectedFrom(Worker& w, NodeQueue& q) {
+    if (q.size.load(std::memory_order_relaxed) == 0) return nullptr;
+    Task* first = nullptr;
+    size_t moved = 0;
+    uint64_t now = 0;
+    {
+        std::lock_guard<std::mutex> lock(q.mtx);
+        if (q.tasks.empty()) return nullptr;
+        size_t lane = q.tasks.pick();
+        // 按 worker 数均分（至少 1 个），留一些给别的 worker 直接取；Batch 一次一个
+        size_t avail = q.tasks.size(lane);
+        size_t take = lane == static_cast<size_t>(Lane::Batch)
+                          ? 1
+                          : std::min({kInjectBatch, avail, avail / m_queues.size() + 1});
+        first = newNode(q.tasks.pop(lane, now));
+        for (size_t i = 1; i < take; ++i) {
+            w.deque.push(newNode(q.tasks.pop(lane, now)));
+            ++moved;
+        }
+        q.size.store(q.tasks.size(), std::memory_order_relaxed);
+    }
+    if (moved > 0) notifyWork(moved);
+    return first;
+}
+
+LaneStats SimpleThreadPool::laneStats(Lane lane) const {
+    LaneStats out;
+    size_t i = static_cast<size_t>(lane);
+    if (m_mode == Mode::Shared) {
+        m_tasks.addStats(i, out);
+    } else {
+        for (const auto& q : m_nodes) q->tasks.addStats(i, out);
+    }
+    out.expired = m_expired[i].load(std::memory_order_relaxed);
+    uint64_t ticks = laneTicks() - m_origin_ticks;
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - m_origin_time).count();
+    if (ticks > 0 && ns > 0) out.ns_per_tick = ns / static_cast<double>(ticks);
+    return out;
+}
+
+SimpleThreadPool::NodeQueue& SimpleThreadPool::submitQueue() {
+    if (m_nodes.size() == 1) return *m_nodes.front();
+    return *m_nodes[m_topology.currentNode() % m_nodes.size()];
+}
+
+bool SimpleThreadPool::hasVisibleWork() const {
+    for (const auto& q : m_nodes) {
+        if (q->size.load(std::memory_order_relaxed) > 0) return true;
+    }
+    for (const auto& q : m_queues) {
+        if (!q->deque.emptyApprox()) return true;
+    }
+    return false;
+}
+
+// 先 epoch+1（正准备休眠的 worker 会发现变了、回去再找一遍），再叫醒最多 n 个休眠的 worker：
+// 有 worker 在自旋找活就少叫一个，它休眠前同样会看到 epoch 变了
+void SimpleThreadPool::notifyWork(size_t n) {
+    m_epoch.fetch_add(1, std::memory_order_seq_cst);
+    if (m_searching.load(std::memory_order_seq_cst) > 0) --n;
+    if (n == 0) return;
+    size_t sleepers = static_cast<size_t>(m_sleepers.load(std::memory_order_seq_cst));
+    if (sleepers == 0) return;
+    {
+        std::lock_guard<std::mutex> lock(m_park_mtx); // 等正在登记的 worker 进入 wait，否则通知会落空
+    }
+    if (n >= sleepers) {
+        m_park_cv.notify_all();
+    } else {
+        for (size_t i = 0; i < n; ++i) m_park_cv.notify_one();
+    }
+}
+
+void SimpleThreadPool::park(uint64_t epoch) {
+    std::unique_lock<std::mutex> lock(m_park_mtx);
+    m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+    while (m_epoch.load(std::memory_order_seq_cst) == epoch && !m_stop.load(std::memory_order_acquire)) {
+        m_park_cv.wait(lock);
+    }
+    m_sleepers.fetch_sub(1, std::memory_order_seq_cst);
 }
 
 SimpleThreadPool::~SimpleThreadPool() {
     {
+        // 所有注入队列的锁一起拿着置位（顺序固定，不会和提交者死锁）
         std::unique_lock<std::mutex> lock(m_mtx);
+        std::vector<std::unique_lock<std::mutex>> node_locks;
+        for (auto& q : m_nodes) node_locks.emplace_back(q->mtx);
         m_stop = true;
     }
+    {
+        std::lock_guard<std::mutex> lock(m_park_mtx); // 正在登记休眠的 worker 要么看见 m_stop，要么已经在 wait 里
+    }
 
     m_cv.notify_all();
+    m_park_cv.notify_all();
 
     for (std::thread& worker : m_workers) {
         if (worker.joinable()) {
             worker.join();
         }
     }
-}
\ No newline at end of file
+}
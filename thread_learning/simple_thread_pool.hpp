@@ -2,7 +2,7 @@
 #define SIMPLE_THREAD_POOL_HPP
 
 #include <vector>
-#include <queue>
+#include <memory>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
@@ -11,49 +11,141 @@
 #include <atomic>
 #include <stdexcept>
 #include <type_traits>   // [MOD] invoke_result_t
+#include <string>
+#include <optional>
+#include <chrono>
+#include <tuple>
 #include <utility>
+#include "chase_lev_deque.hpp"
+#include "small_task.hpp"     // 小对象优化的任务类型 + 环形任务队列
+#include "task_future.hpp"    // 按需分配共享状态的 future / promise
+#include "cpu_topology.hpp"   // NUMA 节点 / 允许的 CPU、绑核、线程名
+#include "task_lanes.hpp"     // 优先级通道：按权重公平出队 + 每通道的排队时间直方图
 
 class SimpleThreadPool {
 public:
+    // ===================== 调度方式 =====================
+    // Shared      ：一个队列 + 一把锁 + 一个条件变量，每个任务 notify_one（原来的实现）
+    // WorkStealing：每个 worker 一个 Chase-Lev 双端队列，外部线程提交的任务进全局注入队列；
+    //               worker 先取自己的、再成批取注入队列、再随机偷别人的，都没有就先自旋一会儿再休眠。
+    //               有 worker 正在找活时提交不叫醒任何人；找到活的那个发现还有剩的，再叫醒下一个（接力唤醒）
+    enum class Mode { Shared, WorkStealing };
+
+    // ===================== 线程放置 =====================
+    // None：不绑核，交给内核调度（默认）
+    // Core：每个 worker 绑一个 CPU（worker 比 CPU 多时轮着绑）。CPU 按 NUMA 节点排序，编号相邻的 worker 在同一个节点上
+    // Node：worker 按编号连续分给各个 NUMA 节点，每个只限制在本节点的 CPU 集合里，节点内由内核调度
+    // Core / Node 下 WorkStealing 按节点分组：每个节点一个注入队列，外部线程提交到自己当前所在节点的队列；
+    // worker 先取本节点的注入队列、先偷本节点的 worker，都没有才跨节点。worker 绑好核以后才分配自己的队列，
+    // 按 first-touch 内存落在本节点；任务节点的空闲链表本来就是每线程的
+    enum class Affinity { None, Core, Node };
+
+    // ===================== 优先级通道 =====================
+    // 外部提交的任务按通道排队，出队按权重公平轮转（见 task_lanes.hpp）；不指定通道的进 Normal。
+    // WorkStealing 下 worker 派生的任务（不指定通道的 post / post_bulk / submit）照旧进自己的队列，
+    // 算作已经在跑的工作的延续；显式指定通道的总是进通道队列，才能和外面的任务比优先级。
+    // 从注入队列成批搬任务时 Batch 通道一次只搬一个：慢任务不会压在某个 worker 的本地队列里挡住后来的短任务
+    using Lane = TaskLane;
+    using Clock = std::chrono::steady_clock;
+
+    struct Options {
+        size_t threads = 0;                  // 0：None 时按 hardware_concurrency，Core / Node 时按可用的 CPU 数
+        Mode mode = Mode::Shared;
+        Affinity affinity = Affinity::None;
+        std::vector<int> cpus;               // 只用这些 CPU（还要和进程允许的取交集）；空、或者交集为空表示全部
+        std::string name = "pool";           // 线程名前缀：pool-0、pool-1……（top -H、perf、gdb 里按名字认线程）
+        LaneQueues::Weights lane_weights{16, 4, 1}; // Interactive / Normal / Batch 的出队权重（0 当 1）
+    };
+
     // [MOD] hardware_concurrency() 可能返回 0，所以做 fallback
-    static SimpleThreadPool& getInstance(size_t threadNum = 0);
+    // 进程共用的池：第一次调用时的参数决定线程数、调度方式和放置方式
+    static SimpleThreadPool& getInstance(size_t threadNum = 0, Mode mode = Mode::Shared);
+    static SimpleThreadPool& getInstance(const Options& opts);
+
+    // 单独建的池（基准对比用）；threadNum 为 0 同样按核心数
+    explicit SimpleThreadPool(size_t threadNum, Mode mode = Mode::Shared);
+    explicit SimpleThreadPool(const Options& opts);
 
     // ===================== 原 submit（保留：需要 future 的场景） =====================
+    // 参数按值存进任务（和原来的 std::bind 一样），调用时按左值传给 task。
+    // 原来是 std::bind + make_shared<packaged_task> + std::function，至少三次分配；
+    // 现在整个任务放进 SmallTask 的内部缓冲区，只有 TaskFuture 的共享状态分配一次
     template<typename Callable, typename... Arguments>
     auto submit(Callable&& task, Arguments&&... args) {
-        using TaskReturnType = std::invoke_result_t<Callable, Arguments...>;
-
-        auto packagedTask = std::make_shared<std::packaged_task<TaskReturnType()>>(
-            std::bind(std::forward<Callable>(task), std::forward<Arguments>(args)...)
-        );
-        auto resultFuture = packagedTask->get_future();
+        using TaskReturnType = std::invoke_result_t<std::decay_t<Callable>&, std::decay_t<Arguments>&...>;
 
-        {
-            std::unique_lock<std::mutex> lock(m_mtx);
-            if (m_stop) {
-                throw std::runtime_error("Cannot submit task to stopped thread pool");
-            }
-            m_tasks.emplace([packagedTask]() { (*packagedTask)(); });
-        }
-
-        m_cv.notify_one();
+        TaskPromise<TaskReturnType> promise;
+        TaskFuture<TaskReturnType> resultFuture = promise.get_future();
+        enqueue(SmallTask([promise = std::move(promise), fn = std::forward<Callable>(task),
+                           bound = std::make_tuple(std::forward<Arguments>(args)...)]() mutable {
+                    try {
+                        if constexpr (std::is_void_v<TaskReturnType>) {
+                            std::apply(fn, bound);
+                            promise.set_value();
+                        } else {
+                            promise.set_value(std::apply(fn, bound));
+                        }
+                    } catch (...) {
+                        promise.set_exception(std::current_exception());
+                    }
+                }),
+                Lane::Normal, true, "Cannot submit task to stopped thread pool");
         return resultFuture;
     }
 
     // ===================== [MOD] 新增：轻量 post（无 future，适合网络事件） =====================
     // 为什么：webserver 的任务一般不需要返回值，packaged_task/future 会带来额外分配和开销
+    // 任务放进 SmallTask：捕获不超过 64 字节的 lambda 不分配（std::function 超过 16 字节就上堆）
     template<typename F>
     void post(F&& f) {
-        {
-            std::unique_lock<std::mutex> lock(m_mtx);
-            if (m_stop) {
-                throw std::runtime_error("Cannot post task to stopped thread pool");
-            }
-            m_tasks.emplace(std::forward<F>(f)); // std::function<void()> 接住任务
-        }
-        m_cv.notify_one();
+        enqueue(SmallTask(std::forward<F>(f)), Lane::Normal, true, "Cannot post task to stopped thread pool");
+    }
+    // 指定通道
+    template<typename F>
+    void post(Lane lane, F&& f) {
+        enqueue(SmallTask(std::forward<F>(f)), lane, false, "Cannot post task to stopped thread pool");
+    }
+    // 带截止时间：轮到执行时已经过了 deadline 就不执行 f，改为执行 on_expired（比如回一个 503），
+    // 不传 on_expired 就直接丢掉。两个里没被选中的那个先析构，再执行选中的：
+    // 它们捕获的资源（连接引用之类）在选中的那个跑之前就已经放掉了
+    template<typename F, typename E>
+    void post(Lane lane, Clock::time_point deadline, F&& f, E&& on_expired) {
+        enqueue(SmallTask([this, lane, deadline, fn = std::optional<std::decay_t<F>>(std::forward<F>(f)),
+                           ex = std::optional<std::decay_t<E>>(std::forward<E>(on_expired))]() mutable {
+                    if (Clock::now() <= deadline) {
+                        ex.reset();
+                        (*fn)();
+                    } else {
+                        fn.reset();
+                        m_expired[static_cast<size_t>(lane)].fetch_add(1, std::memory_order_relaxed);
+                        (*ex)();
+                    }
+                }),
+                lane, false, "Cannot post task to stopped thread pool");
+    }
+    template<typename F>
+    void post(Lane lane, Clock::time_point deadline, F&& f) {
+        post(lane, deadline, std::forward<F>(f), [] {});
+    }
+
+    // 一次提交一批任务（元素是可调用对象的任意 range；传右值 range 时元素被移走）：
+    // Shared 模式只加一次锁、notify 一次；WorkStealing 模式一次进队，按任务数一次叫醒休眠的 worker
+    template<typename Range>
+    void post_bulk(Range&& tasks) {
+        postBulk(std::forward<Range>(tasks), Lane::Normal, true);
+    }
+    template<typename Range>
+    void post_bulk(Lane lane, Range&& tasks) {
+        postBulk(std::forward<Range>(tasks), lane, false);
     }
 
+    // 一条通道的计数和排队时间直方图（所有队列加起来；不加锁读，是近似值）
+    LaneStats laneStats(Lane lane) const;
+
+    Mode mode() const { return m_mode; }
+    size_t size() const { return m_workers.size(); }
+    size_t nodeCount() const { return m_nodes.empty() ? 1 : m_nodes.size(); }
+
     ~SimpleThreadPool();
 
     SimpleThreadPool(const SimpleThreadPool&) = delete;
@@ -62,13 +154,119 @@ public:
     SimpleThreadPool& operator=(SimpleThreadPool&&) = delete;
 
 private:
-    explicit SimpleThreadPool(size_t threadNum);
+    using Task = SmallTask;
+
+    // local：worker 线程上提交时可以直接进自己的队列（不指定通道的提交）
+    void enqueue(Task task, Lane lane, bool local, const char* stopped_msg);
+    void sharedLoop();
+
+    template<typename Range>
+    void postBulk(Range&& tasks, Lane lane, bool local) {
+        size_t n = 0;
+        if (m_mode == Mode::Shared) {
+            uint64_t stamp = LaneQueues::stamp();
+            {
+                std::unique_lock<std::mutex> lock(m_mtx);
+                if (m_stop) {
+                    throw std::runtime_error("Cannot post task to stopped thread pool");
+                }
+                for (auto& f : tasks) {
+                    m_tasks.push(lane, SmallTask(forwardElement<Range>(f)), stamp);
+                    ++n;
+                }
+            }
+            if (n == 1) m_cv.notify_one();
+            else if (n > 1) m_cv.notify_all();
+            return;
+        }
+
+        Worker* w = t_worker;
+        if (local && w && w->pool == this) {
+            if (m_stop.load(std::memory_order_acquire)) {
+                throw std::runtime_error("Cannot post task to stopped thread pool");
+            }
+            for (auto& f : tasks) {
+                w->deque.push(newNode(SmallTask(forwardElement<Range>(f))));
+                ++n;
+            }
+        } else {
+            uint64_t stamp = LaneQueues::stamp();
+            NodeQueue& q = submitQueue();
+            std::lock_guard<std::mutex> lock(q.mtx);
+            if (m_stop) {
+                throw std::runtime_error("Cannot post task to stopped thread pool");
+            }
+            for (auto& f : tasks) {
+                q.tasks.push(lane, SmallTask(forwardElement<Range>(f)), stamp);
+                ++n;
+            }
+            q.size.store(q.tasks.size(), std::memory_order_relaxed);
+        }
+        if (n > 0) notifyWork(n);
+    }
+
+    template<typename Range, typename T>
+    static decltype(auto) forwardElement(T& x) {
+        if constexpr (std::is_lvalue_reference_v<Range>) return x;
+        else return std::move(x);
+    }
 
     std::vector<std::thread> m_workers;
-    std::queue<std::function<void()>> m_tasks;
+    LaneQueues m_tasks;
     std::mutex m_mtx;
     std::condition_variable m_cv;
     std::atomic<bool> m_stop;
+    const Mode m_mode;
+    std::atomic<uint64_t> m_expired[kTaskLanes] = {}; // 过了截止时间没执行的任务数，按通道
+    // 排队时间按 laneTicks 记：读统计时用建池以来走过的 tick 数和纳秒数换算（跑得越久越准）
+    const uint64_t m_origin_ticks = laneTicks();
+    const Clock::time_point m_origin_time = Clock::now();
+
+    // ===================== WorkStealing =====================
+    struct Worker {
+        SimpleThreadPool* pool = nullptr;
+        ChaseLevDeque<Task*> deque;
+        size_t node = 0;                        // 所在的 NUMA 节点（m_nodes 的下标）
+        uint64_t rng = 0;                       // 选偷谁的 xorshift 状态
+    };
+    // 外部线程提交的任务：每个 NUMA 节点一个（不绑核时只有一个）
+    struct alignas(64) NodeQueue {
+        explicit NodeQueue(const LaneQueues::Weights& weights) : tasks(weights) {}
+        std::mutex mtx;
+        LaneQueues tasks;
+        std::atomic<size_t> size{0};
+    };
+    static constexpr int kSpinRounds = 64;      // 休眠前找几轮活（前一半 pause，后一半 yield 让出 CPU）
+    static constexpr size_t kInjectBatch = 32;  // 一次最多从注入队列搬几个到自己的队列
+
+    // ChaseLevDeque 里存指针：任务放进节点，节点从每线程的空闲链表里取、执行完还回执行线程的链表
+    static Task* newNode(Task&& task);
+    static void freeNode(Task* node);
+    void stealingLoop(Worker& w);
+    Task* findTask(Worker& w);
+    Task* takeInjected(Worker& w);
+    Task* takeInjectedFrom(Worker& w, NodeQueue& q);
+    Task* stealFrom(Worker& w, bool local);
+    NodeQueue& submitQueue();                    // 外部线程提交到哪个节点的队列
+    bool hasVisibleWork() const;
+    void notifyWork(size_t n = 1);               // 有 n 个新任务：叫醒最多 n 个休眠的 worker（有人在找活就少叫一个）
+    void park(uint64_t epoch);
+
+    static thread_local Worker* t_worker;        // 当前线程是哪个池的哪个 worker（外部线程为空）
+
+    std::vector<std::unique_ptr<Worker>> m_queues; // 下标 = worker 编号；由各个 worker 绑核以后自己分配
+    std::vector<std::unique_ptr<NodeQueue>> m_nodes;
+    CpuTopology m_topology;
+    std::mutex m_start_mtx;                       // 启动屏障：所有 worker 的队列都建好了才开始找活
+    std::condition_variable m_start_cv;
+    size_t m_ready = 0;
+    // 休眠协议：worker 先读 epoch 再找活，找不到就在锁里登记 sleepers、epoch 没变才睡；
+    // 提交者先放任务再 epoch+1、再看 sleepers。两边都是 seq_cst，至少有一边看得见对方，不会丢唤醒
+    std::atomic<uint64_t> m_epoch{0};
+    std::atomic<int> m_sleepers{0};
+    std::atomic<int> m_searching{0};             // 正在自旋找活的 worker 数
+    std::mutex m_park_mtx;
+    std::condition_variable m_park_cv;
 };
 
 #endif // SIMPLE_THREAD_POOL_HPP
\ No newline at end of file
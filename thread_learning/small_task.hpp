@@ -0,0 +1,144 @@
+#ifndef SMALL_TASK_HPP
+#define SMALL_TASK_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// ===================== 小对象优化的任务类型 =====================
+// std::function 要求可拷贝，捕获稍多一点（libstdc++ 超过 16 字节）就上堆。
+// SmallTask 只要求可移动：不超过 kInlineSize 字节、移动不抛异常的可调用对象直接放在内部缓冲区里，
+// 只有更大的才 new 一份、缓冲区里存指针。线程池里的典型 lambda（几个指针 / 引用计数句柄）从来不分配。
+// 调用、搬移、析构都通过一张按类型生成的静态函数表，没有虚函数也没有 RTTI
+class SmallTask {
+public:
+    static constexpr size_t kInlineSize = 64;
+
+    template<typename F>
+    static constexpr bool storedInline() {
+        return sizeof(F) <= kInlineSize && alignof(F) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible_v<F>;
+    }
+
+    SmallTask() noexcept = default;
+
+    template<typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, SmallTask>>>
+    SmallTask(F&& f) {
+        using Fn = std::decay_t<F>;
+        if constexpr (storedInline<Fn>()) {
+            ::new (static_cast<void*>(m_buf)) Fn(std::forward<F>(f));
+            m_ops = &kInlineOps<Fn>;
+        } else {
+            Fn* p = new Fn(std::forward<F>(f));
+            std::memcpy(m_buf, &p, sizeof(p));
+            m_ops = &kHeapOps<Fn>;
+        }
+    }
+
+    SmallTask(SmallTask&& o) noexcept { moveFrom(o); }
+    SmallTask& operator=(SmallTask&& o) noexcept {
+        if (this != &o) {
+            reset();
+            moveFrom(o);
+        }
+        return *this;
+    }
+    SmallTask(const SmallTask&) = delete;
+    SmallTask& operator=(const SmallTask&) = delete;
+    ~SmallTask() { reset(); }
+
+    void operator()() { m_ops->invoke(m_buf); }
+    explicit operator bool() const noexcept { return m_ops != nullptr; }
+
+    void reset() noexcept {
+        if (m_ops) {
+            m_ops->destroy(m_buf);
+            m_ops = nullptr;
+        }
+    }
+
+private:
+    struct Ops {
+        void (*invoke)(void*);
+        void (*relocate)(void* dst, void* src) noexcept; // 移动构造到 dst 并析构 src
+        void (*destroy)(void*) noexcept;
+    };
+
+    template<typename Fn>
+    static Fn* heapPtr(void* buf) {
+        Fn* p;
+        std::memcpy(&p, buf, sizeof(p));
+        return p;
+    }
+
+    template<typename Fn>
+    static constexpr Ops kInlineOps = {
+        [](void* p) { (*static_cast<Fn*>(p))(); },
+        [](void* dst, void* src) noexcept {
+            ::new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+            static_cast<Fn*>(src)->~Fn();
+        },
+        [](void* p) noexcept { static_cast<Fn*>(p)->~Fn(); },
+    };
+    template<typename Fn>
+    static constexpr Ops kHeapOps = {
+        [](void* p) { (*heapPtr<Fn>(p))(); },
+        [](void* dst, void* src) noexcept { std::memcpy(dst, src, sizeof(Fn*)); },
+        [](void* p) noexcept { delete heapPtr<Fn>(p); },
+    };
+
+    void moveFrom(SmallTask& o) noexcept {
+        m_ops = o.m_ops;
+        if (m_ops) {
+            m_ops->relocate(m_buf, o.m_buf);
+            o.m_ops = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char m_buf[kInlineSize];
+    const Ops* m_ops = nullptr;
+};
+
+// ===================== SmallTask 的环形队列 =====================
+// 代替 std::queue<std::function>（底下的 std::deque 每 512 字节一个节点，入队出队一直在分配释放）：
+// 一块 2 的幂大小的数组循环用，满了才翻倍，稳态下不分配。不加锁，由使用方保护。
+// 元素类型做成模板参数：优先级队列里每个任务还要带上入队时间（见 task_lanes.hpp）
+template<typename T>
+class RingQueue {
+public:
+    bool empty() const { return m_size == 0; }
+    size_t size() const { return m_size; }
+
+    void push(T&& t) {
+        if (m_size == m_ring.size()) grow();
+        m_ring[(m_head + m_size) & (m_ring.size() - 1)] = std::move(t);
+        ++m_size;
+    }
+    T pop() {
+        T t = std::move(m_ring[m_head]);
+        m_head = (m_head + 1) & (m_ring.size() - 1);
+        --m_size;
+        return t;
+    }
+
+private:
+    void grow() {
+        std::vector<T> bigger(m_ring.empty() ? 16 : m_ring.size() * 2);
+        for (size_t i = 0; i < m_size; ++i) {
+            bigger[i] = std::move(m_ring[(m_head + i) & (m_ring.size() - 1)]);
+        }
+        m_ring.swap(bigger);
+        m_head = 0;
+    }
+
+    std::vector<T> m_ring;
+    size_t m_head = 0;
+    size_t m_size = 0;
+};
+
+using TaskQueue = RingQueue<SmallTask>;
+
+#endif // SMALL_TASK_HPP
@@ -0,0 +1,159 @@
+// ===================== SmallTask / TaskFuture / post_bulk 检查 =====================
+// 不计时，只检查行为对不对，两种模式的池各跑一遍：
+//   future   ：submit 带参数的返回值、任务抛的异常在 get() 里重新抛出、get() 之后 valid() 变 false
+//   broken   ：promise 没设置结果就析构，future 拿到 std::future_errc::broken_promise
+//   oversize ：超过内部缓冲区的可调用对象（以及移动可能抛异常的）放到堆上，照样执行；
+//              每个对象恰好析构一次（内部缓冲区和堆上的都算）
+//   bulk     ：post_bulk 传左值 range 时拷贝元素、原来的还能用；传右值 range 时元素被移走，一次拷贝都没有
+// 有错打印出来并返回 1。建议带 -fsanitize=address 构建
+//
+// 用法：./task_check
+#include "simple_thread_pool.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+static int g_failures = 0;
+
+static void expect(bool cond, const char* mode, const char* what) {
+    if (!cond) {
+        std::fprintf(stderr, "[%s] check failed: %s\n", mode, what);
+        ++g_failures;
+    }
+}
+
+// 等计数到 n（池里的任务是异步的）
+static void waitFor(const std::atomic<int>& c, int n) {
+    while (c.load(std::memory_order_acquire) < n) std::this_thread::yield();
+}
+
+// 记录还活着多少个、被拷贝 / 移动了多少次
+struct Counted {
+    static std::atomic<int> live, copies, moves;
+    std::atomic<int>* ran;
+    explicit Counted(std::atomic<int>* r) : ran(r) { live.fetch_add(1); }
+    Counted(const Counted& o) : ran(o.ran) { live.fetch_add(1), copies.fetch_add(1); }
+    Counted(Counted&& o) noexcept : ran(o.ran) { live.fetch_add(1), moves.fetch_add(1); }
+    ~Counted() { live.fetch_sub(1); }
+    void operator()() { ran->fetch_add(1, std::memory_order_release); }
+    static void reset() { live = 0, copies = 0, moves = 0; }
+};
+std::atomic<int> Counted::live{0}, Counted::copies{0}, Counted::moves{0};
+
+static void checkFuture(SimpleThreadPool& pool, const char* mode) {
+    auto f = pool.submit([](int a, const std::string& s) { return s + std::to_string(a); }, 7, std::string("x"));
+    expect(f.get() == "x7", mode, "submit returns the task's result");
+    expect(!f.valid(), mode, "future is invalid after get()");
+
+    auto g = pool.submit([]() -> int { throw std::runtime_error("boom"); });
+    bool caught = false;
+    try {
+        g.get();
+    } catch (const std::runtime_error& e) {
+        caught = std::string(e.what()) == "boom";
+    }
+    expect(caught, mode, "exception thrown by the task is rethrown by get()");
+
+    auto v = pool.submit([] {});
+    v.get();
+    expect(!v.valid(), mode, "void submit completes");
+}
+
+static void checkBroken(const char* mode) {
+    TaskFuture<int> f;
+    {
+        TaskPromise<int> p;
+        f = p.get_future();
+        TaskPromise<int> moved = std::move(p); // 移走以后只有 moved 析构时才算放弃
+    }
+    bool broken = false;
+    try {
+        f.get();
+    } catch (const std::future_error& e) {
+        broken = e.code() == std::future_errc::broken_promise;
+    }
+    expect(broken, mode, "abandoned promise gives broken_promise");
+}
+
+static void checkOversize(SimpleThreadPool& pool, const char* mode) {
+    struct Big {
+        char pad[200];
+        Counted c;
+        void operator()() { c(); }
+    };
+    struct ThrowingMove {
+        Counted c;
+        ThrowingMove(std::atomic<int>* r) : c(r) {}
+        ThrowingMove(ThrowingMove&& o) noexcept(false) : c(std::move(o.c)) {}
+        void operator()() { c(); }
+    };
+    static_assert(SmallTask::storedInline<Counted>(), "small callable should be inline");
+    static_assert(!SmallTask::storedInline<Big>(), "200-byte callable should go to the heap");
+    static_assert(!SmallTask::storedInline<ThrowingMove>(), "throwing move should go to the heap");
+
+    Counted::reset();
+    std::atomic<int> ran{0};
+    for (int i = 0; i < 100; ++i) {
+        pool.post(Counted(&ran));
+        pool.post(Big{{}, Counted(&ran)});
+        pool.post(ThrowingMove(&ran));
+    }
+    waitFor(ran, 300);
+    // 任务执行完才析构，析构在 ran 计数之后：再等一等 live 归零
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (Counted::live.load() != 0 && std::chrono::steady_clock::now() < deadline) std::this_thread::yield();
+    expect(ran.load() == 300, mode, "every oversized task ran once");
+    expect(Counted::live.load() == 0, mode, "every stored callable was destroyed once");
+
+    // 不进池：SmallTask 自己的搬移和 reset
+    Counted::reset();
+    {
+        SmallTask a(Big{{}, Counted(&ran)});
+        SmallTask b(std::move(a));
+        expect(!a && b, mode, "moved-from SmallTask is empty");
+        b();
+        b.reset();
+        expect(!b, mode, "reset empties the SmallTask");
+    }
+    expect(Counted::live.load() == 0, mode, "heap callable destroyed by reset");
+}
+
+static void checkBulk(SimpleThreadPool& pool, const char* mode) {
+    std::atomic<int> ran{0};
+    std::vector<Counted> v;
+    v.reserve(64);
+    for (int i = 0; i < 64; ++i) v.emplace_back(&ran);
+
+    Counted::reset();
+    pool.post_bulk(v);
+    waitFor(ran, 64);
+    expect(Counted::copies.load() == 64, mode, "post_bulk(lvalue) copies each element");
+    for (auto& c : v) c(); // 原来的还能用
+    expect(ran.load() == 128, mode, "lvalue range is left intact");
+
+    Counted::reset();
+    pool.post_bulk(std::move(v));
+    waitFor(ran, 192);
+    expect(Counted::copies.load() == 0, mode, "post_bulk(rvalue) moves elements instead of copying");
+    expect(Counted::moves.load() >= 64, mode, "post_bulk(rvalue) moves each element");
+}
+
+int main() {
+    for (auto mode : {SimpleThreadPool::Mode::Shared, SimpleThreadPool::Mode::WorkStealing}) {
+        const char* name = mode == SimpleThreadPool::Mode::Shared ? "shared" : "stealing";
+        {
+            SimpleThreadPool pool(4, mode);
+            checkFuture(pool, name);
+            checkBroken(name);
+            checkOversize(pool, name);
+            checkBulk(pool, name);
+        }
+        std::printf("%-9s %s\n", name, g_failures == 0 ? "ok" : "FAILED");
+    }
+    return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+#ifndef TASK_FUTURE_HPP
+#define TASK_FUTURE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+// ===================== 轻量 future / promise =====================
+// 和 std::promise / std::future 用法一样，区别是共享状态按需分配：
+// - TaskPromise 默认构造不分配；只有调用 get_future() 才 new 一个共享状态（整个 submit 只有这一次分配）
+// - 没人要结果时（任务里带着 promise，但从没取过 future）set_value / set_exception 直接丢弃，什么都不分配
+// - 共享状态是侵入式引用计数，不走 shared_ptr 的控制块
+// promise 析构时还没设置结果，等着的 future 会拿到 std::future_errc::broken_promise
+template<typename T> class TaskFuture;
+
+template<typename T>
+class TaskPromise {
+public:
+    TaskPromise() = default;
+    TaskPromise(TaskPromise&& o) noexcept : m_state(std::exchange(o.m_state, nullptr)) {}
+    TaskPromise& operator=(TaskPromise&& o) noexcept {
+        if (this != &o) {
+            abandon();
+            m_state = std::exchange(o.m_state, nullptr);
+        }
+        return *this;
+    }
+    TaskPromise(const TaskPromise&) = delete;
+    TaskPromise& operator=(const TaskPromise&) = delete;
+    ~TaskPromise() { abandon(); }
+
+    // 只能取一次
+    TaskFuture<T> get_future() {
+        if (m_state) throw std::future_error(std::future_errc::future_already_retrieved);
+        m_state = new State;
+        m_state->refs.fetch_add(1, std::memory_order_relaxed);
+        return TaskFuture<T>(m_state);
+    }
+
+    template<typename... V>
+    void set_value(V&&... v) {
+        if (!m_state) return; // 没人等结果
+        {
+            std::lock_guard<std::mutex> lock(m_state->mtx);
+            if (m_state->ready) throw std::future_error(std::future_errc::promise_already_satisfied);
+            m_state->value.emplace(std::forward<V>(v)...);
+            m_state->ready = true;
+        }
+        m_state->cv.notify_all();
+    }
+    void set_exception(std::exception_ptr e) {
+        if (!m_state) return;
+        {
+            std::lock_guard<std::mutex> lock(m_state->mtx);
+            if (m_state->ready) throw std::future_error(std::future_errc::promise_already_satisfied);
+            m_state->error = std::move(e);
+            m_state->ready = true;
+        }
+        m_state->cv.notify_all();
+    }
+
+private:
+    friend class TaskFuture<T>;
+    using Stored = std::conditional_t<std::is_void_v<T>, char, T>; // void 也占个位，ready 之后 emplace 一个 0
+
+    struct State {
+        std::atomic<int> refs{1};
+        std::mutex mtx;
+        std::condition_variable cv;
+        bool ready = false;
+        std::optional<Stored> value;
+        std::exception_ptr error;
+    };
+    static void release(State* s) {
+        if (s && s->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete s;
+    }
+
+    void abandon() {
+        if (!m_state) return;
+        bool pending;
+        {
+            std::lock_guard<std::mutex> lock(m_state->mtx);
+            pending = !m_state->ready;
+            if (pending) {
+                m_state->error = std::make_exception_ptr(std::future_error(std::future_errc::broken_promise));
+                m_state->ready = true;
+            }
+        }
+        if (pending) m_state->cv.notify_all();
+        release(std::exchange(m_state, nullptr));
+    }
+
+    State* m_state = nullptr;
+};
+
+template<typename T>
+class TaskFuture {
+public:
+    TaskFuture() = default;
+    TaskFuture(TaskFuture&& o) noexcept : m_state(std::exchange(o.m_state, nullptr)) {}
+    TaskFuture& operator=(TaskFuture&& o) noexcept {
+        if (this != &o) {
+            TaskPromise<T>::release(m_state);
+            m_state = std::exchange(o.m_state, nullptr);
+        }
+        return *this;
+    }
+    TaskFuture(const TaskFuture&) = delete;
+    TaskFuture& operator=(const TaskFuture&) = delete;
+    ~TaskFuture() { TaskPromise<T>::release(m_state); } // 和 std::future 不同：析构不等任务
+
+    bool valid() const { return m_state != nullptr; }
+
+    void wait() const {
+        std::unique_lock<std::mutex> lock(m_state->mtx);
+        m_state->cv.wait(lock, [this] { return m_state->ready; });
+    }
+    template<typename Rep, typename Period>
+    std::future_status wait_for(const std::chrono::duration<Rep, Period>& d) const {
+        std::unique_lock<std::mutex> lock(m_state->mtx);
+        return m_state->cv.wait_for(lock, d, [this] { return m_state->ready; }) ? std::future_status::ready
+                                                                                : std::future_status::timeout;
+    }
+
+    // 等结果；任务抛的异常在这里重新抛出。取完 future 就失效了（valid() 变 false）
+    T get() {
+        wait();
+        State* s = std::exchange(m_state, nullptr);
+        struct Releaser {
+            State* s;
+            ~Releaser() { TaskPromise<T>::release(s); }
+        } guard{s};
+        if (s->error) std::rethrow_exception(s->error);
+        if constexpr (!std::is_void_v<T>) return std::move(*s->value);
+    }
+
+private:
+    friend class TaskPromise<T>;
+    using State = typename TaskPromise<T>::State;
+    explicit TaskFuture(State* s) : m_state(s) {}
+
+    State* m_state = nullptr;
+};
+
+#endif // TASK_FUTURE_HPP
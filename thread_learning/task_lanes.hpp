@@ -0,0 +1,200 @@
+#ifndef TASK_LANES_HPP
+#define TASK_LANES_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "small_task.hpp"
+
+// ===================== 优先级通道 =====================
+// 所有任务排一个 FIFO 时，一批慢任务（压缩、查库）会把后面便宜的请求处理全部堵住。
+// 这里把一个队列拆成几条通道，出队时按权重公平地轮着取：
+// Interactive：请求处理这类短任务，权重最高
+// Normal     ：不指定通道时的默认
+// Batch      ：可以慢慢跑的重活，权重最低，但只要它有任务就一定轮得到（不会饿死）
+enum class TaskLane { Interactive, Normal, Batch };
+constexpr size_t kTaskLanes = 3;
+
+inline const char* laneName(TaskLane lane) {
+    static const char* const kNames[kTaskLanes] = {"interactive", "normal", "batch"};
+    return kNames[static_cast<size_t>(lane)];
+}
+
+// 排队时间的时间戳：x86 上用 rdtsc（大约是 steady_clock::now 的一半，虚拟机里差得更多），
+// 直方图也按 tick 记，读统计时才换算成纳秒（见 LaneStats::ns_per_tick）。非 x86 用 CLOCK_MONOTONIC，1 tick = 1 ns
+inline uint64_t laneTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+#endif
+}
+
+// ===================== 排队时间直方图 =====================
+// 对数-线性分桶：每个 2 的幂区间再等分 8 份（相对误差不超过 1/8），覆盖 0 ~ 2^40 tick（3 GHz 下约 6 分钟）。
+// 只有持有队列锁的线程写（relaxed 的 load + store，不用 fetch_add），读的一方不加锁，读到的是某个时刻的近似值
+class DelayHistogram {
+public:
+    static constexpr int kSubBits = 3;
+    static constexpr uint64_t kSub = 1u << kSubBits;
+    static constexpr int kMaxBits = 40;
+    static constexpr size_t kBuckets = (kMaxBits - kSubBits + 1) * kSub;
+
+    static size_t index(uint64_t v) {
+        if (v >= (uint64_t(1) << kMaxBits)) v = (uint64_t(1) << kMaxBits) - 1;
+        if (v < kSub) return static_cast<size_t>(v);
+        int msb = 63 - __builtin_clzll(v);
+        int shift = msb - kSubBits;
+        return static_cast<size_t>(shift + 1) * kSub + static_cast<size_t>((v >> shift) & (kSub - 1));
+    }
+    // 桶 i 里最大的值
+    static uint64_t upperBound(size_t i) {
+        if (i < kSub) return i;
+        int shift = static_cast<int>(i / kSub) - 1;
+        return ((kSub + i % kSub + 1) << shift) - 1;
+    }
+
+    void record(uint64_t ticks) {
+        bump(m_counts[index(ticks)], 1);
+        bump(m_sum, ticks);
+    }
+    uint64_t addTo(uint64_t* out) const {
+        for (size_t i = 0; i < kBuckets; ++i) out[i] += m_counts[i].load(std::memory_order_relaxed);
+        return m_sum.load(std::memory_order_relaxed);
+    }
+
+    static void bump(std::atomic<uint64_t>& a, uint64_t n) {
+        a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> m_counts[kBuckets] = {};
+    std::atomic<uint64_t> m_sum{0};
+};
+
+// 一条通道的汇总（所有队列加起来）
+struct LaneStats {
+    uint64_t enqueued = 0;       // 进过队列的任务数
+    uint64_t dequeued = 0;       // 出过队列的任务数（enqueued - dequeued 就是当前排队数）
+    uint64_t expired = 0;        // 出队时已经过了截止时间、没执行的任务数
+    uint64_t delay_sum_ticks = 0; // 采样到的任务的排队时间总和
+    std::vector<uint64_t> delay_buckets = std::vector<uint64_t>(DelayHistogram::kBuckets, 0); // 按 tick 分桶，只有采样到的任务
+    double ns_per_tick = 1.0;
+
+    // q 分位数的排队时间（纳秒，取桶的上界），没有样本返回 0
+    uint64_t delayQuantile(double q) const {
+        uint64_t total = 0;
+        for (uint64_t c : delay_buckets) total += c;
+        if (total == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(total - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < delay_buckets.size(); ++i) {
+            seen += delay_buckets[i];
+            if (seen >= rank) return toNs(DelayHistogram::upperBound(i));
+        }
+        return toNs(DelayHistogram::upperBound(DelayHistogram::kBuckets - 1));
+    }
+
+private:
+    uint64_t toNs(uint64_t ticks) const { return static_cast<uint64_t>(static_cast<double>(ticks) * ns_per_tick); }
+};
+
+// ===================== 按权重公平出队的多通道队列 =====================
+// 起始时间公平排队（start-time fair queuing）：每条通道一个虚拟时间，取走 k 个任务就加 k * (kScale / 权重)，
+// 每次选虚拟时间最小的非空通道（相同的取优先级高的）。权重 16 : 4 : 1 时三条都满，就按 16 : 4 : 1 的比例出任务；
+// 只有一条有任务时它独占。空通道重新有任务时，虚拟时间拉到当前服务到的位置，空闲期间不攒额度。
+// 排队时间是采样的：每个提交线程每 kSampleEvery 个任务给一个打上入队时间（stamp），出队时只有打了的才读时钟、
+// 记进本通道的直方图。一进一出两次读时钟比入队出队本身还贵，全记的话 post 要慢一半；计数是全量的。
+// 不加锁，由使用方保护
+class LaneQueues {
+public:
+    using Weights = std::array<unsigned, kTaskLanes>;
+    static constexpr uint64_t kScale = 1u << 16;
+    static constexpr uint32_t kSampleEvery = 8;
+
+    // 提交方在加锁之前调用：这个任务（或这一批）要记排队时间就返回入队时间，不记返回 0
+    static uint64_t stamp() {
+        thread_local uint32_t n = 0;
+        return n++ % kSampleEvery == 0 ? laneTicks() : 0;
+    }
+
+    explicit LaneQueues(const Weights& weights) {
+        for (size_t i = 0; i < kTaskLanes; ++i) {
+            m_lanes[i].step = kScale / (weights[i] == 0 ? 1 : weights[i]);
+        }
+    }
+
+    bool empty() const { return m_size == 0; }
+    size_t size() const { return m_size; }
+    size_t size(size_t lane) const { return m_lanes[lane].tasks.size(); }
+
+    void push(TaskLane lane, SmallTask&& task, uint64_t stamp) {
+        Lane& l = m_lanes[static_cast<size_t>(lane)];
+        if (l.tasks.empty() && l.vtime < m_vclock) l.vtime = m_vclock;
+        l.tasks.push(Entry{std::move(task), stamp});
+        DelayHistogram::bump(l.enqueued, 1);
+        ++m_size;
+    }
+
+    // 下一个该服务的通道；调用前保证不空
+    size_t pick() const {
+        size_t best = kTaskLanes;
+        for (size_t i = 0; i < kTaskLanes; ++i) {
+            if (m_lanes[i].tasks.empty()) continue;
+            if (best == kTaskLanes || m_lanes[i].vtime < m_lanes[best].vtime) best = i;
+        }
+        return best;
+    }
+
+    // 从 lane 取一个（调用前保证这条通道不空），记账；采样到的记排队时间。
+    // now 是出队时间，为 0 时第一次用到才读时钟（一次取一批时共用一个）
+    SmallTask pop(size_t lane, uint64_t& now) {
+        Lane& l = m_lanes[lane];
+        Entry e = l.tasks.pop();
+        if (e.enqueued != 0) {
+            if (now == 0) now = laneTicks();
+            l.delay.record(now > e.enqueued ? now - e.enqueued : 0);
+        }
+        DelayHistogram::bump(l.dequeued, 1);
+        m_vclock = l.vtime;
+        l.vtime += l.step;
+        --m_size;
+        return std::move(e.task);
+    }
+    SmallTask pop(uint64_t& now) { return pop(pick(), now); }
+
+    void addStats(size_t lane, LaneStats& out) const {
+        const Lane& l = m_lanes[lane];
+        out.enqueued += l.enqueued.load(std::memory_order_relaxed);
+        out.dequeued += l.dequeued.load(std::memory_order_relaxed);
+        out.delay_sum_ticks += l.delay.addTo(out.delay_buckets.data());
+    }
+
+private:
+    struct Entry {
+        SmallTask task;
+        uint64_t enqueued = 0; // 0：没采样
+    };
+    struct Lane {
+        RingQueue<Entry> tasks;
+        uint64_t vtime = 0;
+        uint64_t step = kScale;
+        std::atomic<uint64_t> enqueued{0};
+        std::atomic<uint64_t> dequeued{0};
+        DelayHistogram delay;
+    };
+
+    std::array<Lane, kTaskLanes> m_lanes;
+    uint64_t m_vclock = 0;   // 最近一次出队时那条通道的虚拟时间
+    size_t m_size = 0;
+};
+
+#endif // TASK_LANES_HPP
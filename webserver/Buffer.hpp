@@ -4,31 +4,99 @@
 #include<string>
 #include<algorithm>
 #include<cstring>
+// 默认构造的 Buffer 不带存储：第一次写的时候才从每线程的池里拿一块标准大小（kCheapPrepend+kInitialSize）的，
+// 读空以后 release() 还回池里。10 万个空闲 keep-alive 连接就不用每个压着 1 KB 的读缓冲
 class Buffer { 
 private:
     std::vector<char> buffer_;
     size_t writerIndex_;
     size_t readIndex_;
-    char* begin(){return &*buffer_.begin();}
-    const char*begin() const{return &*buffer_.begin();}
+    char* begin(){return buffer_.data();}
+    const char*begin() const{return buffer_.data();}
+    // ===================== 每线程存储池 =====================
+    class Pool{
+    private:
+        static constexpr size_t kMaxFree=256;  //每线程最多缓存 256 KB
+        std::vector<std::vector<char>> free_;
+    public:
+        ~Pool(){dead_()=true;}
+        void get(std::vector<char>& v){
+            if(free_.empty()){
+                v.resize(kStdSize());
+            }else{
+                v.swap(free_.back());
+                free_.pop_back();
+            }
+        }
+        void put(std::vector<char>& v){
+            if(free_.size()<kMaxFree){
+                free_.emplace_back();
+                free_.back().swap(v);
+            }else{
+                std::vector<char>().swap(v);
+            }
+        }
+        //线程退出时池可能先于别的 thread_local 析构：之后再释放的存储直接还给系统
+        static bool& dead_(){
+            thread_local bool dead=false;
+            return dead;
+        }
+        static Pool& local(){
+            thread_local Pool pool;
+            return pool;
+        }
+    };
+    //原来空间不够就 resize 到刚好 writerIndex_+len，够就把可读数据搬回开头：
+    //积压大、每次只腾出一点点的时候（pipeline 读一个消费一个），每追加一点就要搬 / 拷整个积压，是平方级的。
+    //现在只有腾出来的空间不小于要搬的数据时才搬（搬 1 字节至少换回 1 字节），否则按 2 倍扩容、只拷可读部分
     void makeSpace(size_t len){
-        if(writableBytes()+prependableBytes()<len+kCheapPrepend){
-            buffer_.resize(writerIndex_+len);
-        }else{
-            size_t readable=readableBytes();
+        if(buffer_.empty()&&kCheapPrepend+len<=kStdSize()){
+            Pool::local().get(buffer_);
+            readIndex_=writerIndex_=kCheapPrepend;
+            return;
+        }
+        size_t readable=readableBytes();
+        size_t reclaim=buffer_.empty()?0:prependableBytes()-kCheapPrepend;
+        if(writableBytes()+reclaim>=len&&readable<=reclaim){
             std::copy(begin()+readIndex_,begin()+writerIndex_,begin()+kCheapPrepend);
-            readIndex_=kCheapPrepend;
-            writerIndex_=readIndex_+readable;
+        }else{
+            std::vector<char> bigger(std::max(buffer_.size()*2,kCheapPrepend+readable+len));
+            std::copy(begin()+readIndex_,begin()+writerIndex_,bigger.begin()+kCheapPrepend);
+            buffer_.swap(bigger);
+            if(bigger.size()==kStdSize())putStorage_(bigger);
         }
+        readIndex_=kCheapPrepend;
+        writerIndex_=readIndex_+readable;
     }
     size_t prependableBytes() const{
         return readIndex_;
     }
+    static void putStorage_(std::vector<char>& v){
+        if(Pool::dead_())std::vector<char>().swap(v);
+        else Pool::local().put(v);
+    }
 
 public:
     static const int kCheapPrepend=8;//预留空间
     static const int kInitialSize=1024;//缓冲区大小byte
-    explicit Buffer(size_t initialSize=kInitialSize):buffer_(kCheapPrepend+initialSize),writerIndex_(kCheapPrepend),readIndex_(kCheapPrepend){}
+    static constexpr size_t kStdSize(){return kCheapPrepend+kInitialSize;}//池里的标准存储大小
+    Buffer():writerIndex_(0),readIndex_(0){}
+    explicit Buffer(size_t initialSize):buffer_(kCheapPrepend+initialSize),writerIndex_(kCheapPrepend),readIndex_(kCheapPrepend){}
+    ~Buffer(){release();}
+    Buffer(const Buffer&)=default;
+    Buffer& operator=(const Buffer&)=default;
+    Buffer(Buffer&& o) noexcept:buffer_(std::move(o.buffer_)),writerIndex_(o.writerIndex_),readIndex_(o.readIndex_){
+        o.readIndex_=o.writerIndex_=0;
+    }
+    Buffer& operator=(Buffer&& o) noexcept{
+        if(this!=&o){
+            buffer_=std::move(o.buffer_);
+            writerIndex_=o.writerIndex_;
+            readIndex_=o.readIndex_;
+            o.readIndex_=o.writerIndex_=0;
+        }
+        return *this;
+    }
     //可读字节
     size_t readableBytes() const{
         return writerIndex_-readIndex_;
@@ -50,9 +118,17 @@ public:
         }
     }
     void retrieveAll(){
-        readIndex_=kCheapPrepend;
-        writerIndex_=kCheapPrepend;
+        readIndex_=writerIndex_=buffer_.empty()?0:kCheapPrepend;
+    }
+    //没有未读数据就把存储交出去：标准大小的回每线程池，长大过的（大请求体、大积压）直接还给系统
+    void release(){
+        if(readableBytes()!=0||buffer_.empty())return;
+        if(buffer_.size()==kStdSize())putStorage_(buffer_);
+        else std::vector<char>().swap(buffer_);
+        readIndex_=writerIndex_=0;
     }
+    //当前是否持有存储
+    bool hasStorage() const{return !buffer_.empty();}
     //转回string
     std::string retrieveAllAsString(){
         return retrieveAsString(readableBytes());
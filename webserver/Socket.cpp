@@ -52,6 +52,12 @@ bool Socket::setReuseAddr() {
     return ::setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) == 0;
 }
 
+bool Socket::setReusePort() {
+    if (!isValid) return false;
+    int reuse = 1;
+    return ::setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) == 0;
+}
+
 bool Socket::bind(const std::string& ip, int port) {
     if (!isValid) return false;
 
@@ -98,6 +104,16 @@ std::unique_ptr<Socket> Socket::acceptUnique() {
     return std::unique_ptr<Socket>(new Socket(client_fd, client_addr));
 }
 
+void Socket::adoptInto(std::unique_ptr<Socket>& out, int fd) {
+    struct sockaddr_in peer;
+    std::memset(&peer, 0, sizeof(peer)); // 对端地址没人用，省掉一次 getpeername
+    if (out) {
+        *out = Socket(fd, peer);
+    } else {
+        out.reset(new Socket(fd, peer));
+    }
+}
+
 bool Socket::connect(const std::string& ip, int port) {
     if (!isValid) return false;
 
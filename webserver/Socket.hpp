@@ -38,11 +38,15 @@ public:
     ~Socket();
 
     bool setReuseAddr();
+    bool setReusePort();   // SO_REUSEPORT：多个 socket 绑定同一端口，内核负责分流新连接
     bool bind(const std::string& ip, int port);
     bool listen(int backlog = 128);
 
     // [MOD] 新增：RAII 版本 accept（推荐在 Conn 用 unique_ptr 时使用）
     std::unique_ptr<Socket> acceptUnique();
+    // 托管别处 accept 出来的 fd（loop 里直接 accept4 / io_uring 的 multishot accept）；
+    // 复用调用方已有的 Socket 对象（连接池回收的 Conn），只有 out 为空时才分配
+    static void adoptInto(std::unique_ptr<Socket>& out, int fd);
 
     bool connect(const std::string& ip, int port);
 
@@ -0,0 +1,185 @@
+// ===================== 输入背压检查 =====================
+// 不计时，只检查行为对不对，epoll / io_uring 两个后端各跑一遍（同一个进程里起服务器）：
+//   stall  ：客户端只管 pipeline 发请求、一个字节也不读响应。服务器输出积压到高水位就不再解析，
+//            inbuf 攒到上限后也不能再收，客户端很快就发不动了；能发出去的总量超过 kMaxPushed 算失败
+//            （上限本身 256 KB，加上两边的 socket 缓冲区和已经解析掉的请求，正常只有几 MB）
+//   resume ：然后客户端开始读，把没发完的请求补完、再发一个 Connection: close，
+//            每个请求都要收到响应（停掉的读要重新开始，不然最后这个请求永远等不到）
+// 有错打印出来并返回 1。建议带 -fsanitize=address 构建
+//
+// 用法：./backpressure_check [port]（默认 18080）
+#include "thread_pool_webserver.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static constexpr size_t kMaxPushed = 32u << 20;
+static constexpr size_t kBodySize = 4096;
+static const char kRequest[] = "GET /x HTTP/1.1\r\nHost: check\r\n\r\n";
+static const char kStatusLine[] = "HTTP/1.1 200 OK\r\n";
+
+using Clock = std::chrono::steady_clock;
+
+// 本进程有没有 io_uring 实例（后端退回 epoll 时没有）
+static bool haveUringFd() {
+    DIR* d = opendir("/proc/self/fd");
+    if (!d) return false;
+    bool found = false;
+    char path[300], target[64];
+    while (dirent* e = readdir(d)) {
+        std::snprintf(path, sizeof(path), "/proc/self/fd/%s", e->d_name);
+        ssize_t n = readlink(path, target, sizeof(target) - 1);
+        if (n > 0) {
+            target[n] = '\0';
+            if (std::strstr(target, "io_uring")) found = true;
+        }
+    }
+    closedir(d);
+    return found;
+}
+
+static int connectTo(int port, int rcvbuf) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    // 客户端接收缓冲区开小：响应很快就堆在服务器的输出里，触发输出高水位
+    if (rcvbuf > 0) setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// 数响应的状态行：body 全是 'a'，不会撞上；跨两次 recv 的用 tail 接上
+struct ResponseCounter {
+    std::string tail;
+    size_t count = 0;
+    void feed(const char* p, size_t n) {
+        tail.append(p, n);
+        size_t pos = 0;
+        while ((pos = tail.find(kStatusLine, pos)) != std::string::npos) {
+            ++count;
+            pos += sizeof(kStatusLine) - 1;
+        }
+        size_t keep = sizeof(kStatusLine) - 2;
+        if (tail.size() > keep) tail.erase(0, tail.size() - keep);
+    }
+};
+
+static bool runBackend(SimpleWebServer::IoBackend backend, const char* name, int port) {
+    SimpleWebServer server(port, 1);
+    server.setBackend(backend);
+    server.setMetrics(false);
+    server.get("/x", [](const HttpRequest&, HttpResponse& res) {
+        res.status_code = 200;
+        res.status_msg = "OK";
+        res.headers["Content-Type"] = "application/octet-stream";
+        res.body.assign(kBodySize, 'a');
+    });
+    std::thread runner([&server]() { server.start(); });
+
+    int fd = -1;
+    for (int i = 0; i < 200 && fd < 0; ++i) {
+        fd = connectTo(port, 16 * 1024);
+        if (fd < 0) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    bool ok = fd >= 0;
+    if (!ok) std::fprintf(stderr, "[%s] cannot connect to port %d\n", name, port);
+    if (ok && backend == SimpleWebServer::IoBackend::IoUring && !haveUringFd()) {
+        std::printf("%-6s skipped (io_uring unavailable, server fell back to epoll)\n", name);
+        close(fd);
+        server.stop();
+        runner.join();
+        return true;
+    }
+
+    // ---------- stall：只发不读，直到 300 ms 没有进展 ----------
+    const size_t req_len = sizeof(kRequest) - 1;
+    size_t pushed = 0;
+    if (ok) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        auto last_progress = Clock::now();
+        std::string chunk;
+        for (int i = 0; i < 256; ++i) chunk += kRequest;
+        while (pushed < kMaxPushed && Clock::now() - last_progress < std::chrono::milliseconds(300)) {
+            size_t off = pushed % chunk.size(); // chunk 是整数个请求，off 落在请求中间时接着发剩下的
+            ssize_t n = send(fd, chunk.data() + off, chunk.size() - off, MSG_NOSIGNAL);
+            if (n > 0) {
+                pushed += static_cast<size_t>(n);
+                last_progress = Clock::now();
+            } else if (n < 0 && errno == EAGAIN) {
+                pollfd p{fd, POLLOUT, 0};
+                poll(&p, 1, 50);
+            } else {
+                std::fprintf(stderr, "[%s] send failed: %s\n", name, std::strerror(errno));
+                ok = false;
+                break;
+            }
+        }
+        if (pushed >= kMaxPushed) {
+            std::fprintf(stderr, "[%s] non-reading client pushed %zu bytes without stalling\n", name, pushed);
+            ok = false;
+        }
+    }
+
+    // ---------- resume：读响应，补完最后一个请求，再发一个 close ----------
+    if (ok) {
+        std::string rest(kRequest + pushed % req_len, req_len - pushed % req_len);
+        if (rest.size() == req_len) rest.clear();
+        size_t want = (pushed + req_len - 1) / req_len + 1;
+        rest += "GET /x HTTP/1.1\r\nHost: check\r\nConnection: close\r\n\r\n";
+        ResponseCounter counter;
+        char buf[64 * 1024];
+        size_t sent = 0;
+        bool eof = false;
+        auto deadline = Clock::now() + std::chrono::seconds(30);
+        while (!eof && Clock::now() < deadline) {
+            pollfd p{fd, static_cast<short>(POLLIN | (sent < rest.size() ? POLLOUT : 0)), 0};
+            poll(&p, 1, 100);
+            if (sent < rest.size()) {
+                ssize_t n = send(fd, rest.data() + sent, rest.size() - sent, MSG_NOSIGNAL);
+                if (n > 0) sent += static_cast<size_t>(n);
+            }
+            while (true) {
+                ssize_t n = recv(fd, buf, sizeof(buf), 0);
+                if (n > 0) {
+                    counter.feed(buf, static_cast<size_t>(n));
+                } else {
+                    eof = n == 0;
+                    break;
+                }
+            }
+        }
+        if (!eof || counter.count != want) {
+            std::fprintf(stderr, "[%s] got %zu of %zu responses%s\n", name, counter.count, want,
+                         eof ? "" : " before the deadline (reading never resumed?)");
+            ok = false;
+        }
+    }
+    if (fd >= 0) close(fd);
+    server.stop();
+    runner.join();
+    std::printf("%-6s %s (pushed %.1f MB before stalling)\n", name, ok ? "ok" : "FAILED", pushed / 1048576.0);
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    int port = argc > 1 ? std::atoi(argv[1]) : 18080;
+    bool ok = runBackend(SimpleWebServer::IoBackend::Epoll, "epoll", port);
+    ok = runBackend(SimpleWebServer::IoBackend::IoUring, "uring", port + 1) && ok;
+    return ok ? 0 : 1;
+}
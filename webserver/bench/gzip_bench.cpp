@@ -0,0 +1,127 @@
+// ===================== 响应压缩微基准 =====================
+// 在几种典型响应上比较各压缩级别的线上字节数（压缩率）和每 KB 明文的 CPU 开销：
+//   整块压缩：compression::compress（每线程复用 Deflater）vs 每次新建 z_stream（deflateInit/End）
+//   流式压缩：按 4 KB 一块喂 Deflater（chunked 响应的做法），再加上 chunked 分块头的开销
+//   缓存命中：CompressCache 里取出来的代价
+//
+// 用法：./gzip_bench [iterations]
+#include "compression.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// ===================== 样本 =====================
+// 和 handler 实际生成的差不多：表格 HTML、API 的 JSON 列表、一小段 HTML
+static std::string htmlPage() {
+    std::string s = "<!DOCTYPE html><html><head><title>Orders</title>"
+                    "<link rel=\"stylesheet\" href=\"/static/site.css\"></head><body><table class=\"orders\">\n";
+    for (int i = 0; i < 300; ++i) {
+        s += "<tr class=\"" + std::string(i % 2 ? "odd" : "even") + "\"><td>" + std::to_string(100000 + i * 37) +
+             "</td><td>customer-" + std::to_string(i * 7919 % 1000) + "</td><td>" + std::to_string(i * 13 % 97) +
+             ".99</td><td><a href=\"/orders/" + std::to_string(i) + "\">details</a></td></tr>\n";
+    }
+    return s + "</table></body></html>\n";
+}
+
+static std::string jsonList() {
+    std::string s = "[";
+    for (int i = 0; i < 500; ++i) {
+        if (i) s += ',';
+        s += "{\"id\":" + std::to_string(i) + ",\"name\":\"item-" + std::to_string(i * 31 % 1000) +
+             "\",\"price\":" + std::to_string(i * 17 % 500) + ".5,\"tags\":[\"a\",\"b\"],\"active\":" +
+             (i % 3 ? "true" : "false") + "}";
+    }
+    return s + "]";
+}
+
+static std::string smallHtml() {
+    std::string s = "<html><body><h1>Welcome to Simple Web Server!</h1><ul>";
+    for (int i = 0; i < 20; ++i) s += "<li>entry " + std::to_string(i) + "</li>";
+    return s + "</ul></body></html>";
+}
+
+// ===================== 计时 =====================
+static volatile size_t g_sink;
+
+template<typename F>
+static double nsPerIter(size_t iterations, F&& f) {
+    for (size_t i = 0; i < iterations / 10 + 1; ++i) g_sink = f(); // 预热
+    auto t0 = std::chrono::steady_clock::now();
+    size_t acc = 0;
+    for (size_t i = 0; i < iterations; ++i) acc += f();
+    auto t1 = std::chrono::steady_clock::now();
+    g_sink = acc;
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / static_cast<double>(iterations);
+}
+
+// 每次都新建 z_stream：不复用时的代价
+static size_t freshDeflate(compression::Coding c, int level, const std::string& in) {
+    compression::Deflater d(c, level);
+    std::string out;
+    d.write(in, out, Z_FINISH);
+    return out.size();
+}
+
+// chunked 响应：4 KB 一块喂进去，输出按块加上 "<hex>\r\n...\r\n" 的开销
+static size_t streamed(compression::Coding c, int level, const std::string& in) {
+    compression::Deflater d(c, level);
+    std::string out;
+    size_t wire = 0;
+    for (size_t off = 0; off < in.size(); off += 4096) {
+        out.clear();
+        d.write(std::string_view(in).substr(off, 4096), out);
+        if (!out.empty()) wire += out.size() + 8;
+    }
+    out.clear();
+    d.write(std::string_view(), out, Z_FINISH);
+    return wire + out.size() + 8 + 5;
+}
+
+int main(int argc, char* argv[]) {
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000;
+    struct Sample {
+        const char* name;
+        std::string body;
+    } samples[] = {{"html", htmlPage()}, {"json", jsonList()}, {"small", smallHtml()}};
+
+    std::printf("%-6s %-8s %5s %9s %9s %7s %12s %12s %12s\n", "sample", "coding", "level", "plain", "wire",
+                "ratio", "ns/KB reuse", "ns/KB fresh", "stream wire");
+    for (const Sample& s : samples) {
+        double kb = static_cast<double>(s.body.size()) / 1024.0;
+        for (compression::Coding c : {compression::kGzip, compression::kDeflate}) {
+            for (int level : {1, 3, 6, 9}) {
+                std::string out;
+                compression::compress(c, level, s.body, out);
+                size_t wire = out.size();
+                size_t iters = level >= 6 ? iterations / 4 + 1 : iterations;
+                double reuse = nsPerIter(iters, [&] {
+                    compression::compress(c, level, s.body, out);
+                    return out.size();
+                });
+                double fresh = nsPerIter(iters, [&] { return freshDeflate(c, level, s.body); });
+                std::printf("%-6s %-8s %5d %9zu %9zu %6.1f%% %12.0f %12.0f %12zu\n", s.name, compression::codingName(c),
+                            level, s.body.size(), wire, 100.0 * static_cast<double>(wire) / static_cast<double>(s.body.size()),
+                            reuse / kb, fresh / kb, streamed(c, level, s.body));
+            }
+        }
+    }
+
+    // 缓存命中：查表 + 引用计数，不压缩
+    compression::Cache cache;
+    std::vector<std::string> keys;
+    for (int i = 0; i < 1000; ++i) {
+        keys.push_back("e:\"" + std::to_string(i) + "\":gzip:6");
+        auto body = std::make_shared<std::string>();
+        compression::compress(compression::kGzip, 6, samples[2].body, *body);
+        cache.put(keys.back(), body);
+    }
+    size_t k = 0;
+    double hit = nsPerIter(iterations * 100, [&] {
+        auto b = cache.get(keys[k++ % keys.size()]);
+        return b ? b->size() : 0;
+    });
+    std::printf("\ncache hit: %.0f ns/lookup (%zu bytes cached)\n", hit, cache.bytes());
+    return 0;
+}
@@ -0,0 +1,171 @@
+// ===================== HTTP 解析微基准 =====================
+// 对比旧的解析方式（std::search 找空行 + istringstream 切行 + unordered_map<string,string> 存头）
+// 和 HttpParser（增量扫描 + string_view），输出每个请求的耗时和堆分配次数。
+//
+// 用法：./parser_bench [iterations]
+// 三种输入：整包到达；拆成 3 段到达（模拟半包，旧方式每段都从头 search）；8 个请求 pipeline
+#include "httpParser.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+// ===================== 分配计数 =====================
+static std::atomic<size_t> g_allocs{0};
+
+void* operator new(size_t n) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t n) { return operator new(n); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+static const char kRequest[] =
+    "GET /api/v1/items?id=42&sort=desc HTTP/1.1\r\n"
+    "Host: bench.example.com\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko)\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+    "Accept-Language: en-US,en;q=0.5\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Cookie: session=0123456789abcdef0123456789abcdef; theme=dark\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "\r\n";
+
+// ===================== 旧实现（原 tryParseOneRequest 的逻辑） =====================
+struct LegacyRequest {
+    std::string method, path, version;
+    std::unordered_map<std::string, std::string> headers;
+    std::string body;
+};
+
+static bool legacyParse(const char* buf, size_t len, LegacyRequest& req, size_t& consumed) {
+    const char* crlf = "\r\n\r\n";
+    auto it = std::search(buf, buf + len, crlf, crlf + 4);
+    if (it == buf + len) return false;
+    size_t header_len = (it - buf) + 4;
+    std::string header_part(buf, header_len);
+    std::istringstream iss(header_part);
+    std::string line;
+    if (std::getline(iss, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        std::istringstream line_ss(line);
+        line_ss >> req.method >> req.path >> req.version;
+    }
+    while (std::getline(iss, line) && line != "\r") {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) break;
+        size_t colon = line.find(':');
+        if (colon != std::string::npos) {
+            std::string key = line.substr(0, colon);
+            std::string val = line.substr(colon + 1);
+            size_t first_not_space = val.find_first_not_of(' ');
+            if (first_not_space != std::string::npos) val = val.substr(first_not_space);
+            req.headers[key] = val;
+        }
+    }
+    size_t body_len = 0;
+    auto cl_it = req.headers.find("Content-Length");
+    if (cl_it != req.headers.end()) body_len = std::stoul(cl_it->second);
+    if (len < header_len + body_len) return false;
+    req.body.assign(buf + header_len, body_len);
+    consumed = header_len + body_len;
+    return true;
+}
+
+// ===================== 计时 =====================
+struct Result {
+    double ns_per_req;
+    double allocs_per_req;
+};
+
+template<typename F>
+static Result measure(size_t iterations, size_t reqs_per_iter, F&& f) {
+    for (size_t i = 0; i < iterations / 10 + 1; ++i) f(); // 预热
+    size_t a0 = g_allocs.load();
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) f();
+    auto t1 = std::chrono::steady_clock::now();
+    size_t a1 = g_allocs.load();
+    double total = static_cast<double>(iterations * reqs_per_iter);
+    return {std::chrono::duration<double, std::nano>(t1 - t0).count() / total,
+            static_cast<double>(a1 - a0) / total};
+}
+
+static void report(const char* name, const Result& r) {
+    std::printf("%-28s %10.1f ns/req %8.2f allocs/req\n", name, r.ns_per_req, r.allocs_per_req);
+}
+
+static volatile size_t g_sink;
+
+int main(int argc, char* argv[]) {
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    const size_t len = sizeof(kRequest) - 1;
+    const size_t cut1 = len / 3, cut2 = len * 2 / 3;
+
+    std::string pipelined;
+    for (int i = 0; i < 8; ++i) pipelined.append(kRequest, len);
+
+    // 整包
+    report("legacy  whole", measure(iterations, 1, [&] {
+        LegacyRequest req;
+        size_t consumed = 0;
+        legacyParse(kRequest, len, req, consumed);
+        g_sink = consumed + req.headers.size();
+    }));
+    HttpParser parser;
+    HttpRequest req;
+    report("parser  whole", measure(iterations, 1, [&] {
+        parser.parse(kRequest, len, req);
+        g_sink = parser.consumed() + req.headers.size();
+    }));
+
+    // 分 3 段到达：每到一段调一次
+    report("legacy  3 segments", measure(iterations, 1, [&] {
+        LegacyRequest r;
+        size_t consumed = 0;
+        legacyParse(kRequest, cut1, r, consumed);
+        legacyParse(kRequest, cut2, r, consumed);
+        legacyParse(kRequest, len, r, consumed);
+        g_sink = consumed;
+    }));
+    report("parser  3 segments", measure(iterations, 1, [&] {
+        parser.parse(kRequest, cut1, req);
+        parser.parse(kRequest, cut2, req);
+        parser.parse(kRequest, len, req);
+        g_sink = parser.consumed();
+    }));
+
+    // pipeline：一次读到 8 个请求
+    report("legacy  pipelined x8", measure(iterations / 8 + 1, 8, [&] {
+        const char* p = pipelined.data();
+        size_t left = pipelined.size();
+        size_t consumed = 0;
+        LegacyRequest r;
+        while (legacyParse(p, left, r, consumed)) {
+            p += consumed;
+            left -= consumed;
+            r = LegacyRequest();
+        }
+        g_sink = left;
+    }));
+    report("parser  pipelined x8", measure(iterations / 8 + 1, 8, [&] {
+        const char* p = pipelined.data();
+        size_t left = pipelined.size();
+        while (parser.parse(p, left, req) == HttpParser::kComplete) {
+            p += parser.consumed();
+            left -= parser.consumed();
+        }
+        g_sink = left;
+    }));
+    return 0;
+}
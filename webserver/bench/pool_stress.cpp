@@ -0,0 +1,156 @@
+// ===================== 工作窃取压力测试 =====================
+// 不计时，只检查结果对不对；配合 sanitizer 跑才有意义（数据竞争、越界、释放后使用）：
+//   last   ：ChaseLevDeque 只剩一个元素时，所属线程 pop 和几个小偷 steal 同时抢，每轮恰好一个人拿到
+//   grow   ：初始容量 2，所属线程一边 push（反复换更大的数组）一边 pop，小偷不停 steal，每个元素恰好被拿走一次
+//   drain  ：两种模式的池，worker 都卡住时排满任务（注入队列 + worker 自己队列里派生的），
+//            析构时这些任务全部执行完才返回
+// 有错打印出来并返回 1。
+//
+// 用法：./pool_stress [rounds]
+// 带 sanitizer 构建：cmake -S . -B build-tsan -DCMAKE_CXX_FLAGS=-fsanitize=thread（或 -fsanitize=address）
+#include "chase_lev_deque.hpp"
+#include "simple_thread_pool.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+static constexpr int kThieves = 3;
+
+// 元素用 1..n 的整数（0 是 steal / pop 的“没拿到”）；taken[v] 记被拿走几次
+static bool checkTaken(const char* name, const std::vector<std::atomic<uint32_t>>& taken, size_t from) {
+    size_t bad = 0;
+    for (size_t v = from; v < taken.size(); ++v) {
+        uint32_t n = taken[v].load(std::memory_order_relaxed);
+        if (n != 1 && bad++ < 5) std::fprintf(stderr, "%s: element %zu taken %u times\n", name, v, n);
+    }
+    return bad == 0;
+}
+
+// ===================== 最后一个元素 =====================
+static bool lastElement(size_t rounds) {
+    ChaseLevDeque<uintptr_t> dq(2);
+    std::vector<std::atomic<uint32_t>> taken(rounds + 1);
+    std::atomic<size_t> round{0};
+    std::atomic<int> done{0};
+    std::vector<std::thread> thieves;
+    for (int t = 0; t < kThieves; ++t) {
+        thieves.emplace_back([&]() {
+            for (size_t seen = 0; seen < rounds;) {
+                size_t r = round.load(std::memory_order_acquire);
+                if (r == seen) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                seen = r;
+                if (uintptr_t v = dq.steal()) taken[v].fetch_add(1, std::memory_order_relaxed);
+                done.fetch_add(1, std::memory_order_acq_rel);
+            }
+        });
+    }
+    for (size_t r = 1; r <= rounds; ++r) {
+        dq.push(r);
+        round.store(r, std::memory_order_release); // 放小偷出来，和下面的 pop 同时抢
+        for (volatile size_t spin = r % 97; spin > 0; spin = spin - 1) {} // pop 的时机每轮错开一点，多核上才会撞到一起
+        if (uintptr_t v = dq.pop()) taken[v].fetch_add(1, std::memory_order_relaxed);
+        while (done.load(std::memory_order_acquire) < kThieves * static_cast<int>(r)) std::this_thread::yield();
+    }
+    for (auto& t : thieves) t.join();
+    return checkTaken("last", taken, 1) && dq.emptyApprox();
+}
+
+// ===================== 扩容时被偷 =====================
+static bool growWhileStealing(size_t rounds) {
+    const size_t n = rounds * 64;
+    ChaseLevDeque<uintptr_t> dq(2);
+    std::vector<std::atomic<uint32_t>> taken(n + 1);
+    std::atomic<bool> finished{false};
+    std::vector<std::thread> thieves;
+    for (int t = 0; t < kThieves; ++t) {
+        thieves.emplace_back([&]() {
+            while (true) {
+                if (uintptr_t v = dq.steal()) {
+                    taken[v].fetch_add(1, std::memory_order_relaxed);
+                } else if (finished.load(std::memory_order_acquire) && dq.emptyApprox()) {
+                    return;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    // 每批 push 的比 pop 的多，队列越来越长，一路换到能装下的大小
+    uintptr_t next = 1;
+    while (next <= n) {
+        for (int i = 0; i < 48 && next <= n; ++i) dq.push(next++);
+        for (int i = 0; i < 16; ++i) {
+            if (uintptr_t v = dq.pop()) taken[v].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    while (uintptr_t v = dq.pop()) taken[v].fetch_add(1, std::memory_order_relaxed);
+    finished.store(true, std::memory_order_release);
+    for (auto& t : thieves) t.join();
+    return checkTaken("grow", taken, 1);
+}
+
+// ===================== 析构时排空 =====================
+static bool drainOnDestruction(SimpleThreadPool::Mode mode, size_t rounds) {
+    const size_t workers = 4;
+    const size_t children = 16;  // 每个卡住的 worker 往自己的队列里派生的任务
+    const size_t external = rounds; // 从外面提交、排在注入队列里的任务
+    std::atomic<size_t> ran{0};
+    std::atomic<size_t> started{0};
+    std::atomic<bool> release{false};
+    std::thread releaser;
+    {
+        SimpleThreadPool pool(workers, mode);
+        for (size_t i = 0; i < workers; ++i) {
+            pool.post([&]() {
+                for (size_t c = 0; c < children; ++c) {
+                    pool.post([&]() { ran.fetch_add(1, std::memory_order_relaxed); });
+                }
+                started.fetch_add(1, std::memory_order_acq_rel);
+                while (!release.load(std::memory_order_acquire)) std::this_thread::yield();
+                ran.fetch_add(1, std::memory_order_relaxed);
+            });
+        }
+        // 每个 worker 都卡在一个任务里了，再排外面的任务
+        while (started.load(std::memory_order_acquire) < workers) std::this_thread::yield();
+        for (size_t i = 0; i < external; ++i) {
+            pool.post([&]() { ran.fetch_add(1, std::memory_order_relaxed); });
+        }
+        // 析构开始（置 m_stop）以后才放 worker 出来
+        releaser = std::thread([&]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            release.store(true, std::memory_order_release);
+        });
+    }
+    releaser.join();
+    size_t want = workers * (children + 1) + external;
+    size_t got = ran.load();
+    if (got != want) {
+        std::fprintf(stderr, "drain (%s): ran %zu of %zu tasks\n",
+                     mode == SimpleThreadPool::Mode::Shared ? "shared" : "stealing", got, want);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    size_t rounds = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    if (rounds == 0) rounds = 1;
+    bool ok = true;
+    auto report = [&](const char* name, bool good) {
+        std::printf("%-16s %s\n", name, good ? "ok" : "FAILED");
+        ok = ok && good;
+    };
+    report("last", lastElement(rounds));
+    report("grow", growWhileStealing(rounds));
+    report("drain shared", drainOnDestruction(SimpleThreadPool::Mode::Shared, rounds));
+    report("drain stealing", drainOnDestruction(SimpleThreadPool::Mode::WorkStealing, rounds));
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,212 @@
+// ===================== 路由查找微基准 =====================
+// 对比原来的路由表（unordered_map<std::string, Route> 精确匹配 + 前缀路由线性扫描）和 RadixRouter，
+// 路由数 100 / 1000 / 10000，输出每次查找的耗时和堆分配次数。
+//   static ：全部是静态路径（/api/v3/svc17/items/list 这种），两边都能精确匹配
+//   params ：/api/v3/svc17/items/:id/detail 这种带参数的路径；原来的表表达不了，
+//            只能当前缀路由注册再线性扫（这里按最长前缀扫一遍，近似原 findRouteHandler 的前缀分支）
+//   miss   ：不存在的路径
+//
+// 计时之前先跑一遍匹配语义的检查（优先级、回退、':' 只在 '/' 后面才是参数），不对就报错退出。
+//
+// 用法：./router_bench [lookups]
+#include "radixRouter.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ===================== 分配计数 =====================
+static std::atomic<size_t> g_allocs{0};
+
+void* operator new(size_t n) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t n) { return operator new(n); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+struct Route {
+    std::function<void()> handler;
+    int id = 0;
+};
+
+// ===================== 路由集 =====================
+// n 个路由分散在 版本 / 服务 / 资源 / 动作 四层，前缀共享程度和真实 API 差不多
+static const char* kResources[] = {"items", "orders", "users", "carts", "invoices", "reviews", "tags", "media"};
+static const char* kActions[] = {"list", "detail", "history", "export", "stats"};
+
+static std::string staticPath(int i) {
+    return "/api/v" + std::to_string(i % 4) + "/svc" + std::to_string(i / 40) + "/" + kResources[(i / 5) % 8] + "/" +
+           kActions[i % 5];
+}
+static std::string paramPattern(int i) {
+    return "/api/v" + std::to_string(i % 4) + "/svc" + std::to_string(i / 40) + "/" + kResources[(i / 5) % 8] +
+           "/:id/" + kActions[i % 5];
+}
+static std::string paramPrefix(int i) {
+    return "/api/v" + std::to_string(i % 4) + "/svc" + std::to_string(i / 40) + "/" + kResources[(i / 5) % 8] + "/";
+}
+static std::string paramPath(int i) {
+    return paramPrefix(i) + std::to_string(100000 + i * 7) + "/" + kActions[i % 5];
+}
+
+// ===================== 原来的查找方式 =====================
+struct LegacyRouter {
+    std::unordered_map<std::string, Route> exact;
+    std::vector<std::pair<std::string, Route>> prefixes;
+
+    const Route* find(std::string_view p) const {
+        const std::string path(p);
+        auto it = exact.find(path);
+        if (it != exact.end()) return &it->second;
+        const Route* best = nullptr;
+        size_t best_len = 0;
+        for (const auto& [prefix, route] : prefixes) {
+            if (prefix.size() >= best_len && p.compare(0, prefix.size(), prefix) == 0) {
+                best = &route;
+                best_len = prefix.size();
+            }
+        }
+        return best;
+    }
+};
+
+// ===================== 语义检查 =====================
+// 每条：先按顺序注册 patterns（id 从 1 开始），再查 path，期望命中 want（0 表示不命中），
+// param 非空时再看捕获的参数 "name=value"
+struct RouterCase {
+    std::vector<const char*> patterns;
+    const char* path;
+    int want;
+    const char* param;
+};
+
+static bool checkRouter() {
+    static const RouterCase kCases[] = {
+        {{"/users/:id", "/users/me"}, "/users/me", 2, nullptr},
+        {{"/users/:id", "/users/me"}, "/users/42", 1, "id=42"},
+        {{"/users/:id/posts", "/users/*rest"}, "/users/42/likes", 2, "rest=42/likes"},
+        {{"/static/*path"}, "/static/", 1, "path="},
+        {{"/a/:x"}, "/a/", 0, nullptr},
+        {{"/search"}, "/search?q=1", 1, nullptr},
+        // ':' 不跟在 '/' 后面就是普通字节
+        {{"/a", "/a:b"}, "/axyz", 0, nullptr},
+        {{"/a", "/a:b"}, "/a:b", 2, nullptr},
+        {{"/a:b"}, "/a:b", 1, nullptr},
+        {{"/v1:batch/:id"}, "/v1:batch/7", 1, "id=7"},
+    };
+    bool ok = true;
+    for (const RouterCase& c : kCases) {
+        RadixRouter<int> r;
+        int id = 0;
+        for (const char* p : c.patterns) r.add(HttpMethod::kGet, p, ++id);
+        RouteParams params;
+        const int* hit = r.find(HttpMethod::kGet, c.path, params);
+        int got = hit ? *hit : 0;
+        bool good = got == c.want;
+        if (good && c.param) {
+            std::string_view want(c.param);
+            size_t eq = want.find('=');
+            good = params.get(want.substr(0, eq)) == want.substr(eq + 1) && params.size() == 1;
+        }
+        if (!good) {
+            std::fprintf(stderr, "router check failed: path %s -> route %d, want %d\n", c.path, got, c.want);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// ===================== 计时 =====================
+struct Result {
+    double ns_per_lookup;
+    double allocs_per_lookup;
+};
+
+static volatile size_t g_sink;
+
+template<typename F>
+static Result measure(const std::vector<std::string>& paths, size_t lookups, F&& f) {
+    size_t acc = 0;
+    for (size_t i = 0; i < paths.size() && i < lookups / 10 + 1; ++i) acc += f(paths[i]); // 预热
+    size_t a0 = g_allocs.load();
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < lookups; ++i) acc += f(paths[i % paths.size()]);
+    auto t1 = std::chrono::steady_clock::now();
+    size_t a1 = g_allocs.load();
+    g_sink = acc;
+    return {std::chrono::duration<double, std::nano>(t1 - t0).count() / static_cast<double>(lookups),
+            static_cast<double>(a1 - a0) / static_cast<double>(lookups)};
+}
+
+static void report(int routes, const char* workload, const char* name, const Result& r) {
+    std::printf("%6d  %-7s %-8s %10.1f ns/lookup %8.2f allocs/lookup\n", routes, workload, name, r.ns_per_lookup,
+                r.allocs_per_lookup);
+}
+
+int main(int argc, char* argv[]) {
+    size_t lookups = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    if (!checkRouter()) return 1;
+    std::printf("routes  workload impl         time                 allocations\n");
+    for (int n : {100, 1000, 10000}) {
+        // 一半静态、一半带参数
+        LegacyRouter legacy;
+        RadixRouter<Route> radix;
+        std::vector<std::string> hits, paramHits, misses;
+        for (int i = 0; i < n / 2; ++i) {
+            std::string s = staticPath(i);
+            legacy.exact[s] = Route{nullptr, i};
+            radix.add(HttpMethod::kGet, s, Route{nullptr, i});
+            hits.push_back(s);
+        }
+        for (int i = 0; i < n / 2; ++i) {
+            // 前缀表里同一个前缀只留一个（原来的 serveStatic 也是这样覆盖的）
+            std::string prefix = paramPrefix(i);
+            if (i % 5 == 0) legacy.prefixes.emplace_back(prefix, Route{nullptr, i});
+            radix.add(HttpMethod::kGet, paramPattern(i), Route{nullptr, i});
+            paramHits.push_back(paramPath(i));
+            misses.push_back("/api/v" + std::to_string(i % 4) + "/svc" + std::to_string(i / 40) + "/unknown/" +
+                             kActions[i % 5]);
+        }
+
+        // 路径顺序打乱一下，避免每次都命中同一条缓存行
+        auto shuffle = [](std::vector<std::string>& v) {
+            uint64_t x = 88172645463325252ull;
+            for (size_t i = v.size(); i > 1; --i) {
+                x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+                std::swap(v[i - 1], v[x % i]);
+            }
+        };
+        shuffle(hits);
+        shuffle(paramHits);
+        shuffle(misses);
+
+        RouteParams params;
+        auto viaLegacy = [&](const std::string& p) {
+            const Route* r = legacy.find(p);
+            return r ? static_cast<size_t>(r->id) : 0;
+        };
+        auto viaRadix = [&](const std::string& p) {
+            const Route* r = radix.find(HttpMethod::kGet, p, params);
+            return r ? static_cast<size_t>(r->id) + params.size() : 0;
+        };
+        // 原来的前缀扫描是 O(路由数)，路由多的时候少跑几次
+        size_t legacyLookups = n >= 10000 ? lookups / 20 + 1 : lookups;
+        report(n, "static", "legacy", measure(hits, lookups, viaLegacy));
+        report(n, "static", "radix", measure(hits, lookups, viaRadix));
+        report(n, "params", "legacy", measure(paramHits, legacyLookups, viaLegacy));
+        report(n, "params", "radix", measure(paramHits, lookups, viaRadix));
+        report(n, "miss", "legacy", measure(misses, legacyLookups, viaLegacy));
+        report(n, "miss", "radix", measure(misses, lookups, viaRadix));
+    }
+    return 0;
+}
@@ -0,0 +1,232 @@
+// ===================== 字节扫描微基准 =====================
+// 对比 byteScan 的 scalar / SSE2 / AVX2 内核和原来的写法，在几组真实形态的请求头上测吞吐（字节/周期）：
+//   找头部结束：std::search("\r\n\r\n")（原 tryParseOneRequest）、memchr 逐个换行（上一版 HttpParser）
+//   找冒号：逐行 string_view::find('\n') + find(':')
+//   大小写不敏感比较：拷贝后 std::transform(::tolower) 再比较（原 shouldKeepAlive）、逐字节 lower
+//
+// 用法：./scan_bench [iterations]
+// 周期数用 rdtsc 读，是参考周期（TSC 频率），不是睿频后的核心周期；非 x86 平台输出字节/纳秒
+#include "byteScan.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+#ifdef BYTESCAN_X86
+#include <x86intrin.h>
+#endif
+
+// ===================== 请求头样本 =====================
+static std::string curlRequest() {
+    return "GET /hello HTTP/1.1\r\n"
+           "Host: localhost:8080\r\n"
+           "User-Agent: curl/8.5.0\r\n"
+           "Accept: */*\r\n"
+           "\r\n";
+}
+
+static std::string browserRequest() {
+    return "GET /api/v1/items?id=42&sort=desc HTTP/1.1\r\n"
+           "Host: bench.example.com\r\n"
+           "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/124.0 Safari/537.36\r\n"
+           "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+           "Accept-Language: en-US,en;q=0.9,zh-CN;q=0.8\r\n"
+           "Accept-Encoding: gzip, deflate, br\r\n"
+           "Referer: https://bench.example.com/dashboard\r\n"
+           "Sec-Fetch-Dest: document\r\n"
+           "Sec-Fetch-Mode: navigate\r\n"
+           "Sec-Fetch-Site: same-origin\r\n"
+           "Upgrade-Insecure-Requests: 1\r\n"
+           "Connection: keep-alive\r\n"
+           "Cache-Control: max-age=0\r\n"
+           "\r\n";
+}
+
+// 带大 Cookie 和鉴权头的 API 请求（约 2 KB）
+static std::string cookieRequest() {
+    std::string r = "POST /api/v2/orders HTTP/1.1\r\n"
+                    "Host: shop.example.com\r\n"
+                    "Authorization: Bearer ";
+    for (int i = 0; i < 12; ++i) r += "eyJhbGciOiJSUzI1NiIsInR5cCI6IkpXVCJ9";
+    r += "\r\nCookie: ";
+    for (int i = 0; i < 16; ++i) r += "tracking_id_" + std::to_string(i) + "=0123456789abcdef0123456789abcdef; ";
+    r += "\r\nContent-Type: application/json\r\n"
+         "X-Request-Id: 7f3c2a1e-9b4d-4e8f-a6c5-1d2e3f4a5b6c\r\n"
+         "X-Forwarded-For: 203.0.113.7, 198.51.100.23\r\n"
+         "Content-Length: 0\r\n"
+         "Connection: keep-alive\r\n"
+         "\r\n";
+    return r;
+}
+
+// ===================== 计时 =====================
+static inline uint64_t ticks() {
+#ifdef BYTESCAN_X86
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+static volatile size_t g_sink;
+
+// 编译器看得到输入不变，会把整个扫描提到循环外；每轮之间加一道内存屏障
+static inline void clobber() { asm volatile("" ::: "memory"); }
+
+// f() 每次扫描 bytes 个字节，返回字节/周期
+template<typename F>
+static double measure(size_t iterations, size_t bytes, F&& f) {
+    for (size_t i = 0; i < iterations / 10 + 1; ++i) g_sink = f(); // 预热
+    uint64_t t0 = ticks();
+    size_t acc = 0;
+    for (size_t i = 0; i < iterations; ++i) {
+        acc += f();
+        clobber();
+    }
+    uint64_t t1 = ticks();
+    g_sink = acc;
+    return static_cast<double>(iterations * bytes) / static_cast<double>(t1 - t0 ? t1 - t0 : 1);
+}
+
+static void report(const char* sample, const char* name, double v) {
+    std::printf("  %-8s %-26s %8.2f\n", sample, name, v);
+}
+
+// ===================== 原来的写法 =====================
+static size_t legacySearch(const std::string& s) {
+    static const char crlf[] = "\r\n\r\n";
+    auto it = std::search(s.data(), s.data() + s.size(), crlf, crlf + 4);
+    return it == s.data() + s.size() ? 0 : static_cast<size_t>(it - s.data()) + 4;
+}
+
+// 逐行 find('\n') + find(':')，返回冒号个数
+static size_t legacyColons(std::string_view head) {
+    size_t n = 0;
+    while (!head.empty()) {
+        size_t eol = head.find('\n');
+        std::string_view line = head.substr(0, eol);
+        if (line.find(':') != std::string_view::npos) ++n;
+        if (eol == std::string_view::npos) break;
+        head.remove_prefix(eol + 1);
+    }
+    return n;
+}
+
+// 和 HttpParser 一样一次扫描找 ':' 或 '\n'，再找行尾
+static size_t kernelColons(const byteScan::Kernels& k, std::string_view head) {
+    size_t n = 0;
+    while (!head.empty()) {
+        size_t pos = k.findAnyOf(head.data(), head.size(), ":\n", 2);
+        if (pos == head.size()) break;
+        if (head[pos] == ':') {
+            ++n;
+            head.remove_prefix(pos + 1);
+            pos = k.findAnyOf(head.data(), head.size(), "\n", 1);
+            if (pos == head.size()) break;
+        }
+        head.remove_prefix(pos + 1);
+    }
+    return n;
+}
+
+static bool legacyIequals(const std::string& a, const std::string& b) {
+    std::string x = a, y = b;
+    std::transform(x.begin(), x.end(), x.begin(), ::tolower);
+    std::transform(y.begin(), y.end(), y.begin(), ::tolower);
+    return x == y;
+}
+
+// 把样本里每个头名 / 头值和它的大写版本配成一对，模拟大小写不敏感查找
+struct Pair {
+    std::string a, b;
+};
+
+static std::vector<Pair> caseFoldPairs(const std::string& req) {
+    std::vector<Pair> pairs;
+    std::string_view head(req);
+    head.remove_prefix(head.find('\n') + 1);
+    while (!head.empty() && head.front() != '\r') {
+        size_t eol = head.find("\r\n");
+        std::string_view line = head.substr(0, eol);
+        size_t colon = line.find(':');
+        for (std::string_view part : {line.substr(0, colon), line.substr(colon + 2)}) {
+            std::string upper(part);
+            for (char& ch : upper) ch = static_cast<char>(std::toupper(static_cast<unsigned char>(ch)));
+            pairs.push_back({std::string(part), upper});
+        }
+        head.remove_prefix(eol + 2);
+    }
+    return pairs;
+}
+
+int main(int argc, char* argv[]) {
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    struct Sample {
+        const char* name;
+        std::string req;
+    } samples[] = {{"curl", curlRequest()}, {"browser", browserRequest()}, {"cookie", cookieRequest()}};
+
+    std::vector<const byteScan::Kernels*> kernels;
+    for (byteScan::Level l : {byteScan::kScalar, byteScan::kSSE2, byteScan::kAVX2}) {
+        if (const byteScan::Kernels* k = byteScan::kernelsFor(l)) kernels.push_back(k);
+    }
+    std::printf("active kernels: %s\n", byteScan::active().name);
+#ifdef BYTESCAN_X86
+    std::printf("unit: bytes / reference cycle (rdtsc)\n");
+#else
+    std::printf("unit: bytes / ns\n");
+#endif
+
+    std::printf("\n[header end]\n");
+    for (const Sample& s : samples) {
+        const std::string& r = s.req;
+        report(s.name, "std::search (legacy)", measure(iterations, r.size(), [&] { return legacySearch(r); }));
+        report(s.name, "memchr per newline", measure(iterations, r.size(), [&] {
+            return byteScan::detail::headerEndTail(r.data(), r.size(), 0);
+        }));
+        for (const byteScan::Kernels* k : kernels) {
+            std::string name = std::string("byteScan ") + k->name;
+            report(s.name, name.c_str(), measure(iterations, r.size(), [&] { return k->headerEnd(r.data(), r.size()); }));
+        }
+    }
+
+    std::printf("\n[colon / line split]\n");
+    for (const Sample& s : samples) {
+        std::string_view r(s.req);
+        report(s.name, "find per line (legacy)", measure(iterations, r.size(), [&] { return legacyColons(r); }));
+        for (const byteScan::Kernels* k : kernels) {
+            std::string name = std::string("byteScan ") + k->name;
+            report(s.name, name.c_str(), measure(iterations, r.size(), [&] { return kernelColons(*k, r); }));
+        }
+    }
+
+    std::printf("\n[case-fold compare]\n");
+    for (const Sample& s : samples) {
+        std::vector<Pair> pairs = caseFoldPairs(s.req);
+        size_t bytes = 0;
+        for (const Pair& p : pairs) bytes += p.a.size();
+        report(s.name, "transform tolower (legacy)", measure(iterations / 4 + 1, bytes, [&] {
+            size_t n = 0;
+            for (const Pair& p : pairs) n += legacyIequals(p.a, p.b);
+            return n;
+        }));
+        for (const byteScan::Kernels* k : kernels) {
+            std::string name = std::string("byteScan ") + k->name;
+            report(s.name, name.c_str(), measure(iterations, bytes, [&] {
+                size_t n = 0;
+                for (const Pair& p : pairs) n += k->iequals(p.a.data(), p.b.data(), p.a.size());
+                return n;
+            }));
+        }
+        report(s.name, "byteScan::iequals", measure(iterations, bytes, [&] {
+            size_t n = 0;
+            for (const Pair& p : pairs) n += byteScan::iequals(p.a.data(), p.b.data(), p.a.size());
+            return n;
+        }));
+    }
+    return 0;
+}
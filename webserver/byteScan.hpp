@@ -0,0 +1,245 @@
+#ifndef BYTESCAN_HPP
+#define BYTESCAN_HPP
+#include<cstddef>
+#include<cstdint>
+#include<cstring>
+#if defined(__x86_64__)||defined(__i386__)
+#include<immintrin.h>
+#define BYTESCAN_X86 1
+#endif
+// ===================== 字节扫描内核（SIMD + 运行时分派） =====================
+// HTTP 解析里最热的几处扫描：找头部结束的空行、在头部行里找 ':' / '\n'、大小写不敏感比较头名。
+// 每个内核有 scalar / SSE2 / AVX2 三个版本，第一次使用时按 CPUID 选出当前 CPU 支持的最快版本，
+// 之后经函数指针调用。AVX2 版本用 target 属性单独编译，整个程序不需要 -mavx2，老 CPU 上也能跑。
+// 非 x86 平台只有 scalar 版本。
+//
+// 约定：所有 find 返回下标，找不到返回 n（不越界读：向量循环只处理整块，尾部交给标量）
+namespace byteScan{
+
+enum Level{kScalar,kSSE2,kAVX2};
+
+struct Kernels{
+    const char* name;
+    //找头部结束的空行（"\r\n\r\n"，也容忍裸 "\n\n" / "\n\r\n"），返回空行之后的偏移；没找到返回 0
+    size_t (*headerEnd)(const char* p,size_t n);
+    //找第一个属于 set（最多 kMaxSet 个字节）的字节
+    size_t (*findAnyOf)(const char* p,size_t n,const char* set,size_t setLen);
+    //ASCII 大小写不敏感比较 n 个字节（只折叠 A-Z，其他字节原样比较）
+    bool (*iequals)(const char* a,const char* b,size_t n);
+};
+
+constexpr size_t kMaxSet=8;
+
+inline char lower(char ch){return (ch>='A'&&ch<='Z')?static_cast<char>(ch-'A'+'a'):ch;}
+
+// ===================== scalar =====================
+namespace detail{
+//从 i 开始逐个看换行：'\n' 后面紧跟 '\n' 或 "\r\n" 就是空行；后续字节没到齐的不算
+inline size_t headerEndTail(const char* p,size_t n,size_t i){
+    while(i<n){
+        const void* nl=std::memchr(p+i,'\n',n-i);
+        if(!nl)return 0;
+        size_t k=static_cast<const char*>(nl)-p;
+        if(k+1<n&&p[k+1]=='\n')return k+2;
+        if(k+2<n&&p[k+1]=='\r'&&p[k+2]=='\n')return k+3;
+        i=k+1;
+    }
+    return 0;
+}
+inline size_t findAnyOfTail(const char* p,size_t n,const char* set,size_t setLen,size_t i){
+    for(;i<n;++i){
+        for(size_t j=0;j<setLen;++j){
+            if(p[i]==set[j])return i;
+        }
+    }
+    return n;
+}
+inline bool iequalsTail(const char* a,const char* b,size_t n,size_t i){
+    for(;i<n;++i){
+        if(lower(a[i])!=lower(b[i]))return false;
+    }
+    return true;
+}
+
+inline size_t headerEndScalar(const char* p,size_t n){return headerEndTail(p,n,0);}
+inline size_t findAnyOfScalar(const char* p,size_t n,const char* set,size_t setLen){
+    if(setLen==1){
+        const void* hit=std::memchr(p,set[0],n);
+        return hit?static_cast<size_t>(static_cast<const char*>(hit)-p):n;
+    }
+    return findAnyOfTail(p,n,set,setLen,0);
+}
+inline bool iequalsScalar(const char* a,const char* b,size_t n){return iequalsTail(a,b,n,0);}
+
+#ifdef BYTESCAN_X86
+// ===================== SSE2（x86-64 基线，一定可用） =====================
+//一次看 16 个起点：p[i]=='\n' && (p[i+1]=='\n' || (p[i+1]=='\r' && p[i+2]=='\n'))，三次错位加载
+inline unsigned headerEndMaskSSE2(const char* p){
+    const __m128i nl=_mm_set1_epi8('\n'),cr=_mm_set1_epi8('\r');
+    __m128i a=_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)),nl);
+    __m128i b=_mm_loadu_si128(reinterpret_cast<const __m128i*>(p+1));
+    __m128i c=_mm_loadu_si128(reinterpret_cast<const __m128i*>(p+2));
+    __m128i next=_mm_or_si128(_mm_cmpeq_epi8(b,nl),_mm_and_si128(_mm_cmpeq_epi8(b,cr),_mm_cmpeq_epi8(c,nl)));
+    return static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(a,next)));
+}
+inline size_t headerEndSSE2(const char* p,size_t n){
+    const __m128i nl=_mm_set1_epi8('\n');
+    size_t i=0;
+    //长行（Cookie / Authorization）里大段没有换行：先 64 字节一组只看有没有 '\n'，有了再细查
+    for(;i+66<=n;i+=64){
+        __m128i any=_mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p+i)),nl),
+                         _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p+i+16)),nl)),
+            _mm_or_si128(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p+i+32)),nl),
+                         _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p+i+48)),nl)));
+        if(_mm_movemask_epi8(any)==0)continue;
+        for(size_t j=i;j<i+64;j+=16){
+            if(unsigned bits=headerEndMaskSSE2(p+j)){
+                size_t k=j+__builtin_ctz(bits);
+                return p[k+1]=='\n'?k+2:k+3;
+            }
+        }
+    }
+    for(;i+18<=n;i+=16){
+        if(unsigned bits=headerEndMaskSSE2(p+i)){
+            size_t k=i+__builtin_ctz(bits);
+            return p[k+1]=='\n'?k+2:k+3;
+        }
+    }
+    return headerEndTail(p,n,i);
+}
+inline size_t findAnyOfSSE2(const char* p,size_t n,const char* set,size_t setLen){
+    if(n<16||setLen>kMaxSet)return findAnyOfScalar(p,n,set,setLen);
+    __m128i s[kMaxSet];
+    for(size_t j=0;j<setLen;++j)s[j]=_mm_set1_epi8(set[j]);
+    for(size_t i=0;;i+=16){
+        if(i+16>n)i=n-16;//最后一块和前一块重叠：重叠部分前面已经确认没命中，不影响"第一个"
+        __m128i v=_mm_loadu_si128(reinterpret_cast<const __m128i*>(p+i));
+        __m128i m=_mm_cmpeq_epi8(v,s[0]);
+        for(size_t j=1;j<setLen;++j)m=_mm_or_si128(m,_mm_cmpeq_epi8(v,s[j]));
+        unsigned bits=static_cast<unsigned>(_mm_movemask_epi8(m));
+        if(bits)return i+__builtin_ctz(bits);
+        if(i+16>=n)return n;
+    }
+}
+//A-Z 加上 0x20，其他字节不变：x-'A' 落在 [0,26) 的就是大写字母（借有符号比较做无符号区间判断）
+inline __m128i foldSSE2(__m128i x){
+    __m128i t=_mm_sub_epi8(x,_mm_set1_epi8(static_cast<char>('A'+128)));
+    __m128i upper=_mm_cmplt_epi8(t,_mm_set1_epi8(static_cast<char>(-128+26)));
+    return _mm_or_si128(x,_mm_and_si128(upper,_mm_set1_epi8(0x20)));
+}
+inline bool iequalsSSE2(const char* a,const char* b,size_t n){
+    if(n<16)return iequalsTail(a,b,n,0);
+    for(size_t i=0;;i+=16){
+        if(i+16>n)i=n-16;
+        __m128i x=_mm_loadu_si128(reinterpret_cast<const __m128i*>(a+i));
+        __m128i y=_mm_loadu_si128(reinterpret_cast<const __m128i*>(b+i));
+        if(_mm_movemask_epi8(_mm_cmpeq_epi8(foldSSE2(x),foldSSE2(y)))!=0xFFFF)return false;
+        if(i+16>=n)return true;
+    }
+}
+
+// ===================== AVX2 =====================
+__attribute__((target("avx2")))
+inline unsigned headerEndMaskAVX2(const char* p){
+    const __m256i nl=_mm256_set1_epi8('\n'),cr=_mm256_set1_epi8('\r');
+    __m256i a=_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)),nl);
+    __m256i b=_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p+1));
+    __m256i c=_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p+2));
+    __m256i next=_mm256_or_si256(_mm256_cmpeq_epi8(b,nl),
+                                 _mm256_and_si256(_mm256_cmpeq_epi8(b,cr),_mm256_cmpeq_epi8(c,nl)));
+    return static_cast<unsigned>(_mm256_movemask_epi8(_mm256_and_si256(a,next)));
+}
+__attribute__((target("avx2")))
+inline size_t headerEndAVX2(const char* p,size_t n){
+    const __m256i nl=_mm256_set1_epi8('\n');
+    size_t i=0;
+    for(;i+66<=n;i+=64){
+        __m256i any=_mm256_or_si256(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p+i)),nl),
+            _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p+i+32)),nl));
+        if(_mm256_testz_si256(any,any))continue;
+        if(unsigned bits=headerEndMaskAVX2(p+i)){
+            size_t k=i+__builtin_ctz(bits);
+            return p[k+1]=='\n'?k+2:k+3;
+        }
+        if(unsigned bits=headerEndMaskAVX2(p+i+32)){
+            size_t k=i+32+__builtin_ctz(bits);
+            return p[k+1]=='\n'?k+2:k+3;
+        }
+    }
+    if(i+18<=n){//剩下不到一组，交给 SSE2 再走一段
+        size_t r=headerEndSSE2(p+i,n-i);
+        return r?r+i:0;
+    }
+    return headerEndTail(p,n,i);
+}
+__attribute__((target("avx2")))
+inline size_t findAnyOfAVX2(const char* p,size_t n,const char* set,size_t setLen){
+    if(n<32||setLen>kMaxSet)return findAnyOfSSE2(p,n,set,setLen);
+    __m256i s[kMaxSet];
+    for(size_t j=0;j<setLen;++j)s[j]=_mm256_set1_epi8(set[j]);
+    for(size_t i=0;;i+=32){
+        if(i+32>n)i=n-32;
+        __m256i v=_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p+i));
+        __m256i m=_mm256_cmpeq_epi8(v,s[0]);
+        for(size_t j=1;j<setLen;++j)m=_mm256_or_si256(m,_mm256_cmpeq_epi8(v,s[j]));
+        unsigned bits=static_cast<unsigned>(_mm256_movemask_epi8(m));
+        if(bits)return i+__builtin_ctz(bits);
+        if(i+32>=n)return n;
+    }
+}
+__attribute__((target("avx2")))
+inline __m256i foldAVX2(__m256i x){
+    __m256i t=_mm256_sub_epi8(x,_mm256_set1_epi8(static_cast<char>('A'+128)));
+    __m256i upper=_mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(-128+26)),t);
+    return _mm256_or_si256(x,_mm256_and_si256(upper,_mm256_set1_epi8(0x20)));
+}
+__attribute__((target("avx2")))
+inline bool iequalsAVX2(const char* a,const char* b,size_t n){
+    if(n<32)return iequalsSSE2(a,b,n);
+    for(size_t i=0;;i+=32){
+        if(i+32>n)i=n-32;
+        __m256i x=_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a+i));
+        __m256i y=_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b+i));
+        if(static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(foldAVX2(x),foldAVX2(y))))!=0xFFFFFFFFu)return false;
+        if(i+32>=n)return true;
+    }
+}
+#endif
+} // namespace detail
+
+// ===================== 分派 =====================
+//指定版本的内核表；当前 CPU 不支持返回 nullptr（基准测试用它逐个对比）
+inline const Kernels* kernelsFor(Level level){
+    static const Kernels scalar={"scalar",detail::headerEndScalar,detail::findAnyOfScalar,detail::iequalsScalar};
+#ifdef BYTESCAN_X86
+    static const Kernels sse2={"sse2",detail::headerEndSSE2,detail::findAnyOfSSE2,detail::iequalsSSE2};
+    static const Kernels avx2={"avx2",detail::headerEndAVX2,detail::findAnyOfAVX2,detail::iequalsAVX2};
+    if(level==kAVX2)return __builtin_cpu_supports("avx2")?&avx2:nullptr;
+    if(level==kSSE2)return __builtin_cpu_supports("sse2")?&sse2:nullptr;
+#else
+    if(level!=kScalar)return nullptr;
+#endif
+    return &scalar;
+}
+//当前 CPU 上最快的版本，第一次调用时选定
+inline const Kernels& active(){
+    static const Kernels* k=[]{
+        if(const Kernels* p=kernelsFor(kAVX2))return p;
+        if(const Kernels* p=kernelsFor(kSSE2))return p;
+        return kernelsFor(kScalar);
+    }();
+    return *k;
+}
+
+inline size_t headerEnd(const char* p,size_t n){return active().headerEnd(p,n);}
+inline size_t findAnyOf(const char* p,size_t n,const char* set,size_t setLen){
+    return active().findAnyOf(p,n,set,setLen);
+}
+//头名一般不到 16 字节：短的直接内联标量比较，省掉一次间接调用
+inline bool iequals(const char* a,const char* b,size_t n){
+    return n<16?detail::iequalsTail(a,b,n,0):active().iequals(a,b,n);
+}
+} // namespace byteScan
+#endif
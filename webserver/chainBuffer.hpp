@@ -0,0 +1,282 @@
+#ifndef CHAINBUFFER_HPP
+#define CHAINBUFFER_HPP
+#include<vector>
+#include<string>
+#include<string_view>
+#include<algorithm>
+#include<cstring>
+#include<cstdint>
+#include<new>
+#include<sys/types.h>
+#include<sys/uio.h>
+#include<sys/socket.h>
+// ===================== 分块链式缓冲区 =====================
+// Buffer 是一整块 vector：写满了要么整体 realloc + 拷贝，要么把没读的数据 memmove 回开头，
+// 输出积压几百 KB（pipeline 的一串响应、流式响应的高水位）时每次扩容 / 搬移都要拷全部积压。
+// ChainBuffer 由固定 16 KB 的块串成单链表：
+// 1) 追加只写尾块，满了挂一个新块，已有的数据永远不动（也就不会有扩容拷贝，io_uring 在途的 SEND 指向的内存也不会失效）
+// 2) 消费只移动头块的读指针，读空的块立刻还回去
+// 3) 块从每线程的空闲链表里取，用完放回，稳态下不调 malloc；每线程最多留 kMaxFree 个，多的还给系统
+// 4) gather 把前面若干字节按块填进 iovec，直接 writev / sendmsg；prepare + commit 反过来给 readv / preadv 用
+// 5) 整块可以在两个 ChainBuffer 之间挪（splice / moveTo），只改指针不拷数据
+// 线程模型：和 Buffer 一样不加锁；块可以在一个线程分配、另一个线程释放（进释放线程的空闲链表）
+class ChainBuffer{
+public:
+    static constexpr size_t kBlockSize=16*1024;
+private:
+    struct Block{
+        Block* next;
+        uint32_t read;          //[read,write) 是可读数据
+        uint32_t write;
+        char data[kBlockSize];
+    };
+    // ===================== 每线程块池 =====================
+    class Pool{
+    private:
+        static constexpr size_t kMaxFree=64;   //每线程最多缓存 1 MB
+        std::vector<Block*> free_;
+    public:
+        ~Pool(){
+            for(Block* b:free_)::operator delete(b);
+            dead_()=true;
+        }
+        Block* get(){
+            Block* b;
+            if(free_.empty()){
+                b=static_cast<Block*>(::operator new(sizeof(Block)));
+            }else{
+                b=free_.back();
+                free_.pop_back();
+            }
+            b->next=nullptr;
+            b->read=b->write=0;
+            return b;
+        }
+        void put(Block* b){
+            if(free_.size()<kMaxFree)free_.push_back(b);
+            else ::operator delete(b);
+        }
+        //线程退出时池可能先于别的 thread_local 析构：之后再释放的块直接还给系统
+        static bool& dead_(){
+            thread_local bool dead=false;
+            return dead;
+        }
+        static Pool& local(){
+            thread_local Pool pool;
+            return pool;
+        }
+    };
+    static Block* newBlock_(){return Pool::local().get();}
+    static void freeBlock_(Block* b){
+        if(Pool::dead_())::operator delete(b);
+        else Pool::local().put(b);
+    }
+
+    Block* head_=nullptr;
+    Block* tail_=nullptr;
+    size_t size_=0;             //可读字节数
+
+    //尾块写满（或者没有块）就挂一个新块
+    Block* writableTail_(){
+        if(!tail_||tail_->write==kBlockSize){
+            Block* b=newBlock_();
+            if(tail_)tail_->next=b;
+            else head_=b;
+            tail_=b;
+        }
+        return tail_;
+    }
+    //头块读空就还回去：空的 ChainBuffer 一个块都不占（空闲的 keep-alive 连接不压着 16 KB）
+    void popHead_(){
+        Block* b=head_;
+        head_=b->next;
+        if(b==tail_)tail_=nullptr;
+        freeBlock_(b);
+    }
+public:
+    ChainBuffer()=default;
+    ~ChainBuffer(){release_();}
+    ChainBuffer(const ChainBuffer&)=delete;
+    ChainBuffer& operator=(const ChainBuffer&)=delete;
+    ChainBuffer(ChainBuffer&& o) noexcept:head_(o.head_),tail_(o.tail_),size_(o.size_){
+        o.head_=o.tail_=nullptr;
+        o.size_=0;
+    }
+    ChainBuffer& operator=(ChainBuffer&& o) noexcept{
+        if(this!=&o){
+            release_();
+            head_=o.head_;
+            tail_=o.tail_;
+            size_=o.size_;
+            o.head_=o.tail_=nullptr;
+            o.size_=0;
+        }
+        return *this;
+    }
+    friend void swap(ChainBuffer& a,ChainBuffer& b) noexcept{
+        std::swap(a.head_,b.head_);
+        std::swap(a.tail_,b.tail_);
+        std::swap(a.size_,b.size_);
+    }
+
+    //可读字节
+    size_t readableBytes() const{return size_;}
+    //块数（包括尾部还没写满的）
+    size_t blockCount() const{
+        size_t n=0;
+        for(Block* b=head_;b;b=b->next)++n;
+        return n;
+    }
+
+    void append(const char* data,size_t len){
+        size_+=len;
+        while(len>0){
+            Block* b=writableTail_();
+            size_t n=std::min(len,kBlockSize-b->write);
+            std::memcpy(b->data+b->write,data,n);
+            b->write+=static_cast<uint32_t>(n);
+            data+=n;
+            len-=n;
+        }
+    }
+    void append(const std::string& str){append(str.data(),str.size());}
+    void append(std::string_view str){append(str.data(),str.size());}
+    //把 other 整个接到后面：只挂链表，不拷数据（other 变空）
+    void splice(ChainBuffer& other){
+        if(other.size_==0)return;
+        if(size_==0){
+            swap(*this,other);
+            return;
+        }
+        tail_->next=other.head_;
+        tail_=other.tail_;
+        size_+=other.size_;
+        other.head_=other.tail_=nullptr;
+        other.size_=0;
+    }
+    //前 len 个字节挪到 dst 末尾：整块只挪指针，最后不满一块的部分拷过去
+    void moveTo(ChainBuffer& dst,size_t len){
+        len=std::min(len,size_);
+        while(len>0){
+            Block* b=head_;
+            size_t avail=b->write-b->read;
+            if(len>=avail&&b!=tail_){
+                head_=b->next;
+                b->next=nullptr;
+                if(dst.tail_)dst.tail_->next=b;
+                else dst.head_=b;
+                dst.tail_=b;
+                dst.size_+=avail;
+                size_-=avail;
+                len-=avail;
+            }else{
+                size_t n=std::min(len,avail);
+                dst.append(b->data+b->read,n);
+                retrieve(n);
+                len-=n;
+            }
+        }
+    }
+
+    //消费长为 len 的数据
+    void retrieve(size_t len){
+        len=std::min(len,size_);
+        size_-=len;
+        while(len>0){
+            size_t n=std::min<size_t>(len,head_->write-head_->read);
+            head_->read+=static_cast<uint32_t>(n);
+            len-=n;
+            if(head_->read==head_->write)popHead_();
+        }
+    }
+    void retrieveAll(){
+        retrieve(size_);
+    }
+    std::string retrieveAllAsString(){
+        std::string s;
+        s.reserve(size_);
+        for(Block* b=head_;b;b=b->next)s.append(b->data+b->read,b->write-b->read);
+        retrieveAll();
+        return s;
+    }
+
+    //前 maxBytes 个可读字节按块填进 iov（最多 maxIov 个），cnt 返回用了几个；返回覆盖到的字节数
+    size_t gather(struct iovec* iov,int maxIov,size_t maxBytes,int& cnt) const{
+        size_t total=0;
+        cnt=0;
+        for(Block* b=head_;b&&cnt<maxIov&&total<maxBytes;b=b->next){
+            size_t n=std::min<size_t>(b->write-b->read,maxBytes-total);
+            if(n==0)continue;
+            iov[cnt].iov_base=const_cast<char*>(b->data+b->read);
+            iov[cnt].iov_len=n;
+            ++cnt;
+            total+=n;
+        }
+        return total;
+    }
+    //准备至少 len 字节的可写空间（不够就挂新块），按块填进 iov；返回覆盖到的字节数。
+    //读进去以后调 commit(n)；空间在下一次 append / prepare 之前有效
+    size_t prepare(struct iovec* iov,int maxIov,size_t len,int& cnt){
+        size_t total=0;
+        cnt=0;
+        Block* b=writableTail_();
+        while(cnt<maxIov&&total<len){
+            size_t n=std::min<size_t>(kBlockSize-b->write,len-total);
+            iov[cnt].iov_base=b->data+b->write;
+            iov[cnt].iov_len=n;
+            ++cnt;
+            total+=n;
+            if(total<len&&cnt<maxIov){
+                if(!b->next)b->next=newBlock_();
+                b=b->next;
+            }
+        }
+        return total;
+    }
+    //prepare 之后实际写进去了 n 个字节；没用到的预备块还回去
+    void commit(size_t n){
+        size_+=n;
+        Block* b=tail_;
+        while(n>0){
+            size_t k=std::min<size_t>(n,kBlockSize-b->write);
+            b->write+=static_cast<uint32_t>(k);
+            n-=k;
+            if(n>0)b=b->next;
+        }
+        tail_=b;
+        Block* spare=b->next;
+        b->next=nullptr;
+        while(spare){
+            Block* next=spare->next;
+            freeBlock_(spare);
+            spare=next;
+        }
+        if(size_==0)release_();
+    }
+
+    //前 maxBytes 个字节用一次 sendmsg 发出去（flags 同 send），发掉的部分直接消费；返回值同 sendmsg
+    ssize_t sendTo(int fd,size_t maxBytes,int flags=0){
+        struct iovec iov[kSendIov];
+        struct msghdr msg{};
+        int cnt=0;
+        gather(iov,kSendIov,maxBytes,cnt);
+        msg.msg_iov=iov;
+        msg.msg_iovlen=static_cast<size_t>(cnt);
+        ssize_t n=::sendmsg(fd,&msg,flags);
+        if(n>0)retrieve(static_cast<size_t>(n));
+        return n;
+    }
+    static constexpr int kSendIov=64;   //一次 sendmsg 最多带 64 块（1 MB）
+
+private:
+    void release_(){
+        while(head_){
+            Block* next=head_->next;
+            freeBlock_(head_);
+            head_=next;
+        }
+        tail_=nullptr;
+        size_=0;
+    }
+};
+#endif
@@ -0,0 +1,219 @@
+#ifndef COMPRESSION_HPP
+#define COMPRESSION_HPP
+#include<string>
+#include<string_view>
+#include<memory>
+#include<mutex>
+#include<list>
+#include<unordered_map>
+#include<cstring>
+#include<cstddef>
+#include<zlib.h>
+#include "byteScan.hpp"
+// ===================== 响应压缩（zlib） =====================
+// 1) negotiate：按 Accept-Encoding（带 q 值）在 gzip / deflate / identity 里挑一个
+// 2) Deflater：流式压缩器，chunked 响应每个连接一个；
+//    HTTP 的 "deflate" 是 zlib 封装（RFC 9110 8.4.1.2），不是裸 deflate 流
+// 3) compress：一次性压缩整块 body。deflateInit 要分配并清零两三百 KB 的窗口和哈希表，
+//    对几 KB 的 body 比压缩本身还贵，所以每个线程按编码留一个 Deflater，用 deflateReset 复用
+// 4) Cache：压缩结果的 LRU，按字节数限容量；键由调用方给（ETag / 文件身份 + 编码），多线程共用一把锁
+namespace compression{
+
+enum Coding{kIdentity,kGzip,kDeflate};
+constexpr int kCodingCount=3;
+
+inline const char* codingName(Coding c){
+    return c==kGzip?"gzip":c==kDeflate?"deflate":"identity";
+}
+
+inline bool iequals_(std::string_view a,std::string_view b){
+    return a.size()==b.size()&&byteScan::iequals(a.data(),b.data(),a.size());
+}
+inline std::string_view trim_(std::string_view s){
+    while(!s.empty()&&(s.front()==' '||s.front()=='\t'))s.remove_prefix(1);
+    while(!s.empty()&&(s.back()==' '||s.back()=='\t'))s.remove_suffix(1);
+    return s;
+}
+
+//文本类的才值得压：图片、视频、压缩包本身已经压过了
+inline bool compressible(std::string_view contentType){
+    contentType=trim_(contentType.substr(0,contentType.find(';')));
+    if(contentType.size()>=5&&iequals_(contentType.substr(0,5),"text/"))return true;
+    static const char* const kTypes[]={
+        "application/json","application/javascript","application/xml","application/xhtml+xml",
+        "image/svg+xml","application/wasm",
+    };
+    for(const char* t:kTypes){
+        if(iequals_(contentType,t))return true;
+    }
+    return false;
+}
+
+//";q=0.5" 之类的参数 -> 千分数；没有 q 参数是 1000，写错了按 1000 算
+inline int parseQ_(std::string_view params){
+    while(!params.empty()){
+        size_t semi=params.find(';');
+        std::string_view p=trim_(params.substr(0,semi));
+        params=semi==std::string_view::npos?std::string_view():params.substr(semi+1);
+        if(p.size()<2||(p[0]!='q'&&p[0]!='Q')||p[1]!='=')continue;
+        p.remove_prefix(2);
+        if(p.empty()||(p[0]!='0'&&p[0]!='1'))return 1000;
+        int q=(p[0]-'0')*1000;
+        if(p.size()>1&&p[1]=='.'){
+            int scale=100;
+            for(size_t i=2;i<p.size()&&i<5;++i){
+                if(p[i]<'0'||p[i]>'9')break;
+                q+=(p[i]-'0')*scale;
+                scale/=10;
+            }
+        }
+        return q>1000?1000:q;
+    }
+    return 1000;
+}
+
+//同等 q 值优先 gzip；都不接受（或者没有这个头）就是 identity
+inline Coding negotiate(std::string_view acceptEncoding){
+    int qGzip=-1,qDeflate=-1,qAny=-1;
+    while(!acceptEncoding.empty()){
+        size_t comma=acceptEncoding.find(',');
+        std::string_view item=acceptEncoding.substr(0,comma);
+        acceptEncoding=comma==std::string_view::npos?std::string_view():acceptEncoding.substr(comma+1);
+        size_t semi=item.find(';');
+        std::string_view name=trim_(item.substr(0,semi));
+        int q=semi==std::string_view::npos?1000:parseQ_(item.substr(semi+1));
+        if(iequals_(name,"gzip")||iequals_(name,"x-gzip"))qGzip=q;
+        else if(iequals_(name,"deflate"))qDeflate=q;
+        else if(name=="*")qAny=q;
+    }
+    if(qGzip<0)qGzip=qAny;
+    if(qDeflate<0)qDeflate=qAny;
+    if(qGzip<=0&&qDeflate<=0)return kIdentity;
+    return qGzip>=qDeflate?kGzip:kDeflate;
+}
+
+//同一资源不同编码的表示要有不同的强 ETag："abc" -> "abc-gzip"
+inline std::string variantEtag(const std::string& etag,Coding c){
+    if(c==kIdentity||etag.empty()||etag.back()!='"')return etag;
+    std::string v=etag;
+    v.insert(v.size()-1,std::string("-")+codingName(c));
+    return v;
+}
+
+// ===================== 流式压缩器 =====================
+class Deflater{
+private:
+    static constexpr size_t kOutStep=16*1024;
+    z_stream zs_;
+    bool ok_=false;
+    Coding coding_;
+    int level_;
+public:
+    Deflater(Coding c,int level):coding_(c),level_(level){
+        std::memset(&zs_,0,sizeof(zs_));
+        //windowBits 15 + 16：gzip 封装；15：zlib 封装
+        ok_=deflateInit2(&zs_,level,Z_DEFLATED,c==kGzip?15+16:15,8,Z_DEFAULT_STRATEGY)==Z_OK;
+    }
+    ~Deflater(){if(ok_)deflateEnd(&zs_);}
+    Deflater(const Deflater&)=delete;
+    Deflater& operator=(const Deflater&)=delete;
+
+    bool ok() const{return ok_;}
+    Coding coding() const{return coding_;}
+    int level() const{return level_;}
+    //开始一个新的流（复用已经分配好的窗口）
+    void reset(){if(ok_)deflateReset(&zs_);}
+    //in 压进去，产出追加到 out；flush 是 Z_NO_FLUSH / Z_SYNC_FLUSH / Z_FINISH
+    bool write(std::string_view in,std::string& out,int flush=Z_NO_FLUSH){
+        if(!ok_)return false;
+        zs_.next_in=reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+        zs_.avail_in=static_cast<uInt>(in.size());
+        //输出空间按输入估：resize 会把新空间清零，一上来就扩 16 KB 对几百字节的 body 太贵
+        size_t step=in.size()/2+256;
+        if(flush==Z_FINISH)step=deflateBound(&zs_,static_cast<uLong>(in.size()))+16;
+        if(step>kOutStep&&flush!=Z_FINISH)step=kOutStep;
+        do{
+            size_t old=out.size();
+            out.resize(old+step);
+            zs_.next_out=reinterpret_cast<Bytef*>(&out[old]);
+            zs_.avail_out=static_cast<uInt>(step);
+            int r=deflate(&zs_,flush);
+            out.resize(old+step-zs_.avail_out);
+            if(r==Z_STREAM_ERROR)return false;
+            step=kOutStep;
+        }while(zs_.avail_out==0);
+        return true;
+    }
+};
+
+//整块压缩：out 被覆盖。用本线程缓存的 Deflater，级别变了才重新 init
+inline bool compress(Coding c,int level,std::string_view in,std::string& out){
+    thread_local std::unique_ptr<Deflater> cached[kCodingCount];
+    std::unique_ptr<Deflater>& d=cached[c];
+    if(!d||d->level()!=level)d.reset(new Deflater(c,level));
+    else d->reset();
+    out.clear();
+    return d->write(in,out,Z_FINISH);
+}
+
+// ===================== 压缩结果 LRU =====================
+class Cache{
+public:
+    typedef std::shared_ptr<const std::string> Body;
+private:
+    typedef std::list<std::pair<std::string,Body>> List;
+    List lru_;                                          //表头最近用过
+    std::unordered_map<std::string,List::iterator> index_;
+    size_t bytes_=0;                                    //键 + 值的字节数
+    size_t capacity_;
+    std::mutex mtx_;
+
+    void evict_(){
+        while(bytes_>capacity_&&!lru_.empty()){
+            auto& back=lru_.back();
+            bytes_-=back.first.size()+back.second->size();
+            index_.erase(back.first);
+            lru_.pop_back();
+        }
+    }
+public:
+    explicit Cache(size_t capacity=16<<20):capacity_(capacity){}
+    Cache(const Cache&)=delete;
+    Cache& operator=(const Cache&)=delete;
+
+    void setCapacity(size_t capacity){
+        std::lock_guard<std::mutex> lk(mtx_);
+        capacity_=capacity;
+        evict_();
+    }
+    Body get(const std::string& key){
+        std::lock_guard<std::mutex> lk(mtx_);
+        auto it=index_.find(key);
+        if(it==index_.end())return nullptr;
+        lru_.splice(lru_.begin(),lru_,it->second);
+        return it->second->second;
+    }
+    void put(const std::string& key,Body body){
+        if(!body||key.size()+body->size()>capacity_)return;//比整个缓存还大的不放
+        std::lock_guard<std::mutex> lk(mtx_);
+        auto it=index_.find(key);
+        if(it!=index_.end()){
+            bytes_-=it->second->second->size();
+            it->second->second=std::move(body);
+            bytes_+=it->second->second->size();
+            lru_.splice(lru_.begin(),lru_,it->second);
+        }else{
+            lru_.emplace_front(key,std::move(body));
+            index_[key]=lru_.begin();
+            bytes_+=key.size()+lru_.front().second->size();
+        }
+        evict_();
+    }
+    size_t bytes(){
+        std::lock_guard<std::mutex> lk(mtx_);
+        return bytes_;
+    }
+};
+
+}
+#endif
@@ -0,0 +1,102 @@
+#ifndef FDTABLE_HPP
+#define FDTABLE_HPP
+#include<atomic>
+#include<memory>
+#include<cstddef>
+#include<sys/resource.h>
+// ===================== fd 下标表 =====================
+// 用 fd 直接当数组下标，替代 unordered_map<int, shared_ptr<Conn>> + 互斥锁：
+// 1) 查找就是两次数组访问 + 一次 acquire load，不加锁、不哈希、不分配
+// 2) 内核保证同一时刻一个 fd 编号只属于一个连接，所以多个 loop 共用一张表也不会冲突
+// 3) 两级结构：顶层按 RLIMIT_NOFILE 预分配页指针，每页 4096 个槽位第一次用到时才分配，
+//    rlimit 很大时也不会一上来就吃掉几十 MB
+//
+// 表里只存指针，不管对象生命周期（Conn 由连接池回收）
+template<typename T>
+class FdTable{
+private:
+    static constexpr int kPageBits=12;
+    static constexpr size_t kPageSize=size_t(1)<<kPageBits;
+    typedef std::atomic<T*> Slot;
+
+    std::unique_ptr<std::atomic<Slot*>[]> pages_;
+    size_t numPages_;
+
+    static size_t defaultCapacity_(){
+        struct rlimit rl;
+        size_t n=65536;
+        if(getrlimit(RLIMIT_NOFILE,&rl)==0&&rl.rlim_cur!=RLIM_INFINITY){
+            n=static_cast<size_t>(rl.rlim_cur);
+        }
+        return n;
+    }
+    Slot* page_(size_t p) const{
+        return pages_[p].load(std::memory_order_acquire);
+    }
+    //懒分配页：多个 loop 可能同时 accept 到同一页的 fd，用 CAS 决定谁的页生效
+    Slot* pageOrCreate_(size_t p){
+        Slot* page=page_(p);
+        if(page)return page;
+        Slot* fresh=new Slot[kPageSize];
+        for(size_t i=0;i<kPageSize;++i)fresh[i].store(nullptr,std::memory_order_relaxed);
+        if(pages_[p].compare_exchange_strong(page,fresh,std::memory_order_acq_rel)){
+            return fresh;
+        }
+        delete[] fresh;
+        return page;
+    }
+public:
+    //maxFds=0 表示按 RLIMIT_NOFILE 决定容量
+    explicit FdTable(size_t maxFds=0){
+        if(maxFds==0)maxFds=defaultCapacity_();
+        numPages_=(maxFds+kPageSize-1)/kPageSize;
+        pages_.reset(new std::atomic<Slot*>[numPages_]);
+        for(size_t i=0;i<numPages_;++i)pages_[i].store(nullptr,std::memory_order_relaxed);
+    }
+    ~FdTable(){
+        for(size_t i=0;i<numPages_;++i)delete[] pages_[i].load(std::memory_order_relaxed);
+    }
+    FdTable(const FdTable&)=delete;
+    FdTable& operator=(const FdTable&)=delete;
+
+    size_t capacity() const{return numPages_*kPageSize;}
+
+    T* get(int fd) const{
+        if(fd<0)return nullptr;
+        size_t p=static_cast<size_t>(fd)>>kPageBits;
+        if(p>=numPages_)return nullptr;
+        Slot* page=page_(p);
+        if(!page)return nullptr;
+        return page[fd&(kPageSize-1)].load(std::memory_order_acquire);
+    }
+    //fd 超出容量返回 false（说明 rlimit 在运行中被调大了）
+    bool set(int fd,T* v){
+        if(fd<0)return false;
+        size_t p=static_cast<size_t>(fd)>>kPageBits;
+        if(p>=numPages_)return false;
+        pageOrCreate_(p)[fd&(kPageSize-1)].store(v,std::memory_order_release);
+        return true;
+    }
+    //只有槽位里还是 expected 时才清空：防止把 fd 复用后的新连接误删
+    bool clear(int fd,T* expected){
+        if(fd<0)return false;
+        size_t p=static_cast<size_t>(fd)>>kPageBits;
+        if(p>=numPages_)return false;
+        Slot* page=page_(p);
+        if(!page)return false;
+        return page[fd&(kPageSize-1)].compare_exchange_strong(expected,nullptr,std::memory_order_acq_rel);
+    }
+    //遍历所有非空槽位（只在停机清理时用）
+    template<typename F>
+    void forEach(F&& f){
+        for(size_t p=0;p<numPages_;++p){
+            Slot* page=page_(p);
+            if(!page)continue;
+            for(size_t i=0;i<kPageSize;++i){
+                T* v=page[i].load(std::memory_order_acquire);
+                if(v)f(static_cast<int>((p<<kPageBits)|i),v);
+            }
+        }
+    }
+};
+#endif
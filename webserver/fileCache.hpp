@@ -0,0 +1,119 @@
+#ifndef FILECACHE_HPP
+#define FILECACHE_HPP
+#include<string>
+#include<memory>
+#include<mutex>
+#include<unordered_map>
+#include<chrono>
+#include<ctime>
+#include<cstring>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/stat.h>
+// ===================== 打开文件缓存（fd + stat） =====================
+// 静态文件路由用：同一个文件被反复请求时，不用每次都 open + fstat + close
+// 1) 缓存的是打开的 fd 和 stat 结果，不缓存内容：内容由 sendfile 直接从页缓存发到 socket
+// 2) 条目带 TTL：过期后下一次访问先 stat 一下，文件被改过（mtime/大小/inode 变了）才重新打开
+// 3) 条目用 shared_ptr 交出去：还在发送中的响应持有旧的 fd，缓存替换/淘汰条目不会把它关掉
+//
+// 线程模型：handler 可能跑在任意 loop 或 worker 上，查表加一把互斥锁（临界区里只有一次哈希查找）
+struct CachedFile{
+    int fd=-1;
+    off_t size=0;
+    time_t mtime=0;
+    ino_t ino=0;
+    std::string lastModified;   //预先格式化好的 Last-Modified
+    CachedFile()=default;
+    CachedFile(const CachedFile&)=delete;
+    CachedFile& operator=(const CachedFile&)=delete;
+    ~CachedFile(){if(fd>=0)::close(fd);}
+};
+
+class FileCache{
+public:
+    typedef std::shared_ptr<const CachedFile> FilePtr;
+private:
+    typedef std::chrono::steady_clock Clock;
+    struct Entry{
+        FilePtr file;
+        Clock::time_point checked;  //上一次和磁盘核对的时间
+    };
+    std::unordered_map<std::string,Entry> entries_;
+    std::mutex mtx_;
+    Clock::duration ttl_;
+    size_t maxEntries_;
+
+    static FilePtr open_(const std::string& path){
+        int fd=::open(path.c_str(),O_RDONLY|O_CLOEXEC);
+        if(fd<0)return nullptr;
+        auto f=std::make_shared<CachedFile>();
+        f->fd=fd;
+        struct stat st;
+        if(::fstat(fd,&st)!=0||!S_ISREG(st.st_mode))return nullptr;//目录、设备文件都不给
+        f->size=st.st_size;
+        f->mtime=st.st_mtime;
+        f->ino=st.st_ino;
+        f->lastModified=httpDate(st.st_mtime);
+        return f;
+    }
+    static bool unchanged_(const std::string& path,const CachedFile& f){
+        struct stat st;
+        return ::stat(path.c_str(),&st)==0&&st.st_mtime==f.mtime&&st.st_size==f.size&&st.st_ino==f.ino;
+    }
+public:
+    explicit FileCache(int ttlMs=2000,size_t maxEntries=1024)
+        :ttl_(std::chrono::milliseconds(ttlMs)),maxEntries_(maxEntries>0?maxEntries:1){}
+    FileCache(const FileCache&)=delete;
+    FileCache& operator=(const FileCache&)=delete;
+
+    //返回 nullptr 表示不存在 / 不是普通文件 / 没权限
+    FilePtr get(const std::string& path){
+        Clock::time_point now=Clock::now();
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            auto it=entries_.find(path);
+            if(it!=entries_.end()&&now-it->second.checked<ttl_)return it->second.file;
+        }
+        //过期或没命中：锁外做文件系统调用，不让慢盘卡住别的线程
+        FilePtr f;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            auto it=entries_.find(path);
+            if(it!=entries_.end())f=it->second.file;
+        }
+        if(!f||!unchanged_(path,*f))f=open_(path);
+        std::lock_guard<std::mutex> lk(mtx_);
+        if(!f){
+            entries_.erase(path);
+            return nullptr;
+        }
+        if(entries_.size()>=maxEntries_&&entries_.find(path)==entries_.end()){
+            //满了随便淘汰一个：静态文件集合一般远小于上限，这里只是防止被随机路径撑爆
+            entries_.erase(entries_.begin());
+        }
+        entries_[path]=Entry{f,now};
+        return f;
+    }
+    void clear(){
+        std::lock_guard<std::mutex> lk(mtx_);
+        entries_.clear();
+    }
+
+    // ===================== HTTP 日期（RFC 7231 IMF-fixdate） =====================
+    static std::string httpDate(time_t t){
+        struct tm tmv;
+        gmtime_r(&t,&tmv);
+        char buf[64];
+        size_t n=strftime(buf,sizeof(buf),"%a, %d %b %Y %H:%M:%S GMT",&tmv);
+        return std::string(buf,n);
+    }
+    //解析失败返回 -1
+    static time_t parseHttpDate(const std::string& s){
+        struct tm tmv;
+        std::memset(&tmv,0,sizeof(tmv));
+        const char* end=strptime(s.c_str(),"%a, %d %b %Y %H:%M:%S GMT",&tmv);
+        if(!end)return -1;
+        return timegm(&tmv);
+    }
+};
+#endif
@@ -42,14 +42,13 @@ private:
     //上调
     void siftUp_(size_t i){
         assert(!heap_.empty()&&i<heap_.size());
-        size_t j=(i-1)/2;//父节点
-        while(j>=0){
+        while(i>0){//i 是 size_t，到根就停（原来的 j>=0 恒成立，根节点再算父节点会越界）
+            size_t j=(i-1)/2;//父节点
             if(heap_[j]<heap_[i]){
                 break;
             }
             swapNode_(i,j);
             i=j;
-            j=(i-1)/2;
         }
     }
     //下沉
@@ -135,9 +134,9 @@ public:
     //获取下次清空时间差
     int getNextTick(){
         tick();//刷新
-        size_t res=-1;
+        int res=-1;
         if(!heap_.empty()){
-            res=std::chrono::duration_cast<MS>(heap_.front().expires-Clock::now()).count();
+            res=static_cast<int>(std::chrono::duration_cast<MS>(heap_.front().expires-Clock::now()).count());
             if(res<0)res=0;
         }
         return res;
@@ -0,0 +1,458 @@
+#ifndef HTTPPARSER_HPP
+#define HTTPPARSER_HPP
+#include<string_view>
+#include<utility>
+#include<memory>
+#include<cstring>
+#include<cstddef>
+#include<cstdint>
+#include "byteScan.hpp"
+// ===================== 请求头表 =====================
+// 定长数组存 (name, value) 视图，不为每个头分配 key/value 字符串；
+// 查找大小写不敏感（线性扫描：一个请求一般不到 20 个头，比哈希快）
+class HttpHeaders{
+public:
+    typedef std::pair<std::string_view,std::string_view> Field;
+    typedef const Field* const_iterator;
+    static constexpr size_t kMaxFields=64;
+private:
+    Field fields_[kMaxFields];
+    size_t size_=0;
+public:
+    static char lower(char ch){return byteScan::lower(ch);}
+    static bool iequals(std::string_view a,std::string_view b){
+        return a.size()==b.size()&&byteScan::iequals(a.data(),b.data(),a.size());
+    }
+    const_iterator begin() const{return fields_;}
+    const_iterator end() const{return fields_+size_;}
+    size_t size() const{return size_;}
+    bool empty() const{return size_==0;}
+    const_iterator find(std::string_view name) const{
+        for(size_t i=0;i<size_;++i){
+            if(iequals(fields_[i].first,name))return fields_+i;
+        }
+        return end();
+    }
+    //没有这个头返回空视图
+    std::string_view get(std::string_view name) const{
+        const_iterator it=find(name);
+        return it==end()?std::string_view():it->second;
+    }
+    bool add(std::string_view name,std::string_view value){
+        if(size_>=kMaxFields)return false;
+        fields_[size_++]=Field(name,value);
+        return true;
+    }
+    void clear(){size_=0;}
+    //所有视图整体平移（底层字节被搬走时用）
+    void rebase(const char* from,const char* to){
+        for(size_t i=0;i<size_;++i){
+            fields_[i].first=std::string_view(to+(fields_[i].first.data()-from),fields_[i].first.size());
+            fields_[i].second=std::string_view(to+(fields_[i].second.data()-from),fields_[i].second.size());
+        }
+    }
+};
+
+// ===================== 请求方法 =====================
+// 解析时就把方法名转成枚举，路由按枚举分树，不再拿字符串比较
+enum class HttpMethod:uint8_t{kGet,kHead,kPost,kPut,kDelete,kPatch,kOptions,kOther};
+constexpr size_t kHttpMethodCount=8;
+
+inline HttpMethod parseMethod(std::string_view m){
+    switch(m.size()){
+    case 3:
+        if(m=="GET")return HttpMethod::kGet;
+        if(m=="PUT")return HttpMethod::kPut;
+        break;
+    case 4:
+        if(m=="POST")return HttpMethod::kPost;
+        if(m=="HEAD")return HttpMethod::kHead;
+        break;
+    case 5:
+        if(m=="PATCH")return HttpMethod::kPatch;
+        break;
+    case 6:
+        if(m=="DELETE")return HttpMethod::kDelete;
+        break;
+    case 7:
+        if(m=="OPTIONS")return HttpMethod::kOptions;
+        break;
+    }
+    return HttpMethod::kOther;
+}
+
+// ===================== 路径参数表 =====================
+// 路由匹配时填：name 指向路由器里注册的参数名（和路由表同寿命），value 指向 HttpRequest::path；
+// 和 HttpHeaders 一样是定长数组，匹配过程不分配
+class RouteParams{
+public:
+    typedef std::pair<std::string_view,std::string_view> Param;
+    typedef const Param* const_iterator;
+    static constexpr size_t kMaxParams=16;
+private:
+    Param params_[kMaxParams];
+    size_t size_=0;
+public:
+    const_iterator begin() const{return params_;}
+    const_iterator end() const{return params_+size_;}
+    size_t size() const{return size_;}
+    bool empty() const{return size_==0;}
+    //没有这个参数返回空视图
+    std::string_view get(std::string_view name) const{
+        for(size_t i=0;i<size_;++i){
+            if(params_[i].first==name)return params_[i].second;
+        }
+        return std::string_view();
+    }
+    bool add(std::string_view name,std::string_view value){
+        if(size_>=kMaxParams)return false;
+        params_[size_++]=Param(name,value);
+        return true;
+    }
+    //匹配回溯时丢掉后面几个
+    void truncate(size_t n){if(n<size_)size_=n;}
+    void clear(){size_=0;}
+    //只平移 value（name 不在请求的字节里）
+    void rebase(const char* from,const char* to){
+        for(size_t i=0;i<size_;++i){
+            std::string_view& v=params_[i].second;
+            if(v.data())v=std::string_view(to+(v.data()-from),v.size());
+        }
+    }
+};
+
+// ===================== HTTP请求结构体 =====================
+// 所有字段都是指向 Conn::inbuf 的视图：只在 handler 调用期间有效，handler 要留着用必须自己拷贝。
+// 要交给别的线程（blocking 路由）时先 own()：把整个请求拷一份，视图改指向这份拷贝
+struct HttpRequest{
+    std::string_view method;
+    HttpMethod method_id=HttpMethod::kOther;
+    std::string_view path;      //原样的 request-target（含 ?query）
+    std::string_view version;
+    HttpHeaders headers;
+    std::string_view body;
+    size_t content_length=0;
+    bool chunked=false;         //Transfer-Encoding: chunked（body 要用 HttpParser::parseBody 解码）
+    bool keep_alive=true;       //按版本 + Connection 头算好的
+    std::string_view raw;       //整个请求（请求行 + 头 + body）
+    RouteParams params;         //路由匹配出来的路径参数（/users/:id -> id）
+
+    //没有这个参数返回空视图；值没有做 %XX 解码
+    std::string_view param(std::string_view name) const{return params.get(name);}
+
+    void own(){
+        //body 可能不在 raw 里（chunked 解码后攒在别处），那就接在 raw 后面一起拷
+        std::string_view b=body;
+        bool inRaw=b.empty()||(b.data()>=raw.data()&&b.data()+b.size()<=raw.data()+raw.size());
+        std::shared_ptr<char[]> copy(new char[raw.size()+(inRaw?0:b.size())]);
+        std::memcpy(copy.get(),raw.data(),raw.size());
+        if(!inRaw){
+            std::memcpy(copy.get()+raw.size(),b.data(),b.size());
+            body=std::string_view();
+        }
+        rebase_(raw.data(),copy.get());
+        if(!inRaw)body=std::string_view(copy.get()+raw.size(),b.size());
+        storage_=std::move(copy);
+    }
+private:
+    std::shared_ptr<char[]> storage_;//own() 之后的底层字节；拷贝 HttpRequest 时共享，视图一直有效
+    std::string_view move_(std::string_view v,const char* from,const char* to){
+        return v.data()?std::string_view(to+(v.data()-from),v.size()):v;
+    }
+    void rebase_(const char* from,const char* to){
+        method=move_(method,from,to);
+        path=move_(path,from,to);
+        version=move_(version,from,to);
+        body=move_(body,from,to);
+        raw=move_(raw,from,to);
+        headers.rebase(from,to);
+        params.rebase(from,to);
+    }
+};
+
+// ===================== 增量 HTTP/1.1 请求解析器 =====================
+// 每个连接一个，状态跨多次 read 保留：
+// 1) 找头部结束的空行时记住已经扫描到哪里，新数据到了只扫新增部分，不从 inbuf 开头重来；
+//    扫描本身用 byteScan 的 SIMD 内核（找空行、找 ':' / '\n'、比较头名）
+// 2) 头部完整后一次遍历切出请求行和各个头，全部是指向缓冲区的 string_view，不分配内存
+// 3) Content-Length / Connection / Transfer-Encoding 在切分时顺手识别（大小写不敏感）
+// 4) 限制：头部（请求行 + 所有头）最多 kMaxHeaderBytes，头的个数最多 HttpHeaders::kMaxFields，超了返回 431
+// 5) body 可以整块等（parse），也可以边收边交（parseBody，chunked 只能这样读）
+//
+// 用法：parse 返回 kComplete 后 req 里的视图指向传进来的 data，调用方用完再把 consumed() 个字节从缓冲区丢掉；
+// 返回 kIncomplete 时缓冲区可以随便追加/搬家（解析器只记偏移，不记指针）。
+// 返回 kHead 表示头收全了、body 还没有（只报一次），req 里是头部视图，consumed() 是头部长度，调用方二选一：
+//   a) 继续调 parse 等整个 body 到齐（只限 Content-Length），之后返回 kComplete，和一次收全一样
+//   b) 把头部拷走（req.own()）、丢掉 consumed() 个字节，之后反复调 parseBody 拿 body 片段（chunked 必须走这条）
+class HttpParser{
+public:
+    enum Result{kIncomplete,kHead,kComplete,kError};
+    static constexpr size_t kMaxHeaderBytes=8192;
+    static constexpr size_t kMaxChunkLine=1024;    //块头一行（长度 + 扩展）的上限
+private:
+    enum State{kReadHead,kWaitBody,kReadLength,kChunkSize,kChunkData,kChunkEnd,kTrailer};
+    State state_=kReadHead;
+    size_t scanned_=0;          //kReadHead：这之前的字节里确定没有头部结束标记
+    size_t headerLen_=0;        //kWaitBody：头部长度（含空行）
+    size_t contentLength_=0;    //kWaitBody：还没收全的 body 长度
+    size_t remaining_=0;        //kReadLength / kChunkData：当前这段还差多少字节
+    size_t trailerBytes_=0;     //kTrailer：已经读过的 trailer 字节
+    size_t consumed_=0;
+    int error_=0;
+
+    Result fail_(int status){
+        error_=status;
+        return kError;
+    }
+    //从 scanned_ 开始找空行（"\n\n" 或 "\n\r\n"），找到返回头部长度，否则返回 0
+    size_t findHeaderEnd_(const char* data,size_t len){
+        size_t end=byteScan::headerEnd(data+scanned_,len-scanned_);
+        if(end)return scanned_+end;
+        //最后两个字节里的换行后面可能还没到齐，下次从那里重新判断
+        if(len>scanned_+2)scanned_=len-2;
+        return 0;
+    }
+    static std::string_view trim_(std::string_view v){
+        while(!v.empty()&&(v.front()==' '||v.front()=='\t'))v.remove_prefix(1);
+        while(!v.empty()&&(v.back()==' '||v.back()=='\t'||v.back()=='\r'))v.remove_suffix(1);
+        return v;
+    }
+    //逗号分隔的 token 列表里有没有 token（Connection: keep-alive, Upgrade）
+    static bool hasToken_(std::string_view list,std::string_view token){
+        while(!list.empty()){
+            size_t comma=list.find(',');
+            std::string_view item=trim_(list.substr(0,comma));
+            if(HttpHeaders::iequals(item,token))return true;
+            if(comma==std::string_view::npos)break;
+            list.remove_prefix(comma+1);
+        }
+        return false;
+    }
+    //块长度：十六进制，最多 15 位（不会溢出）
+    static bool parseChunkSize_(std::string_view v,size_t& out){
+        if(v.empty()||v.size()>15)return false;
+        size_t n=0;
+        for(char ch:v){
+            int d;
+            if(ch>='0'&&ch<='9')d=ch-'0';
+            else if(ch>='a'&&ch<='f')d=ch-'a'+10;
+            else if(ch>='A'&&ch<='F')d=ch-'A'+10;
+            else return false;
+            n=n*16+static_cast<size_t>(d);
+        }
+        out=n;
+        return true;
+    }
+    void finish_(){
+        state_=kReadHead;
+        scanned_=0;
+    }
+    static bool parseLength_(std::string_view v,size_t& out){
+        if(v.empty()||v.size()>18)return false;
+        size_t n=0;
+        for(char ch:v){
+            if(ch<'0'||ch>'9')return false;
+            n=n*10+static_cast<size_t>(ch-'0');
+        }
+        out=n;
+        return true;
+    }
+    //切分请求行和头部：data[0, len) 是完整的头部（含结尾空行）
+    Result parseHead_(const char* data,size_t len,HttpRequest& req){
+        std::string_view head(data,len);
+        req.headers.clear();
+        req.params.clear();
+        req.content_length=0;
+        req.chunked=false;
+        req.body=std::string_view();
+
+        //请求行之前的空行忽略（RFC 7230 3.5）
+        while(!head.empty()&&(head.front()=='\r'||head.front()=='\n'))head.remove_prefix(1);
+        size_t eol=head.find('\n');
+        std::string_view line=trim_(head.substr(0,eol));
+        head.remove_prefix(eol+1);
+
+        size_t sp1=line.find(' ');
+        size_t sp2=sp1==std::string_view::npos?sp1:line.find(' ',sp1+1);
+        if(sp1==0||sp2==std::string_view::npos||sp2==sp1+1)return fail_(400);
+        req.method=line.substr(0,sp1);
+        req.method_id=parseMethod(req.method);
+        req.path=line.substr(sp1+1,sp2-sp1-1);
+        req.version=line.substr(sp2+1);
+        if(req.version.size()!=8||req.version.compare(0,7,"HTTP/1.")!=0)return fail_(400);
+        bool http10=req.version[7]=='0';
+
+        bool has_length=false;
+        bool conn_close=false,conn_keep=false;
+        while(!head.empty()){
+            if(head.front()=='\n'||(head.front()=='\r'&&head.size()>1&&head[1]=='\n'))break;//结尾空行
+
+            //一次扫描同时找 ':' 和 '\n'：先碰到换行说明这一行没有冒号
+            size_t colon=byteScan::findAnyOf(head.data(),head.size(),":\n",2);
+            if(colon==0||colon==head.size()||head[colon]!=':')return fail_(400);
+            std::string_view name=head.substr(0,colon);
+            if(name.back()==' '||name.back()=='\t')return fail_(400);//冒号前不允许空白（RFC 7230 3.2.4）
+            head.remove_prefix(colon+1);
+            eol=byteScan::findAnyOf(head.data(),head.size(),"\n",1);
+            std::string_view value=trim_(head.substr(0,eol));
+            head.remove_prefix(eol==head.size()?eol:eol+1);
+            if(!req.headers.add(name,value))return fail_(431);
+
+            //常用头按长度先筛一下再比较，大多数头一次长度比较就排除了
+            if(name.size()==14&&HttpHeaders::iequals(name,"content-length")){
+                size_t n;
+                if(!parseLength_(value,n)||(has_length&&n!=req.content_length))return fail_(400);
+                req.content_length=n;
+                has_length=true;
+            }else if(name.size()==10&&HttpHeaders::iequals(name,"connection")){
+                conn_close=conn_close||hasToken_(value,"close");
+                conn_keep=conn_keep||hasToken_(value,"keep-alive");
+            }else if(name.size()==17&&HttpHeaders::iequals(name,"transfer-encoding")){
+                //只认单独的 chunked；gzip 之类的传输编码不支持
+                if(req.chunked||!HttpHeaders::iequals(value,"chunked"))return fail_(501);
+                req.chunked=true;
+            }
+        }
+        //两个都有是请求走私的典型手法（RFC 7230 3.3.3），直接拒绝
+        if(req.chunked&&has_length)return fail_(400);
+        // HTTP/1.1 默认 keep-alive；HTTP/1.0 默认 close
+        req.keep_alive=conn_close?false:(http10?conn_keep:true);
+        return kComplete;
+    }
+public:
+    Result parse(const char* data,size_t len,HttpRequest& req){
+        if(error_)return kError;
+        if(state_==kReadHead){
+            size_t end=findHeaderEnd_(data,len<kMaxHeaderBytes?len:kMaxHeaderBytes);
+            if(end==0){
+                if(len>=kMaxHeaderBytes)return fail_(431);
+                return kIncomplete;
+            }
+            if(parseHead_(data,end,req)!=kComplete)return kError;
+            headerLen_=end;
+            contentLength_=req.content_length;
+            if(req.chunked||len<headerLen_+contentLength_){
+                state_=req.chunked?kChunkSize:kWaitBody;
+                req.raw=std::string_view(data,headerLen_);
+                consumed_=headerLen_;
+                return kHead;
+            }
+        }else if(state_==kWaitBody){
+            //body 还没收全时不碰 req；收全了再把头部切一遍（头部早就确认过是完整的）
+            if(len<headerLen_+contentLength_)return kIncomplete;
+            if(parseHead_(data,headerLen_,req)!=kComplete)return kError;
+        }else{
+            return fail_(500);//已经切到 parseBody 了，不能再回头整块等
+        }
+        req.body=std::string_view(data+headerLen_,contentLength_);
+        req.raw=std::string_view(data,headerLen_+contentLength_);
+        consumed_=headerLen_+contentLength_;
+        finish_();
+        return kComplete;
+    }
+    //kHead 之后逐段读 body：data 从 body（或上次没吃完的地方）开始。
+    //frag 是解码后的一段 body（指向 data 内部，可能为空），consumed() 是这次吃掉的原始字节（含块头 / CRLF / trailer）。
+    //返回 kIncomplete：body 还没完，consumed() 为 0 说明要等更多数据；kComplete：body 结束（frag 可能是最后一段）
+    Result parseBody(const char* data,size_t len,std::string_view& frag){
+        frag=std::string_view();
+        consumed_=0;
+        if(error_)return kError;
+        if(state_==kWaitBody){//调用方放弃整块等，改成流式读
+            state_=kReadLength;
+            remaining_=contentLength_;
+        }
+        size_t pos=0;
+        while(true){
+            switch(state_){
+            case kReadLength:{
+                size_t n=len-pos<remaining_?len-pos:remaining_;
+                frag=std::string_view(data+pos,n);
+                remaining_-=n;
+                consumed_=pos+n;
+                if(remaining_>0)return kIncomplete;
+                finish_();
+                return kComplete;
+            }
+            case kChunkSize:{
+                //块头：十六进制长度 [;扩展]\r\n
+                size_t nl=pos+byteScan::findAnyOf(data+pos,len-pos,"\n",1);
+                if(nl==len){
+                    if(len-pos>kMaxChunkLine)return fail_(400);
+                    consumed_=pos;
+                    return kIncomplete;
+                }
+                if(nl-pos>kMaxChunkLine)return fail_(400);
+                std::string_view line(data+pos,nl-pos);
+                line=trim_(line.substr(0,line.find(';')));
+                size_t size;
+                if(!parseChunkSize_(line,size))return fail_(400);
+                pos=nl+1;
+                if(size==0){
+                    state_=kTrailer;
+                    trailerBytes_=0;
+                }else{
+                    state_=kChunkData;
+                    remaining_=size;
+                }
+                break;
+            }
+            case kChunkData:{
+                size_t n=len-pos<remaining_?len-pos:remaining_;
+                frag=std::string_view(data+pos,n);
+                remaining_-=n;
+                consumed_=pos+n;
+                if(remaining_==0)state_=kChunkEnd;
+                return kIncomplete;//先把这段交出去
+            }
+            case kChunkEnd:{
+                //块数据后面的 CRLF
+                if(pos<len&&data[pos]=='\n'){
+                    pos+=1;
+                }else if(pos+1<len&&data[pos]=='\r'&&data[pos+1]=='\n'){
+                    pos+=2;
+                }else if(pos==len||(pos+1==len&&data[pos]=='\r')){
+                    consumed_=pos;
+                    return kIncomplete;
+                }else{
+                    return fail_(400);
+                }
+                state_=kChunkSize;
+                break;
+            }
+            case kTrailer:{
+                //最后一块后面的 trailer 字段直接丢掉，读到空行为止
+                size_t nl=pos+byteScan::findAnyOf(data+pos,len-pos,"\n",1);
+                size_t lineLen=nl==len?len-pos:nl-pos+1;
+                if(trailerBytes_+lineLen>kMaxHeaderBytes)return fail_(431);
+                if(nl==len){
+                    consumed_=pos;
+                    return kIncomplete;
+                }
+                trailerBytes_+=lineLen;
+                bool empty=lineLen==1||(lineLen==2&&data[pos]=='\r');
+                pos=nl+1;
+                if(empty){
+                    consumed_=pos;
+                    finish_();
+                    return kComplete;
+                }
+                break;
+            }
+            default:
+                return fail_(500);//没有在读 body
+            }
+        }
+    }
+    //kWaitBody 整块等的时候，请求总共要多少字节（读缓冲区按它放宽上限）；别的状态返回 0
+    size_t bytesNeeded() const{return state_==kWaitBody?headerLen_+contentLength_:0;}
+    //上一次 parse / parseBody 吃掉了多少字节
+    size_t consumed() const{return consumed_;}
+    //kError 时应该回的状态码（400 / 431 / 501）
+    int errorStatus() const{return error_;}
+    void reset(){
+        state_=kReadHead;
+        scanned_=headerLen_=contentLength_=remaining_=trailerBytes_=consumed_=0;
+        error_=0;
+    }
+};
+#endif
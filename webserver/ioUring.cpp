@@ -0,0 +1,238 @@
+#include "ioUring.hpp"
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+static int sys_io_uring_setup(unsigned entries, io_uring_params* p) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, p));
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+// 先关环再解除映射：内核可能还在往缓冲区里写
+IoUring::~IoUring() {
+    if (m_ring_fd >= 0) ::close(m_ring_fd);
+    if (m_sqes) munmap(m_sqes, m_sqes_size);
+    if (m_cq_ptr && m_cq_ptr != m_sq_ptr) munmap(m_cq_ptr, m_cq_size);
+    if (m_sq_ptr) munmap(m_sq_ptr, m_sq_size);
+    if (m_bufs) munmap(m_bufs, m_bufs_size);
+}
+
+// ===================== 建环 =====================
+bool IoUring::init(unsigned entries) {
+    io_uring_params p;
+    std::memset(&p, 0, sizeof(p));
+    // COOP_TASKRUN：完成事件等我们下次进内核时再处理，不用 IPI 打断 loop 线程
+    // （不用 SINGLE_ISSUER：环在 start() 里建，却由 loop 线程提交）
+    p.flags = IORING_SETUP_COOP_TASKRUN;
+    m_ring_fd = sys_io_uring_setup(entries, &p);
+    if (m_ring_fd < 0 && errno == EINVAL) {
+        p.flags = 0; // 老内核不认识这些 flag，退回默认
+        m_ring_fd = sys_io_uring_setup(entries, &p);
+    }
+    if (m_ring_fd < 0) return false;
+
+    m_sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    m_cq_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+        if (m_cq_size > m_sq_size) m_sq_size = m_cq_size;
+        m_cq_size = m_sq_size;
+    }
+
+    m_sq_ptr = mmap(nullptr, m_sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    m_ring_fd, IORING_OFF_SQ_RING);
+    if (m_sq_ptr == MAP_FAILED) { m_sq_ptr = nullptr; return false; }
+
+    if (single_mmap) {
+        m_cq_ptr = m_sq_ptr;
+    } else {
+        m_cq_ptr = mmap(nullptr, m_cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        m_ring_fd, IORING_OFF_CQ_RING);
+        if (m_cq_ptr == MAP_FAILED) { m_cq_ptr = nullptr; return false; }
+    }
+
+    m_sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      m_ring_fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) return false;
+    m_sqes = static_cast<io_uring_sqe*>(sqes);
+
+    char* sq = static_cast<char*>(m_sq_ptr);
+    m_sq_head = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+    m_sq_tail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    m_sq_mask = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    m_sq_entries = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_entries);
+    m_sq_array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+    m_sqe_tail = *m_sq_tail;
+
+    char* cq = static_cast<char*>(m_cq_ptr);
+    m_cq_head = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    m_cq_tail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    m_cq_mask = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    m_cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+    return true;
+}
+
+// ===================== SQE =====================
+io_uring_sqe* IoUring::getSqe() {
+    io_uring_sqe* sqe = tryGetSqe();
+    if (!sqe) {
+        submit(); // SQ 满了：先交给内核腾位置
+        sqe = tryGetSqe();
+    }
+    return sqe;
+}
+
+io_uring_sqe* IoUring::tryGetSqe() {
+    unsigned head = __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+    if (m_sqe_tail - head >= m_sq_entries) return nullptr;
+    io_uring_sqe* sqe = &m_sqes[m_sqe_tail & m_sq_mask];
+    std::memset(sqe, 0, sizeof(*sqe));
+    ++m_sqe_tail;
+    return sqe;
+}
+
+// 把本地准备好的 SQE 发布给内核（写 array + release tail），返回待提交个数
+unsigned IoUring::flushSq() {
+    unsigned tail = *m_sq_tail;
+    unsigned to_submit = m_sqe_tail - tail;
+    for (unsigned t = tail; t != m_sqe_tail; ++t) {
+        m_sq_array[t & m_sq_mask] = t & m_sq_mask;
+    }
+    __atomic_store_n(m_sq_tail, m_sqe_tail, __ATOMIC_RELEASE);
+    return to_submit;
+}
+
+int IoUring::submitAndWait(unsigned wait_nr) {
+    requeueBufs(); // 之前没交出去的缓冲区跟这一批一起提交
+    unsigned to_submit = flushSq();
+    if (to_submit == 0 && wait_nr == 0) return 0;
+    unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+    int ret;
+    do {
+        ret = sys_io_uring_enter(m_ring_fd, to_submit, wait_nr, flags);
+    } while (ret < 0 && errno == EINTR && wait_nr == 0);
+    if (ret >= 0) requeueBufs(); // 提交前 SQ 是满的：现在腾出位置了，跟下一批走
+    return ret;
+}
+
+// ===================== 提供缓冲区 =====================
+// 用 PROVIDE_BUFFERS 一次性把整块内存交给内核，等它完成再返回（为什么不用缓冲区环见头文件）
+bool IoUring::setupProvidedBufs(uint16_t bgid, unsigned count, unsigned buf_size) {
+    if (count == 0 || count > 32768) return false;
+
+    m_bufs_size = static_cast<size_t>(count) * buf_size;
+    void* bufs = mmap(nullptr, m_bufs_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (bufs == MAP_FAILED) { m_bufs = nullptr; return false; }
+    m_bufs = static_cast<char*>(bufs);
+    m_buf_size = buf_size;
+    m_bgid = bgid;
+
+    io_uring_sqe* sqe = getSqe();
+    if (!sqe) return false;
+    prepProvide(sqe, 0, count);
+    if (submitAndWait(1) < 0) return false;
+    bool ok = false;
+    forEachCqe([&ok](const io_uring_cqe& cqe) { if (cqe.user_data == 0 && cqe.res >= 0) ok = true; });
+    return ok;
+}
+
+// 从 bid 开始的 nr 个连续缓冲区交给内核；单个归还时成功的 CQE 直接跳过，不占 CQ
+void IoUring::prepProvide(io_uring_sqe* sqe, uint16_t bid, unsigned nr) {
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = static_cast<int>(nr);
+    sqe->addr = reinterpret_cast<uint64_t>(bufAddr(bid));
+    sqe->len = m_buf_size;
+    sqe->off = bid;
+    sqe->buf_group = m_bgid;
+    sqe->user_data = 0;
+    if (nr == 1) sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+}
+
+// 归还只是多准备一个 SQE，跟着下一次 enter 一起提交。
+// 拿不到 SQE 就记进 m_pending_bids：直接丢掉的话这块缓冲区再也回不到组里，组会越用越小
+void IoUring::recycleBuf(uint16_t bid) {
+    io_uring_sqe* sqe = getSqe();
+    if (!sqe) {
+        m_pending_bids.push_back(bid);
+        return;
+    }
+    prepProvide(sqe, bid, 1);
+    m_recycled = true;
+}
+
+// 用 SQ 里的空位补交记下来的缓冲区（不触发提交：这里就是从提交路径上调的）
+void IoUring::requeueBufs() {
+    while (!m_pending_bids.empty()) {
+        io_uring_sqe* sqe = tryGetSqe();
+        if (!sqe) return;
+        prepProvide(sqe, m_pending_bids.back(), 1);
+        m_pending_bids.pop_back();
+        m_recycled = true;
+    }
+}
+
+// ===================== SQE 准备 =====================
+void IoUring::prepAcceptMultishot(io_uring_sqe* sqe, int fd, uint64_t user_data) {
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = user_data;
+}
+
+void IoUring::prepRecvMultishot(io_uring_sqe* sqe, int fd, uint16_t bgid, uint64_t user_data) {
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = bgid;
+    sqe->user_data = user_data;
+}
+
+void IoUring::prepSend(io_uring_sqe* sqe, int fd, const void* buf, size_t len, int flags, uint64_t user_data) {
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buf);
+    sqe->len = static_cast<uint32_t>(len);
+    sqe->msg_flags = static_cast<uint32_t>(flags);
+    sqe->user_data = user_data;
+}
+
+// msg 和它指向的 iovec 要一直有效到 CQE 回来（内核可能在提交之后才读）
+void IoUring::prepSendmsg(io_uring_sqe* sqe, int fd, const struct msghdr* msg, int flags, uint64_t user_data) {
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(msg);
+    sqe->len = 1;
+    sqe->msg_flags = static_cast<uint32_t>(flags);
+    sqe->user_data = user_data;
+}
+
+void IoUring::prepPollMultishot(io_uring_sqe* sqe, int fd, uint32_t poll_mask, uint64_t user_data) {
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->poll32_events = poll_mask;
+    sqe->user_data = user_data;
+}
+
+void IoUring::prepShutdown(io_uring_sqe* sqe, int fd, int how, uint64_t user_data) {
+    sqe->opcode = IORING_OP_SHUTDOWN;
+    sqe->fd = fd;
+    sqe->len = static_cast<uint32_t>(how);
+    sqe->user_data = user_data;
+}
+
+void IoUring::prepCancel(io_uring_sqe* sqe, uint64_t target, uint64_t user_data) {
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = target;
+    sqe->user_data = user_data;
+}
@@ -0,0 +1,113 @@
+#ifndef IOURING_HPP
+#define IOURING_HPP
+
+#include <linux/io_uring.h>
+#include <cstdint>
+#include <cstddef>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <vector>
+
+// ===================== io_uring 的最小封装 =====================
+// 沙箱/发行版里不一定装了 liburing，这里直接用内核 ABI（io_uring_setup/enter 两个系统调用）。
+// 只封装 webserver 用得到的部分：
+// 1) SQ/CQ 两个环的 mmap、取 SQE、批量提交、遍历 CQE
+// 2) 提供缓冲区（provided buffers）：给 multishot recv 用，内核自己挑缓冲区，
+//    归还时多一个 PROVIDE_BUFFERS SQE，跟着下一次 enter 一起提交。
+//    没有用 5.19 的缓冲区环（IORING_REGISTER_PBUF_RING，归还只要写共享内存）：目标内核上注册能成功，
+//    但 recv 一直 -ENOBUFS，而且注册之后进程自己的内存会被写坏（往环里写 SEGV，或者写到相邻的 SQ 环上），
+//    用 IOU_PBUF_RING_MMAP 让内核分配也一样。坏在注册这一步，启动时先试再退回也不安全，所以只留这一种
+// user_data == 0 留给 IoUring 内部用（归还缓冲区），调用方的 CQE 处理里直接忽略即可
+//
+// 线程模型：一个 IoUring 只能被一个线程使用（每个 EventLoop 一个）
+class IoUring {
+public:
+    IoUring() = default;
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // entries：SQ 深度（CQ 是它的 2 倍）；内核不支持或被禁用时返回 false
+    bool init(unsigned entries);
+    bool valid() const { return m_ring_fd >= 0; }
+
+    // 取一个空闲 SQE（已清零）；SQ 满时先把已有的提交掉
+    io_uring_sqe* getSqe();
+
+    // 提交所有未提交的 SQE，并至少等 wait_nr 个 CQE
+    int submitAndWait(unsigned wait_nr);
+    int submit() { return submitAndWait(0); }
+
+    // 遍历当前所有 CQE，处理完统一推进 head；返回处理个数
+    template<typename F>
+    unsigned forEachCqe(F&& f) {
+        unsigned head = *m_cq_head;
+        unsigned tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+        unsigned n = 0;
+        while (head != tail) {
+            f(m_cqes[head & m_cq_mask]);
+            ++head;
+            ++n;
+        }
+        __atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+        return n;
+    }
+
+    // ===================== 提供缓冲区 =====================
+    // count 块、每块 buf_size 字节，整块内存由 IoUring 持有
+    bool setupProvidedBufs(uint16_t bgid, unsigned count, unsigned buf_size);
+    char* bufAddr(uint16_t bid) const { return m_bufs + static_cast<size_t>(bid) * m_buf_size; }
+    // 用完的缓冲区还给内核；SQ 满了拿不到 SQE 时先记下来，下一次提交时补上，缓冲区不会丢
+    void recycleBuf(uint16_t bid);
+    // 上次调用以来有没有缓冲区还给内核（recv 拿到 -ENOBUFS 的连接等它再重挂）
+    bool takeRecycled() { bool r = m_recycled; m_recycled = false; return r; }
+
+    // ===================== 常用 SQE 准备函数 =====================
+    static void prepAcceptMultishot(io_uring_sqe* sqe, int fd, uint64_t user_data);
+    static void prepRecvMultishot(io_uring_sqe* sqe, int fd, uint16_t bgid, uint64_t user_data);
+    static void prepSend(io_uring_sqe* sqe, int fd, const void* buf, size_t len, int flags, uint64_t user_data);
+    static void prepSendmsg(io_uring_sqe* sqe, int fd, const struct msghdr* msg, int flags, uint64_t user_data);
+    static void prepPollMultishot(io_uring_sqe* sqe, int fd, uint32_t poll_mask, uint64_t user_data);
+    static void prepShutdown(io_uring_sqe* sqe, int fd, int how, uint64_t user_data);
+    // 取消 user_data 为 target 的在途请求（multishot 的也行）
+    static void prepCancel(io_uring_sqe* sqe, uint64_t target, uint64_t user_data);
+
+private:
+    int m_ring_fd = -1;
+
+    // SQ
+    void* m_sq_ptr = nullptr;
+    size_t m_sq_size = 0;
+    unsigned* m_sq_head = nullptr;
+    unsigned* m_sq_tail = nullptr;
+    unsigned* m_sq_array = nullptr;
+    unsigned m_sq_mask = 0;
+    unsigned m_sq_entries = 0;
+    io_uring_sqe* m_sqes = nullptr;
+    size_t m_sqes_size = 0;
+    unsigned m_sqe_tail = 0;      // 本地已准备的 tail（还没发布给内核）
+
+    // CQ
+    void* m_cq_ptr = nullptr;
+    size_t m_cq_size = 0;
+    unsigned* m_cq_head = nullptr;
+    unsigned* m_cq_tail = nullptr;
+    unsigned m_cq_mask = 0;
+    io_uring_cqe* m_cqes = nullptr;
+
+    // 提供缓冲区
+    char* m_bufs = nullptr;
+    size_t m_bufs_size = 0;
+    unsigned m_buf_size = 0;
+    uint16_t m_bgid = 0;
+    std::vector<uint16_t> m_pending_bids; // 归还时 SQ 满了没交出去的缓冲区
+    bool m_recycled = false;
+
+    io_uring_sqe* tryGetSqe();        // 和 getSqe 一样，但 SQ 满时直接返回 nullptr，不提交
+    unsigned flushSq();
+    void prepProvide(io_uring_sqe* sqe, uint16_t bid, unsigned nr);
+    void requeueBufs();
+};
+
+#endif // IOURING_HPP
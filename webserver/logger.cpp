@@ -2,6 +2,7 @@
 #include <iomanip>
 #include <sstream>
 #include<iostream>
+#include "../thread_learning/cpu_topology.hpp"
 
 Logger::Logger() : m_logLevel(LogLevel::INFO), m_isAsync(false),m_logQueue(nullptr),m_writeThread(nullptr) {}
 Logger::~Logger(){
@@ -46,6 +47,7 @@ void Logger::init(const std::string& logFile) {
 }
 //消费者线程
 void Logger::asyncWriteLog() {
+    CpuTopology::nameCurrentThread("logger");
     std::string singleLog;
     //队列有文件就写
     while(m_logQueue->pop(singleLog)){
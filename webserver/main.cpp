@@ -1,6 +1,10 @@
 #include "thread_pool_webserver.hpp"
+#include "../thread_learning/simple_thread_pool.hpp"
 #include "logger.hpp"
 #include <iostream>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
 #include <signal.h>
 #include <time.h>
 #include <unistd.h>
@@ -72,8 +76,20 @@ bool daemonize() {
     return true;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     int port = 8080; // 服务器端口
+    // 可选参数：事件循环个数（./webserver 0 表示每个核心一个 loop，默认 1 个 loop + 线程池）
+    int loop_num = argc > 1 ? std::atoi(argv[1]) : 1;
+    // 可选参数：分发方式 inline / pool（默认 auto：单 loop 用线程池，多 loop 就地处理）
+    std::string dispatch = argc > 2 ? argv[2] : "auto";
+    // 可选参数：I/O 后端 epoll / uring（默认 epoll；uring 不可用时自动退回 epoll）
+    std::string backend = argc > 3 ? argv[3] : "epoll";
+    // 可选参数：监听方式 reuseport / shared（shared：所有 loop 共用一个监听 socket + EPOLLEXCLUSIVE）
+    std::string listen_mode = argc > 4 ? argv[4] : "reuseport";
+    // 可选参数：线程池调度方式 shared / steal（steal：每个 worker 一个 Chase-Lev 队列 + 工作窃取）
+    std::string pool_mode = argc > 5 ? argv[5] : "shared";
+    // 可选参数：绑核方式 none / core / node（core：loop 和线程池 worker 各绑一个 CPU；node：worker 限制在 NUMA 节点内）
+    std::string pin = argc > 6 ? argv[6] : "none";
      // 询问用户是否后台运行
     std::cout << "Do you want to run the server in background? (y/n): ";
     char choice;
@@ -107,8 +123,31 @@ int main() {
     }
     
     // 创建服务器实例
-    SimpleWebServer server(port);
+    SimpleWebServer server(port, loop_num);
     g_server = &server;
+    if (dispatch == "inline") {
+        server.setDispatchMode(SimpleWebServer::DispatchMode::Inline);
+    } else if (dispatch == "pool") {
+        server.setDispatchMode(SimpleWebServer::DispatchMode::ThreadPool);
+    }
+    if (backend == "uring") {
+        server.setBackend(SimpleWebServer::IoBackend::IoUring);
+    }
+    if (listen_mode == "shared") {
+        server.setListenMode(SimpleWebServer::ListenMode::Shared);
+    }
+    if (pool_mode == "steal" || pin != "none") {
+        // 线程池是第一次 getInstance 时建的：在服务器投递任务之前先按工作窃取方式建好。
+        // 绑核时也要先建：不然 worker 在某个已绑核的 loop 线程里被创建，会继承它的单 CPU 亲和性
+        SimpleThreadPool::Options opts;
+        if (pool_mode == "steal") opts.mode = SimpleThreadPool::Mode::WorkStealing;
+        if (pin == "core") opts.affinity = SimpleThreadPool::Affinity::Core;
+        else if (pin == "node") opts.affinity = SimpleThreadPool::Affinity::Node;
+        SimpleThreadPool::getInstance(opts);
+    }
+    if (pin != "none") {
+        server.setPinLoops(true);
+    }
     
     // 注册信号处理函数，用于优雅地停止服务器
     struct sigaction sa;
@@ -138,20 +177,71 @@ int main() {
                    "</body></html>";
     });
     
-    server.get("/hello", [](const HttpRequest& req, HttpResponse& res) {
-        Logger::getInstance().info("Received GET request for /hello");
-        res.status_code = 200;
-        res.status_msg = "OK";
-        res.body = "<html><body><h1>Hello, World!</h1></body></html>";
-    });
+    // 固定内容：响应注册时就序列化好，带 ETag，If-None-Match 命中回 304
+    server.getPrebuilt("/hello", "text/html; charset=utf-8", "<html><body><h1>Hello, World!</h1></body></html>",
+                       {{"Cache-Control", "max-age=60"}});
     
     server.post("/echo", [](const HttpRequest& req, HttpResponse& res) {
         Logger::getInstance().info("Received POST request for /echo");
         res.status_code = 200;
         res.status_msg = "OK";
-        res.body = "<html><body><h1>Echo POST Data:</h1><pre>" + req.body + "</pre></body></html>";
+        res.body = "<html><body><h1>Echo POST Data:</h1><pre>" + std::string(req.body) + "</pre></body></html>";
     });
     
+    // 路径参数：/users/42/posts/7 -> id = 42, post = 7（string_view 指向请求本身，没有拷贝）
+    server.get("/users/:id/posts/:post", [](const HttpRequest& req, HttpResponse& res) {
+        res.headers["Content-Type"] = "text/plain";
+        res.body = "user " + std::string(req.param("id")) + ", post " + std::string(req.param("post")) + "\n";
+    });
+
+    // 流式上传：body 边到边处理（这里只统计字节数和校验和），多大的上传都不会攒在内存里；支持 chunked
+    server.postStream("/upload", [](const HttpRequest& /*req*/) {
+        Logger::getInstance().info("Received streaming POST request for /upload");
+        struct Stat {
+            size_t bytes = 0;
+            uint32_t sum = 0;
+        };
+        auto st = std::make_shared<Stat>();
+        BodySink sink;
+        sink.on_data = [st](std::string_view data) {
+            st->bytes += data.size();
+            for (unsigned char ch : data) st->sum = st->sum * 31 + ch;
+        };
+        sink.on_end = [st](HttpResponse& res) {
+            res.headers["Content-Type"] = "text/plain";
+            res.body = "received " + std::to_string(st->bytes) + " bytes, checksum " + std::to_string(st->sum) + "\n";
+        };
+        return sink;
+    });
+
+    // 流式响应：边生成边发（chunked），客户端读得慢时 producer 自动暂停，整个响应不会同时待在内存里
+    server.get("/stream", [](const HttpRequest& /*req*/, HttpResponse& res) {
+        Logger::getInstance().info("Received GET request for /stream");
+        res.headers["Content-Type"] = "text/plain";
+        auto next = std::make_shared<int>(0);
+        res.producer = [next](ChunkWriter& w) {
+            static const int kLines = 1000000;
+            std::string block;
+            for (int end = std::min(*next + 1000, kLines); *next < end; ++*next) {
+                block += "line " + std::to_string(*next) + "\n";
+            }
+            w.write(block);
+            return *next < kLines;
+        };
+    });
+
+    // 阻塞路由：模拟一次 200 ms 的慢查询，交给线程池的 Batch 通道执行。
+    // 一批 /slow 排着队时，线程池里的普通请求处理（Interactive 通道）照样按权重先出队；排队超过 2 秒的直接回 503
+    server.setBlockingQueueTimeout(2000);
+    server.get("/slow", [](const HttpRequest& /*req*/, HttpResponse& res) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        res.headers["Content-Type"] = "text/plain";
+        res.body = "done\n";
+    }, true);
+
+    // 静态文件：/static/xxx -> 运行目录下的 static/xxx（sendfile 发送，支持 Range / If-Modified-Since）
+    server.serveStatic("/static/", "static");
+
    
     // 启动服务器
     server.start();
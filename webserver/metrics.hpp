@@ -0,0 +1,276 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+#include<atomic>
+#include<chrono>
+#include<memory>
+#include<mutex>
+#include<string>
+#include<vector>
+#include<cstdint>
+#include<cstddef>
+#include<cstdio>
+#include<time.h>
+#if defined(__x86_64__)||defined(__i386__)
+#include<x86intrin.h>
+#endif
+// ===================== 分阶段耗时直方图 + 计数器 =====================
+// 1) 每个线程一份 ThreadMetrics（thread_local 指针，第一次用时登记到 Registry），记录时不加锁、不共享缓存行：
+//    单写者，用 relaxed 的 load + store 自增（不是 fetch_add，没有 lock 前缀），读的一方不会读到撕裂的值
+// 2) 直方图是 HDR 风格的对数-线性分桶：每个 2 的幂区间再等分 16 份，相对误差不超过 1/16，
+//    覆盖 0 ~ 2^40 ns（约 18 分钟），608 个桶。记录 = 算下标（一次 clz）+ 两次自增
+// 3) 时间用 TSC（rdtsc，大约是 steady_clock::now 的一半），启动时对着 steady_clock 校准一次，记录时乘一个定点系数换成纳秒；
+//    非 x86 用 CLOCK_MONOTONIC。假设 TSC 恒速（constant_tsc，近十几年的 x86 都是）
+// 4) 汇总（snapshot）时才加锁把所有线程的桶加起来；线程退出后它的数据留在 Registry 里，不丢
+// 5) renderPrometheus 输出 Prometheus 文本格式：直方图按一组固定的 le（1us ~ 10s）折算，另外给出几个分位数
+namespace metrics{
+
+enum Stage{
+    kAcceptToFirstByte, //accept 到读到第一个字节
+    kRead,              //一次读事件里 readv 到 EAGAIN
+    kParse,             //一次 HttpParser::parse
+    kHandler,           //路由 handler
+    kSerialize,         //压缩 + 组包进 outbuf
+    kWrite,             //一次写到 EAGAIN / 一个 io_uring SEND 从提交到完成
+    kStageCount
+};
+enum Counter{
+    kBytesIn,
+    kBytesOut,
+    kRequests,
+    kKeepAliveReuse,    //同一个连接上第二个及以后的请求
+    kRearms,            //epoll_ctl(MOD) 次数
+    kCounterCount
+};
+inline const char* stageName(int s){
+    static const char* const kNames[kStageCount]={"accept_to_first_byte","read","parse","handler","serialize","write"};
+    return kNames[s];
+}
+
+// ===================== 时钟 =====================
+inline uint64_t nowTicks(){
+#if defined(__x86_64__)||defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return static_cast<uint64_t>(ts.tv_sec)*1000000000ull+static_cast<uint64_t>(ts.tv_nsec);
+#endif
+}
+
+//ticks -> ns 的 32.32 定点系数；第一次调用时校准（x86 上要花 10 ms）
+inline uint64_t tickMult(){
+    static const uint64_t mult=[]{
+#if defined(__x86_64__)||defined(__i386__)
+        auto t0=std::chrono::steady_clock::now();
+        uint64_t c0=__rdtsc();
+        while(std::chrono::steady_clock::now()-t0<std::chrono::milliseconds(10)){}
+        uint64_t c1=__rdtsc();
+        double ns=std::chrono::duration<double,std::nano>(std::chrono::steady_clock::now()-t0).count();
+        if(c1<=c0)return uint64_t(1)<<32;
+        return static_cast<uint64_t>(ns/static_cast<double>(c1-c0)*4294967296.0);
+#else
+        return uint64_t(1)<<32;
+#endif
+    }();
+    return mult;
+}
+inline uint64_t ticksToNs(uint64_t ticks){
+    return static_cast<uint64_t>((static_cast<unsigned __int128>(ticks)*tickMult())>>32);
+}
+//从 start（nowTicks 的返回值）到现在过了多少纳秒
+inline uint64_t elapsedNs(uint64_t start){
+    uint64_t now=nowTicks();
+    return now>start?ticksToNs(now-start):0;
+}
+
+// ===================== 直方图 =====================
+class Histogram{
+public:
+    static constexpr int kSubBits=4;
+    static constexpr uint64_t kSub=1u<<kSubBits;
+    static constexpr int kMaxBits=40;
+    static constexpr size_t kBuckets=(kMaxBits-kSubBits+1)*kSub;
+
+    static size_t index(uint64_t v){
+        if(v>=(uint64_t(1)<<kMaxBits))v=(uint64_t(1)<<kMaxBits)-1;
+        if(v<kSub)return static_cast<size_t>(v);
+        int msb=63-__builtin_clzll(v);
+        int shift=msb-kSubBits;
+        return static_cast<size_t>(shift+1)*kSub+static_cast<size_t>((v>>shift)&(kSub-1));
+    }
+    //桶 i 里最大的值
+    static uint64_t upperBound(size_t i){
+        if(i<kSub)return i;
+        int shift=static_cast<int>(i/kSub)-1;
+        return ((kSub+i%kSub+1)<<shift)-1;
+    }
+
+    void record(uint64_t v){
+        bump_(counts_[index(v)],1);
+        bump_(sum_,v);
+    }
+    //加到 out（kBuckets 个）上，返回总和
+    uint64_t addTo(uint64_t* out) const{
+        for(size_t i=0;i<kBuckets;++i)out[i]+=counts_[i].load(std::memory_order_relaxed);
+        return sum_.load(std::memory_order_relaxed);
+    }
+private:
+    static void bump_(std::atomic<uint64_t>& a,uint64_t n){
+        a.store(a.load(std::memory_order_relaxed)+n,std::memory_order_relaxed);
+    }
+    std::atomic<uint64_t> counts_[kBuckets]={};
+    std::atomic<uint64_t> sum_{0};
+};
+
+// ===================== 每线程的数据 =====================
+struct alignas(64) ThreadMetrics{
+    Histogram stages[kStageCount];
+    std::atomic<uint64_t> counters[kCounterCount]={};
+
+    void record(Stage s,uint64_t ns){stages[s].record(ns);}
+    void add(Counter c,uint64_t n=1){
+        counters[c].store(counters[c].load(std::memory_order_relaxed)+n,std::memory_order_relaxed);
+    }
+};
+
+//buckets 是 Histogram::kBuckets 个计数，count 是它们的和；q 分位数（纳秒，取桶的上界），没有样本返回 0
+inline uint64_t quantile(const uint64_t* buckets,uint64_t count,double q){
+    if(count==0)return 0;
+    uint64_t rank=static_cast<uint64_t>(q*static_cast<double>(count-1))+1;
+    uint64_t seen=0;
+    for(size_t i=0;i<Histogram::kBuckets;++i){
+        seen+=buckets[i];
+        if(seen>=rank)return Histogram::upperBound(i);
+    }
+    return Histogram::upperBound(Histogram::kBuckets-1);
+}
+
+// ===================== 汇总结果 =====================
+struct Snapshot{
+    std::vector<uint64_t> buckets;          //kStageCount * Histogram::kBuckets
+    uint64_t sums[kStageCount]={};          //纳秒
+    uint64_t counts[kStageCount]={};
+    uint64_t counters[kCounterCount]={};
+
+    Snapshot():buckets(kStageCount*Histogram::kBuckets,0){}
+    const uint64_t* stage(int s) const{return &buckets[static_cast<size_t>(s)*Histogram::kBuckets];}
+    uint64_t quantile(int s,double q) const{return metrics::quantile(stage(s),counts[s],q);}
+};
+
+// ===================== 登记表（进程内一个） =====================
+class Registry{
+private:
+    std::mutex mtx_;
+    std::vector<std::unique_ptr<ThreadMetrics>> threads_;
+    Registry(){tickMult();}//先校准，别让第一个请求来付这 10 ms
+public:
+    static Registry& instance(){
+        static Registry r;
+        return r;
+    }
+    Registry(const Registry&)=delete;
+    Registry& operator=(const Registry&)=delete;
+
+    ThreadMetrics* registerThread(){
+        std::unique_ptr<ThreadMetrics> m(new ThreadMetrics());
+        std::lock_guard<std::mutex> lk(mtx_);
+        threads_.push_back(std::move(m));
+        return threads_.back().get();
+    }
+    Snapshot snapshot(){
+        Snapshot snap;
+        std::lock_guard<std::mutex> lk(mtx_);
+        for(const auto& t:threads_){
+            for(int s=0;s<kStageCount;++s){
+                snap.sums[s]+=t->stages[s].addTo(&snap.buckets[static_cast<size_t>(s)*Histogram::kBuckets]);
+            }
+            for(int c=0;c<kCounterCount;++c)snap.counters[c]+=t->counters[c].load(std::memory_order_relaxed);
+        }
+        for(int s=0;s<kStageCount;++s){
+            const uint64_t* b=snap.stage(s);
+            for(size_t i=0;i<Histogram::kBuckets;++i)snap.counts[s]+=b[i];
+        }
+        return snap;
+    }
+};
+
+//本线程的 ThreadMetrics（第一次调用时登记）
+inline ThreadMetrics& local(){
+    thread_local ThreadMetrics* m=Registry::instance().registerThread();
+    return *m;
+}
+
+// ===================== Prometheus 文本格式 =====================
+inline void appendSeconds_(std::string& out,uint64_t ns){
+    char buf[32];
+    int n=std::snprintf(buf,sizeof(buf),"%.9g",static_cast<double>(ns)/1e9);
+    out.append(buf,static_cast<size_t>(n));
+}
+inline void appendMetric(std::string& out,const char* name,const char* type,const char* help,uint64_t value){
+    out+="# HELP ";out+=name;out+=' ';out+=help;out+='\n';
+    out+="# TYPE ";out+=name;out+=' ';out+=type;out+='\n';
+    out+=name;out+=' ';out+=std::to_string(value);out+='\n';
+}
+//一组序列的分位数（gauge，秒）：labels[i] 是第 i 条序列的标签（比如 stage="parse"），
+//fn(i,q) 返回第 i 条序列在分位 q 上的纳秒数。每条序列输出 0.5 / 0.9 / 0.99 / 0.999 四个点
+template<typename F>
+inline void appendQuantiles(std::string& out,const std::string& name,const char* help,
+                            const std::vector<std::string>& labels,F&& fn){
+    static const char* const kQ[]={"0.5","0.9","0.99","0.999"};
+    static const double kQv[]={0.5,0.9,0.99,0.999};
+    out+="# HELP "+name+' '+help+'\n';
+    out+="# TYPE "+name+" gauge\n";
+    for(size_t i=0;i<labels.size();++i){
+        for(int q=0;q<4;++q){
+            out+=name+'{'+labels[i]+",quantile=\""+kQ[q]+"\"} ";
+            appendSeconds_(out,fn(i,kQv[q]));
+            out+='\n';
+        }
+    }
+}
+inline void renderPrometheus(const Snapshot& snap,std::string& out,const char* prefix="webserver"){
+    static const uint64_t kLe[]={//纳秒
+        1000,2500,5000,10000,25000,50000,100000,250000,500000,
+        1000000,2500000,5000000,10000000,25000000,50000000,100000000,250000000,500000000,
+        1000000000,2500000000ull,5000000000ull,10000000000ull,
+    };
+    std::string name=std::string(prefix)+"_stage_duration_seconds";
+    out+="# HELP "+name+" Time spent in each request-processing stage.\n";
+    out+="# TYPE "+name+" histogram\n";
+    for(int s=0;s<kStageCount;++s){
+        std::string label=std::string("{stage=\"")+stageName(s)+"\"";
+        const uint64_t* b=snap.stage(s);
+        size_t i=0;
+        uint64_t cumulative=0;
+        //细桶整个落在 le 以内才算进去（上界 <= le）；跨 le 的细桶算到下一个 le
+        for(uint64_t le:kLe){
+            while(i<Histogram::kBuckets&&Histogram::upperBound(i)<=le)cumulative+=b[i++];
+            out+=name+"_bucket"+label+",le=\"";
+            appendSeconds_(out,le);
+            out+="\"} "+std::to_string(cumulative)+'\n';
+        }
+        out+=name+"_bucket"+label+",le=\"+Inf\"} "+std::to_string(snap.counts[s])+'\n';
+        out+=name+"_sum"+label+"} ";
+        appendSeconds_(out,snap.sums[s]);
+        out+='\n';
+        out+=name+"_count"+label+"} "+std::to_string(snap.counts[s])+'\n';
+    }
+
+    //分位数：直方图直接算出来的，方便不跑 histogram_quantile 时直接看
+    std::vector<std::string> stages;
+    for(int s=0;s<kStageCount;++s)stages.push_back(std::string("stage=\"")+stageName(s)+"\"");
+    appendQuantiles(out,std::string(prefix)+"_stage_duration_quantile_seconds",
+                    "Per-stage latency quantiles computed from the histograms above.",stages,
+                    [&snap](size_t s,double q){return snap.quantile(static_cast<int>(s),q);});
+
+    std::string p=std::string(prefix)+"_";
+    appendMetric(out,(p+"received_bytes_total").c_str(),"counter","Bytes read from client sockets.",snap.counters[kBytesIn]);
+    appendMetric(out,(p+"sent_bytes_total").c_str(),"counter","Bytes written to client sockets.",snap.counters[kBytesOut]);
+    appendMetric(out,(p+"requests_total").c_str(),"counter","Requests answered.",snap.counters[kRequests]);
+    appendMetric(out,(p+"keepalive_reused_requests_total").c_str(),"counter",
+                 "Requests served on an already-used keep-alive connection.",snap.counters[kKeepAliveReuse]);
+    appendMetric(out,(p+"rearms_total").c_str(),"counter","epoll EPOLLONESHOT re-arms.",snap.counters[kRearms]);
+}
+
+}
+#endif
@@ -0,0 +1,249 @@
+#ifndef RADIXROUTER_HPP
+#define RADIXROUTER_HPP
+#include<string>
+#include<string_view>
+#include<vector>
+#include<deque>
+#include<memory>
+#include<cstring>
+#include<cstddef>
+#include<cstdint>
+#include "httpParser.hpp"
+// ===================== 压缩前缀树路由 =====================
+// 替代 “每个方法一张 unordered_map<std::string, ...> + 前缀路由线性扫描”：
+// 1) 每个方法一棵树（按 HttpMethod 下标），另有一棵 any 树；方法树没匹配上再查 any 树
+// 2) 静态部分按公共前缀压缩成边，查找只沿着路径往下走，耗时跟路径长度有关，跟注册了多少路由无关
+// 3) 模式语法：
+//      /users/:id          ":name" 匹配一个非空段（到下一个 '/' 为止），只能出现在 '/' 后面
+//      /static/*path       "*name" 匹配剩下的全部（可以为空），只能放在最后；可以跟在任何字符后面
+//    同一位置的优先级：静态 > 参数 > 通配；静态分支走到底没匹配上会回退去试参数、通配
+// 4) 匹配只看 '?' 之前的部分；参数以 string_view 写进 RouteParams（指向传进来的 path），不分配
+// 5) 纯静态的模式另外记在一张开放寻址表里，先整串查表（一次哈希 + 一两次比较），查不到才下树：
+//    路由多了以后树要走十来层、每层一次缓存未命中，静态路径走表更快；
+//    树本身是静态优先的，完整的静态匹配一定先被找到，所以先查表结果不变
+//
+// 同一个模式再注册一次会覆盖旧值；同一位置参数名不一致、通配不在结尾等冲突 add 返回 false。
+// 值放在各自的 unique_ptr 里，后注册的路由拆分节点也不会让已经拿到的 T* 失效。
+// 注册不是线程安全的，要在开始查找之前做完
+template<typename T>
+class RadixRouter{
+private:
+    struct Node{
+        std::string prefix;                         //这条边上的静态字节
+        std::string indices;                        //各静态子节点 prefix 的首字节，和 children 一一对应
+        std::vector<std::unique_ptr<Node>> children;
+        std::unique_ptr<Node> param;                //":name" 子节点（自己的 prefix 为空）
+        std::string paramName;
+        std::unique_ptr<Node> wildcard;             //"*name" 子节点，只有 value
+        std::string wildcardName;
+        std::unique_ptr<T> value;
+    };
+    static constexpr size_t kAnyTree=kHttpMethodCount;
+    //静态表的槽：key 指向 keys_ 里的拷贝，value 指向树节点里的值
+    struct Slot{
+        uint64_t hash=0;
+        std::string_view key;
+        const T* value=nullptr;
+        size_t tree=0;
+    };
+
+    Node trees_[kHttpMethodCount+1];
+    size_t size_=0;
+    std::vector<Slot> slots_;           //容量是 2 的幂，装载率不超过 1/2
+    size_t used_=0;
+    std::deque<std::string> keys_;      //deque 追加不搬动已有元素，slot 里的视图一直有效
+
+    static uint64_t hash_(size_t tree,std::string_view s){
+        uint64_t h=0x9e3779b97f4a7c15ull^(s.size()*31+tree);
+        size_t i=0;
+        for(;i+8<=s.size();i+=8){
+            uint64_t w;
+            std::memcpy(&w,s.data()+i,8);
+            h=(h^w)*0xff51afd7ed558ccdull;
+            h^=h>>32;
+        }
+        uint64_t w=0;
+        std::memcpy(&w,s.data()+i,s.size()-i);
+        h=(h^w)*0xc4ceb9fe1a85ec53ull;
+        return h^(h>>29);
+    }
+    const T* findStatic_(size_t tree,std::string_view path) const{
+        if(used_==0)return nullptr;
+        uint64_t h=hash_(tree,path);
+        size_t mask=slots_.size()-1;
+        for(size_t i=h&mask;slots_[i].value;i=(i+1)&mask){
+            const Slot& sl=slots_[i];
+            if(sl.hash==h&&sl.tree==tree&&sl.key==path)return sl.value;
+        }
+        return nullptr;
+    }
+    void placeStatic_(const Slot& in){
+        size_t mask=slots_.size()-1;
+        size_t i=in.hash&mask;
+        while(slots_[i].value)i=(i+1)&mask;
+        slots_[i]=in;
+    }
+    void addStatic_(size_t tree,std::string_view pattern,const T* value){
+        if(findStatic_(tree,pattern))return;//覆盖注册：值的地址没变
+        if((used_+1)*2>slots_.size()){
+            std::vector<Slot> old(slots_.size()?slots_.size()*2:16);
+            old.swap(slots_);
+            for(const Slot& sl:old){
+                if(sl.value)placeStatic_(sl);
+            }
+        }
+        keys_.emplace_back(pattern);
+        Slot sl;
+        sl.hash=hash_(tree,pattern);
+        sl.key=keys_.back();
+        sl.value=value;
+        sl.tree=tree;
+        placeStatic_(sl);
+        ++used_;
+    }
+
+    static size_t commonPrefix_(std::string_view a,std::string_view b){
+        size_t n=a.size()<b.size()?a.size():b.size();
+        size_t i=0;
+        while(i<n&&a[i]==b[i])++i;
+        return i;
+    }
+    //静态部分到哪里结束：'*' 任意位置，':' 只在 '/' 后面
+    static size_t staticRun_(std::string_view s){
+        for(size_t i=0;i<s.size();++i){
+            if(s[i]=='*'||(s[i]==':'&&i>0&&s[i-1]=='/'))return i;
+        }
+        return s.size();
+    }
+    T* setValue_(Node* n,T&& v){
+        if(n->value){
+            *n->value=std::move(v);
+        }else{
+            n->value.reset(new T(std::move(v)));
+            ++size_;
+        }
+        return n->value.get();
+    }
+    //返回值落在哪里，冲突返回 nullptr。afterSlash：rest 前面紧挨着的字节是不是 '/'（不是的话 ':' 只是普通字节）
+    T* insert_(Node* n,std::string_view rest,T&& v,bool afterSlash){
+        while(true){
+            if(rest.empty())return setValue_(n,std::move(v));
+            if(rest[0]==':'&&afterSlash){
+                size_t end=rest.find('/');
+                if(end==std::string_view::npos)end=rest.size();
+                std::string_view name=rest.substr(1,end-1);
+                if(name.empty()||name.find_first_of(":*")!=std::string_view::npos)return nullptr;
+                if(!n->param){
+                    n->param.reset(new Node());
+                    n->paramName=std::string(name);
+                }else if(n->paramName!=name){
+                    return nullptr;
+                }
+                n=n->param.get();
+                rest.remove_prefix(end);
+                afterSlash=false;
+                continue;
+            }
+            if(rest[0]=='*'){
+                std::string_view name=rest.substr(1);
+                if(name.empty()||name.find_first_of("/:*")!=std::string_view::npos)return nullptr;
+                if(!n->wildcard){
+                    n->wildcard.reset(new Node());
+                    n->wildcardName=std::string(name);
+                }else if(n->wildcardName!=name){
+                    return nullptr;
+                }
+                return setValue_(n->wildcard.get(),std::move(v));
+            }
+            std::string_view seg=rest.substr(0,staticRun_(rest));
+            size_t i=n->indices.find(seg[0]);
+            if(i==std::string::npos){
+                n->children.emplace_back(new Node());
+                n->children.back()->prefix=std::string(seg);
+                n->indices.push_back(seg[0]);
+                n=n->children.back().get();
+                rest.remove_prefix(seg.size());
+                afterSlash=seg.back()=='/';
+                continue;
+            }
+            Node* child=n->children[i].get();
+            size_t common=commonPrefix_(child->prefix,seg);
+            if(common<child->prefix.size()){
+                //拆边：child 的前 common 个字节提出来做新的中间节点
+                std::unique_ptr<Node> mid(new Node());
+                mid->prefix=child->prefix.substr(0,common);
+                child->prefix.erase(0,common);
+                mid->indices.push_back(child->prefix[0]);
+                mid->children.push_back(std::move(n->children[i]));
+                n->children[i]=std::move(mid);
+                child=n->children[i].get();
+            }
+            n=child;
+            rest.remove_prefix(common);
+            afterSlash=seg[common-1]=='/';
+        }
+    }
+    //n 的 prefix 已经匹配掉了，path 是剩下的部分
+    static const T* match_(const Node* n,std::string_view path,RouteParams& params){
+        if(path.empty()){
+            if(n->value)return n->value.get();
+            if(n->wildcard&&params.add(n->wildcardName,path))return n->wildcard->value.get();
+            return nullptr;
+        }
+        if(!n->indices.empty()){
+            const void* hit=std::memchr(n->indices.data(),path[0],n->indices.size());
+            if(hit){
+                const Node* child=n->children[static_cast<const char*>(hit)-n->indices.data()].get();
+                size_t len=child->prefix.size();
+                if(path.size()>=len&&std::memcmp(path.data(),child->prefix.data(),len)==0){
+                    if(const T* r=match_(child,path.substr(len),params))return r;
+                }
+            }
+        }
+        if(n->param){
+            size_t end=path.find('/');
+            if(end==std::string_view::npos)end=path.size();
+            size_t mark=params.size();
+            if(end>0&&params.add(n->paramName,path.substr(0,end))){
+                if(const T* r=match_(n->param.get(),path.substr(end),params))return r;
+                params.truncate(mark);
+            }
+        }
+        if(n->wildcard&&params.add(n->wildcardName,path))return n->wildcard->value.get();
+        return nullptr;
+    }
+    bool add_(size_t tree,std::string_view pattern,T&& value){
+        if(pattern.empty()||pattern[0]!='/')return false;
+        T* v=insert_(&trees_[tree],pattern,std::move(value),false);
+        if(!v)return false;
+        if(staticRun_(pattern)==pattern.size())addStatic_(tree,pattern,v);
+        return true;
+    }
+    const T* find_(size_t tree,std::string_view path,RouteParams& params) const{
+        if(const T* r=findStatic_(tree,path))return r;
+        const T* r=match_(&trees_[tree],path,params);
+        if(!r)params.clear();
+        return r;
+    }
+    static size_t treeIndex_(HttpMethod m){return static_cast<size_t>(m);}
+public:
+    //pattern 必须以 '/' 开头；冲突返回 false（冲突之前已经建出来的空节点不回收，不影响查找）
+    bool add(HttpMethod method,std::string_view pattern,T value){
+        return add_(treeIndex_(method),pattern,std::move(value));
+    }
+    //不限方法
+    bool addAny(std::string_view pattern,T value){
+        return add_(kAnyTree,pattern,std::move(value));
+    }
+    //没匹配上返回 nullptr；params 先清空再填
+    const T* find(HttpMethod method,std::string_view path,RouteParams& params) const{
+        size_t q=path.find('?');
+        if(q!=std::string_view::npos)path=path.substr(0,q);
+        params.clear();
+        if(const T* r=find_(treeIndex_(method),path,params))return r;
+        return find_(kAnyTree,path,params);
+    }
+    size_t size() const{return size_;}
+};
+
+#endif
@@ -0,0 +1,157 @@
+#include "thread_pool_webserver.hpp"
+#include "logger.hpp"
+#include <cstdlib>
+#include <cstring>
+
+// =====================================================================
+// 静态文件路由：serveStatic(prefix, root_dir)
+//
+// 原来只能由 handler 填 HttpResponse::body：大文件要先整个读进内存，append_response 再拷一遍进 outbuf。
+// 现在 handler 只填 HttpResponse::file（FileCache 里打开好的 fd）+ 区间，
+// append_response 把它作为文件段排进输出队列，writeFromOutbuf 用 sendfile 直接从页缓存发到 socket。
+// =====================================================================
+
+void SimpleWebServer::serveStatic(const std::string& prefix, const std::string& root_dir, bool blocking) {
+    std::string root = root_dir;
+    while (root.size() > 1 && root.back() == '/') root.pop_back();
+    Route route;
+    route.handler = [this, prefix, root](const HttpRequest& req, HttpResponse& res) {
+        serveFile(prefix, root, req, res);
+    };
+    route.blocking = blocking;
+    // 前缀后面挂一个通配段：最长前缀优先由树结构保证，不用再线性扫描前缀表
+    addRoute(HttpMethod::kGet, prefix + "*path", std::move(route));
+}
+
+// 按扩展名猜 Content-Type，没认出来的一律当二进制
+static const char* guessContentType(const std::string& path) {
+    static const std::unordered_map<std::string, const char*> types = {
+        {"html", "text/html; charset=utf-8"}, {"htm", "text/html; charset=utf-8"},
+        {"css", "text/css"}, {"js", "application/javascript"}, {"json", "application/json"},
+        {"txt", "text/plain; charset=utf-8"}, {"xml", "application/xml"},
+        {"png", "image/png"}, {"jpg", "image/jpeg"}, {"jpeg", "image/jpeg"}, {"gif", "image/gif"},
+        {"svg", "image/svg+xml"}, {"ico", "image/x-icon"}, {"webp", "image/webp"},
+        {"pdf", "application/pdf"}, {"wasm", "application/wasm"}, {"mp4", "video/mp4"},
+    };
+    size_t dot = path.rfind('.');
+    size_t slash = path.rfind('/');
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+        std::string ext = path.substr(dot + 1);
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        auto it = types.find(ext);
+        if (it != types.end()) return it->second;
+    }
+    return "application/octet-stream";
+}
+
+// URL 里的相对路径 -> 文件系统路径；有 ".." 段或解码出 '\0' 的一律拒绝（不能逃出 root）
+static bool decodeRelativePath(std::string_view in, std::string& out) {
+    out.clear();
+    for (size_t i = 0; i < in.size(); ++i) {
+        char ch = in[i];
+        if (ch == '?' || ch == '#') break;
+        if (ch == '%' && i + 2 < in.size() && isxdigit(static_cast<unsigned char>(in[i + 1])) &&
+            isxdigit(static_cast<unsigned char>(in[i + 2]))) {
+            char hex[3] = {in[i + 1], in[i + 2], '\0'};
+            ch = static_cast<char>(std::strtol(hex, nullptr, 16));
+            i += 2;
+        }
+        if (ch == '\0') return false;
+        out.push_back(ch);
+    }
+    size_t pos = 0;
+    while (pos <= out.size()) {
+        size_t next = out.find('/', pos);
+        if (next == std::string::npos) next = out.size();
+        if (out.compare(pos, next - pos, "..") == 0 && next - pos == 2) return false;
+        pos = next + 1;
+    }
+    if (out.empty() || out.back() == '/') out += "index.html";
+    return true;
+}
+
+// Range: bytes=a-b / bytes=a- / bytes=-n，只支持单区间
+// 返回 1：合法区间；0：忽略（格式不认识或多区间，按整个文件 200 返回）；-1：不可满足（416）
+static int parseRange(std::string_view value, off_t size, off_t& start, off_t& end) {
+    if (value.compare(0, 6, "bytes=") != 0) return 0;
+    std::string spec(value.substr(6));
+    if (spec.find(',') != std::string::npos) return 0;
+    size_t dash = spec.find('-');
+    if (dash == std::string::npos) return 0;
+    std::string a = spec.substr(0, dash), b = spec.substr(dash + 1);
+    auto digits = [](const std::string& s) {
+        return !s.empty() && s.size() <= 18 && std::all_of(s.begin(), s.end(), ::isdigit);
+    };
+    if (a.empty()) {
+        if (!digits(b)) return 0;
+        off_t n = std::strtoll(b.c_str(), nullptr, 10);
+        if (n == 0 || size == 0) return -1;
+        start = n >= size ? 0 : size - n;
+        end = size - 1;
+        return 1;
+    }
+    if (!digits(a) || (!b.empty() && !digits(b))) return 0;
+    start = std::strtoll(a.c_str(), nullptr, 10);
+    end = b.empty() ? size - 1 : std::strtoll(b.c_str(), nullptr, 10);
+    if (!b.empty() && end < start) return 0;
+    if (start >= size) return -1;
+    if (end >= size) end = size - 1;
+    return 1;
+}
+
+void SimpleWebServer::serveFile(const std::string& prefix, const std::string& root,
+                                const HttpRequest& req, HttpResponse& res) {
+    std::string rel;
+    if (!decodeRelativePath(req.path.substr(prefix.size()), rel)) {
+        res.status_code = 403;
+        res.status_msg = status_code_to_message(403);
+        res.body = "<html><body><h1>403 Forbidden</h1></body></html>";
+        return;
+    }
+    if (rel.front() == '/') rel.erase(0, 1);
+
+    FileCache::FilePtr file = m_file_cache.get(root + "/" + rel);
+    if (!file) {
+        buildNotFoundResponse(res);
+        return;
+    }
+
+    res.headers["Content-Type"] = guessContentType(rel);
+    res.headers["Last-Modified"] = file->lastModified;
+    res.headers["Accept-Ranges"] = "bytes";
+
+    // If-Modified-Since 先于 Range 判断：没改过就直接 304，不管请求的是哪一段
+    auto ims = req.headers.find("If-Modified-Since");
+    if (ims != req.headers.end()) {
+        time_t since = FileCache::parseHttpDate(std::string(ims->second));
+        if (since != -1 && file->mtime <= since) {
+            res.status_code = 304;
+            res.status_msg = status_code_to_message(304);
+            res.headers.erase("Content-Type");
+            return;
+        }
+    }
+
+    off_t start = 0, end = file->size - 1;
+    auto range = req.headers.find("Range");
+    int r = range != req.headers.end() ? parseRange(range->second, file->size, start, end) : 0;
+    if (r < 0) {
+        res.status_code = 416;
+        res.status_msg = status_code_to_message(416);
+        res.headers["Content-Range"] = "bytes */" + std::to_string(file->size);
+        res.headers["Content-Type"] = "text/plain";
+        return;
+    }
+    if (r > 0) {
+        res.status_code = 206;
+        res.status_msg = status_code_to_message(206);
+        res.headers["Content-Range"] = "bytes " + std::to_string(start) + "-" + std::to_string(end) +
+                                       "/" + std::to_string(file->size);
+    } else {
+        res.status_code = 200;
+        res.status_msg = status_code_to_message(200);
+    }
+    res.file = std::move(file);
+    res.file_offset = start;
+    res.file_length = static_cast<size_t>(end - start + 1);
+}
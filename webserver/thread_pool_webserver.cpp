@@ -12,19 +12,21 @@
 #include <errno.h>
 #include <sys/socket.h>
 #include <sys/epoll.h>
-
-// ===================== [MOD] 工具：设置 fd 为非阻塞 =====================
-// 为什么要非阻塞：配合 epoll 才能高效处理大量连接
-// 注意：非阻塞 + EPOLLET 必须读/写到 EAGAIN（下面会实现）
-static bool set_nonblocking(int fd) {
-    int flags = fcntl(fd, F_GETFL, 0);
-    if (flags == -1) return false;
-    return fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;//O_NONBLOCK是非阻塞标
-}
+#include <sys/eventfd.h>
+#include <sys/sendfile.h>
+#include <charconv>
+#include <ctime>
+#ifdef WEBSERVER_IO_URING
+#include "ioUring.hpp"
+#endif
 
 // 构造函数
-SimpleWebServer::SimpleWebServer(int port)
-    : m_port(port), m_server_socket(nullptr), m_epoll_fd(-1), m_running(false) {
+SimpleWebServer::SimpleWebServer(int port, int loop_num)
+    : m_port(port), m_loop_num(1), m_dispatch_mode(DispatchMode::Auto),
+      m_backend(IoBackend::Epoll), m_listen_mode(ListenMode::ReusePort),
+      m_accept_batch(DEFAULT_ACCEPT_BATCH), m_running(false), m_max_body_size(DEFAULT_MAX_BODY),
+      m_write_low(DEFAULT_WRITE_LOW), m_write_high(DEFAULT_WRITE_HIGH) {
+    setLoopNum(loop_num);
     Logger::getInstance().debug("WebServer constructor called with port " + std::to_string(port));
 }
 
@@ -34,225 +36,765 @@ SimpleWebServer::~SimpleWebServer() {
     stop();
 }
 
+void SimpleWebServer::setLoopNum(int loop_num) {
+    if (loop_num <= 0) {
+        loop_num = static_cast<int>(std::thread::hardware_concurrency());
+        if (loop_num <= 0) loop_num = 1; // fallback
+    }
+    m_loop_num = loop_num;
+}
+
+void SimpleWebServer::setDispatchMode(DispatchMode mode) {
+    m_dispatch_mode = mode;
+}
+
+void SimpleWebServer::setBackend(IoBackend backend) {
+#ifndef WEBSERVER_IO_URING
+    if (backend == IoBackend::IoUring) {
+        Logger::getInstance().warning("Built without io_uring support, using epoll");
+        backend = IoBackend::Epoll;
+    }
+#endif
+    m_backend = backend;
+}
+
+void SimpleWebServer::setListenMode(ListenMode mode) {
+    m_listen_mode = mode;
+}
+
+void SimpleWebServer::setMaxBodySize(size_t bytes) {
+    m_max_body_size = bytes;
+}
+
+void SimpleWebServer::setWriteWatermarks(size_t low, size_t high) {
+    m_write_high = std::max<size_t>(high, 1);
+    m_write_low = std::min(low, m_write_high - 1);
+}
+
+void SimpleWebServer::setCompression(bool enabled, size_t min_size, int level) {
+    m_compression = enabled;
+    m_compress_min = min_size;
+    m_compress_level = std::clamp(level, 1, 9);
+}
+
+void SimpleWebServer::setCompressionCache(size_t bytes) {
+#ifdef WEBSERVER_ZLIB
+    m_compress_cache.setCapacity(bytes);
+#else
+    (void)bytes;
+#endif
+}
+
+void SimpleWebServer::setPinLoops(bool enabled) {
+    m_pin_loops = enabled;
+}
+
+void SimpleWebServer::setAcceptBatch(int n) {
+    m_accept_batch = n > 0 ? n : 1;
+}
+
+void SimpleWebServer::setConnectionLimits(size_t max_total, size_t max_per_loop) {
+    m_max_conns = max_total;
+    m_max_loop_conns = max_per_loop;
+}
+
+void SimpleWebServer::setMaxPendingTasks(size_t max_tasks) {
+    m_max_pending = max_tasks;
+}
+
+void SimpleWebServer::setBlockingQueueTimeout(int ms) {
+    m_blocking_timeout_ms = ms > 0 ? ms : 0;
+}
+
+void SimpleWebServer::setOverloadAction(OverloadAction action, int retry_after_sec) {
+    m_overload_action = action;
+    m_retry_after = std::max(retry_after_sec, 0);
+}
+
+SimpleWebServer::OverloadStats SimpleWebServer::overloadStats() const {
+    OverloadStats st;
+    st.accepted = m_stat_accepted.load(std::memory_order_relaxed);
+    st.rejected = m_stat_rejected.load(std::memory_order_relaxed);
+    st.rejected_requests = m_stat_rejected_requests.load(std::memory_order_relaxed);
+    st.shed = m_stat_shed.load(std::memory_order_relaxed);
+    st.accept_pauses = m_stat_pauses.load(std::memory_order_relaxed);
+    st.connections = m_conn_count.load(std::memory_order_relaxed);
+    st.pending_tasks = static_cast<size_t>(std::max(m_inflight.load(std::memory_order_relaxed), 0));
+    st.paused_loops = static_cast<size_t>(std::max(m_paused_loops.load(std::memory_order_relaxed), 0));
+    return st;
+}
+
+void SimpleWebServer::setMetrics(bool enabled, const std::string& path) {
+    m_metrics = enabled;
+    m_metrics_path = path;
+}
+
+// 汇总所有线程的直方图和计数器，再补上过载保护的计数（后者本来就是全局原子量）
+void SimpleWebServer::renderMetrics(std::string& out) const {
+    metrics::renderPrometheus(metrics::Registry::instance().snapshot(), out);
+    OverloadStats st = overloadStats();
+    metrics::appendMetric(out, "webserver_connections", "gauge", "Open client connections.", st.connections);
+    metrics::appendMetric(out, "webserver_pending_tasks", "gauge", "Tasks queued or running in the thread pool.",
+                          st.pending_tasks);
+    metrics::appendMetric(out, "webserver_accept_paused_loops", "gauge", "Event loops that stopped accepting.",
+                          st.paused_loops);
+    metrics::appendMetric(out, "webserver_connections_accepted_total", "counter", "Connections accepted.", st.accepted);
+    metrics::appendMetric(out, "webserver_connections_rejected_total", "counter",
+                          "Connections answered with 503 at accept time.", st.rejected);
+    metrics::appendMetric(out, "webserver_requests_rejected_total", "counter",
+                          "Blocking requests answered with 503 because the thread pool was full.", st.rejected_requests);
+    metrics::appendMetric(out, "webserver_connections_shed_total", "counter",
+                          "Connections dropped because file descriptors ran out.", st.shed);
+    metrics::appendMetric(out, "webserver_accept_pauses_total", "counter", "Times a loop paused accepting.",
+                          st.accept_pauses);
+
+    // 线程池各通道：排队时间（入队到出队）的分位数，和进出队、超时丢弃的计数
+    const SimpleThreadPool& pool = SimpleThreadPool::getInstance();
+    LaneStats lanes[kTaskLanes];
+    for (size_t i = 0; i < kTaskLanes; ++i) lanes[i] = pool.laneStats(static_cast<TaskLane>(i));
+    std::vector<std::string> laneLabels;
+    for (size_t i = 0; i < kTaskLanes; ++i) {
+        laneLabels.push_back(std::string("lane=\"") + laneName(static_cast<TaskLane>(i)) + "\"");
+    }
+    metrics::appendQuantiles(out, "webserver_pool_queue_delay_quantile_seconds",
+                             "Time tasks waited in the thread pool queue, per lane.", laneLabels,
+                             [&lanes](size_t i, double q) { return lanes[i].delayQuantile(q); });
+    const struct {
+        const char* name;
+        const char* type;
+        const char* help;
+        uint64_t (*value)(const LaneStats&);
+    } kLaneMetrics[] = {
+        {"webserver_pool_tasks_dequeued_total", "counter", "Tasks taken off the thread pool queue, per lane.",
+         [](const LaneStats& s) { return s.dequeued; }},
+        {"webserver_pool_tasks_queued", "gauge", "Tasks waiting in the thread pool queue, per lane.",
+         [](const LaneStats& s) { return s.enqueued > s.dequeued ? s.enqueued - s.dequeued : 0; }},
+        {"webserver_pool_tasks_expired_total", "counter", "Tasks skipped because their queue deadline passed, per lane.",
+         [](const LaneStats& s) { return s.expired; }},
+    };
+    for (const auto& m : kLaneMetrics) {
+        out += std::string("# HELP ") + m.name + ' ' + m.help + '\n';
+        out += std::string("# TYPE ") + m.name + ' ' + m.type + '\n';
+        for (size_t i = 0; i < kTaskLanes; ++i) {
+            out += std::string(m.name) + "{lane=\"" + laneName(static_cast<TaskLane>(i)) + "\"} " +
+                   std::to_string(m.value(lanes[i])) + '\n';
+        }
+    }
+}
+
+bool SimpleWebServer::inlineDispatch() const {
+    if (m_dispatch_mode == DispatchMode::Auto) return m_loop_num > 1;
+    return m_dispatch_mode == DispatchMode::Inline;
+}
+
+static void buildOverloadResponse(int retry_after, std::string& head, std::string& rest); // 在状态码表后面
+
 // ===================== 启动服务器 =====================
+// 为每个 loop 建好监听 socket + epoll，再把 loop 1..N-1 放到独立线程，loop 0 在当前线程运行
 void SimpleWebServer::start() {
-    if (!initializeServerSocket()) {
-        Logger::getInstance().error("Failed to initialize server socket");
-        return;
+    finishPrebuilts();
+    buildOverloadResponse(m_retry_after, m_overload_head, m_overload_rest);
+    if (m_metrics) metrics::Registry::instance(); // TSC 校准在这里做，不落到第一个请求上
+    // 内置 /metrics：用户自己注册了同一个路径就用用户的
+    RouteParams params;
+    if (m_metrics && !m_metrics_path.empty() && !m_router.find(HttpMethod::kGet, m_metrics_path, params)) {
+        get(m_metrics_path, [this](const HttpRequest&, HttpResponse& res) {
+            res.headers["Content-Type"] = "text/plain; version=0.0.4; charset=utf-8";
+            res.headers["Cache-Control"] = "no-store";
+            renderMetrics(res.body);
+        });
     }
-    if (!initializeEpoll()) {
-        Logger::getInstance().error("Failed to initialize epoll");
-        return;
+    m_conns = std::make_unique<FdTable<Conn>>();
+    for (int i = 0; i < m_loop_num; ++i) {
+        auto loop = std::make_unique<EventLoop>();
+        loop->id = i;
+        if (!initializeServerSocket(*loop)) {
+            Logger::getInstance().error("Failed to initialize server socket");
+            m_loops.push_back(std::move(loop));
+            cleanup();
+            return;
+        }
+#ifdef WEBSERVER_IO_URING
+        // 按 loop 各自退回：建环失败（老内核 / seccomp 禁用 / memlock 不够）的 loop 继续用 epoll
+        if (m_backend == IoBackend::IoUring) {
+            if (initializeUring(*loop)) {
+                m_loops.push_back(std::move(loop));
+                continue;
+            }
+            Logger::getInstance().warning("io_uring unavailable for loop " + std::to_string(i) + ", falling back to epoll");
+        }
+#endif
+        if (!initializeEpoll(*loop)) {
+            Logger::getInstance().error("Failed to initialize epoll");
+            m_loops.push_back(std::move(loop));
+            cleanup();
+            return;
+        }
+        m_loops.push_back(std::move(loop));
     }
 
-    Logger::getInstance().info("Web server started on port " + std::to_string(m_port));
+    Logger::getInstance().info("Web server started on port " + std::to_string(m_port) +
+                               " with " + std::to_string(m_loop_num) + " event loop(s)");
     m_running = true;
 
-    auto& threadPool = SimpleThreadPool::getInstance();
+    std::vector<int> cpus;
+    if (m_pin_loops) cpus = CpuTopology::detect().allCpus();
+    for (size_t i = 1; i < m_loops.size(); ++i) {
+        EventLoop* loop = m_loops[i].get();
+        int cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+        loop->thread = std::thread([this, loop, cpu]() {
+            CpuTopology::nameCurrentThread("loop-" + std::to_string(loop->id));
+            if (cpu >= 0) CpuTopology::pinCurrentThread({cpu});
+            runLoop(*loop);
+        });
+    }
+    if (!cpus.empty()) CpuTopology::pinCurrentThread({cpus[0]});
+    runLoop(*m_loops[0]);
+
+    for (size_t i = 1; i < m_loops.size(); ++i) {
+        if (m_loops[i]->thread.joinable()) m_loops[i]->thread.join();
+    }
+
+    cleanup();
+    std::cout << "Web server stopped" << std::endl;
+}
+
+// ===================== 单个 loop 的事件循环 =====================
+void SimpleWebServer::runLoop(EventLoop& loop) {
+#ifdef WEBSERVER_IO_URING
+    if (loop.ring) {
+        runUringLoop(loop);
+        return;
+    }
+#endif
     auto* events = new epoll_event[MAX_EVENTS];//epoll_event存事件类型和自定义数据,数组可以一下返回多个就绪队列，event是输出缓冲区
+    loop.tid = std::this_thread::get_id();
 
     while (m_running) {
-        //获取过期时间
-        int timeout=m_timer.getNextTick();
-        //没任务
-        if(timeout==-1) timeout=1000;
-        int nfds = epollWait( events, timeout);
-        // 【新增】处理完 IO 事件后，立刻检查是否有超时事件
-        // 这一步会执行所有过期的回调，关闭那些僵尸连接
-        m_timer.tick();
-        if (nfds == -1) break;
-        processEvents(events, nfds, threadPool);
+        // 超时由 timerfd 进 epoll，退出由 eventfd 唤醒，所以可以无限等待
+        int nfds = epollWait(loop, events, -1);
+        if (nfds == -1) {
+            if (errno == EINTR) continue; // 信号打断（比如 SIGINT 触发 stop()），回到 while 检查 m_running
+            break;
+        }
+        processEvents(loop, events, nfds);
     }
 
     delete[] events;
-    cleanup();
-    std::cout << "Web server stopped" << std::endl;
 }
 
 // ===================== 初始化服务器 Socket =====================
-bool SimpleWebServer::initializeServerSocket() {
-    m_server_socket = new Socket();
-    if (!m_server_socket->is_valid()) {
+// ReusePort：每个 loop 一个监听 socket，SO_REUSEPORT 让它们绑定同一端口，由内核做负载均衡
+// Shared   ：只有 loop 0 建监听 socket，其它 loop 借用它的 fd
+bool SimpleWebServer::initializeServerSocket(EventLoop& loop) {
+    // 预留 fd：fd 用光（EMFILE/ENFILE）时先关掉它腾出一个位置，才能把 backlog 里的连接 accept 出来拒掉
+    loop.reserve_fd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+
+    if (m_listen_mode == ListenMode::Shared && loop.id > 0) {
+        loop.listen_fd = m_loops[0]->listen_fd;
+        return true;
+    }
+
+    loop.listener = std::make_unique<Socket>();
+    if (!loop.listener->is_valid()) {
         Logger::getInstance().error("Error creating socket");
-        delete m_server_socket;
-        m_server_socket = nullptr;
+        loop.listener.reset();
         return false;
     }
 
-    if (!m_server_socket->setReuseAddr()) {
+    if (!loop.listener->setReuseAddr() || !loop.listener->setReusePort()) {
         Logger::getInstance().error("Error setting socket options");
-        delete m_server_socket;
-        m_server_socket = nullptr;
+        loop.listener.reset();
         return false;
     }
 
-    if (!m_server_socket->bind("0.0.0.0", m_port)) {
+    if (!loop.listener->bind("0.0.0.0", m_port)) {
         Logger::getInstance().error("Error binding socket");
-        delete m_server_socket;
-        m_server_socket = nullptr;
+        loop.listener.reset();
         return false;
     }
 
-    if (!m_server_socket->listen(128)) {
+    // 连接风暴时 backlog 是第一道缓冲：给到 SOMAXCONN（内核会再按 net.core.somaxconn 截断）
+    if (!loop.listener->listen(SOMAXCONN)) {
         Logger::getInstance().error("Error listening");
-        delete m_server_socket;
-        m_server_socket = nullptr;
+        loop.listener.reset();
+        return false;
+    }
+
+    // 一次唤醒要 accept 到 EAGAIN，监听 socket 必须非阻塞（Shared 模式下多个 loop 可能被同时叫醒）
+    if (!loop.listener->setNonBlocking()) {
+        Logger::getInstance().error("Error setting listen socket nonblocking");
+        loop.listener.reset();
         return false;
     }
+    loop.listen_fd = loop.listener->getFd();
 
-    Logger::getInstance().debug("Server socket initialized successfully");
+    Logger::getInstance().debug("Server socket initialized successfully for loop " + std::to_string(loop.id));
     return true;
 }
 
 // ===================== 初始化 epoll =====================
-bool SimpleWebServer::initializeEpoll() {
-    m_epoll_fd = epoll_create1(0);
-    if (m_epoll_fd == -1) {
+bool SimpleWebServer::initializeEpoll(EventLoop& loop) {
+    loop.epoll_fd = epoll_create1(0);
+    if (loop.epoll_fd == -1) {
         Logger::getInstance().error("Error creating epoll");
-        delete m_server_socket;
-        m_server_socket = nullptr;
         return false;
     }
 
     // [MOD] server socket 用 data.fd（本来你就这么做了）
+    // Shared 模式：EPOLLEXCLUSIVE 让一个新连接只唤醒一个等待的 loop，避免惊群
     epoll_event event;
     event.events = EPOLLIN;
-    event.data.fd = m_server_socket->getFd();
+    if (m_listen_mode == ListenMode::Shared) event.events |= EPOLLEXCLUSIVE;
+    event.data.u64 = eventKey(loop.listen_fd, 0);
 
-    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_server_socket->getFd(), &event) == -1) {
+    if (epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, loop.listen_fd, &event) == -1) {
         Logger::getInstance().error("Error adding server socket to epoll");
-        close(m_epoll_fd);
-        delete m_server_socket;
-        m_server_socket = nullptr;
         return false;
     }
 
-    Logger::getInstance().debug("Epoll initialized successfully");
+    // timerfd：时间轮的驱动源，到期回调统一走 onConnTimeout
+    EventLoop* lp = &loop;
+    loop.timer.setCallback([this, lp](int fd) { onConnTimeout(*lp, fd); });
+    event.events = EPOLLIN;
+    event.data.u64 = eventKey(loop.timer.timerFd(), 0);
+    if (loop.timer.timerFd() == -1 ||
+        epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, loop.timer.timerFd(), &event) == -1) {
+        Logger::getInstance().error("Error adding timerfd to epoll");
+        return false;
+    }
+
+    // eventfd：stop() 写一下就能把阻塞在 epoll_wait 的 loop 叫醒（write 是 async-signal-safe 的）
+    loop.wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (loop.wakeup_fd == -1) {
+        Logger::getInstance().error("Error creating eventfd");
+        return false;
+    }
+    event.events = EPOLLIN;
+    event.data.u64 = eventKey(loop.wakeup_fd, 0);
+    if (epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, loop.wakeup_fd, &event) == -1) {
+        Logger::getInstance().error("Error adding eventfd to epoll");
+        return false;
+    }
+
+    Logger::getInstance().debug("Epoll initialized successfully for loop " + std::to_string(loop.id));
     return true;
 }
 
 // ===================== epoll_wait =====================
-int SimpleWebServer::epollWait(struct epoll_event* events,int timeout) {
-    // 1000ms 超时，避免永久阻塞，方便 stop()
-    int nfds = epoll_wait(m_epoll_fd, events, MAX_EVENTS, timeout);
-    if (nfds == -1 && m_running) {
+int SimpleWebServer::epollWait(EventLoop& loop, struct epoll_event* events, int timeout) {
+    int nfds = epoll_wait(loop.epoll_fd, events, MAX_EVENTS, timeout);
+    if (nfds == -1 && m_running && errno != EINTR) {
         Logger::getInstance().error("Error in epoll_wait");
     }
     return nfds;
 }
 
 // ===================== 事件分发 =====================
-bool SimpleWebServer::isServerSocketEvent(const struct epoll_event& event) {
-    return event.data.fd == m_server_socket->getFd();
+bool SimpleWebServer::isServerSocketEvent(EventLoop& loop, const struct epoll_event& event) {
+    return event.data.u64 == eventKey(loop.listen_fd, 0);
 }
 
-void SimpleWebServer::processEvents(struct epoll_event* events, int nfds, SimpleThreadPool& threadPool) {
+void SimpleWebServer::processEvents(EventLoop& loop, struct epoll_event* events, int nfds) {
     for (int i = 0; i < nfds; i++) {
-        if (isServerSocketEvent(events[i])) {
-            handleNewConnection(threadPool);//服务器socket就是有新连接
+        if (isServerSocketEvent(loop, events[i])) {
+            handleNewConnection(loop);//服务器socket就是有新连接
+        } else if (events[i].data.u64 == eventKey(loop.timer.timerFd(), 0)) {
+            loop.timer.handleRead();//推进时间轮，到期的连接在回调里关闭
+            maybeResumeAccept(loop);//兜底：每个 tick 看一次要不要恢复 accept
+        } else if (events[i].data.u64 == eventKey(loop.wakeup_fd, 0)) {
+            uint64_t one;
+            while (::read(loop.wakeup_fd, &one, sizeof(one)) > 0) {}//清掉计数，下一轮 while 会看到 m_running == false
+            maybeResumeAccept(loop);//过载暂停中：别的线程关了连接 / 跑完了任务
         } else {
-            handleClientEvent(events[i], threadPool);//客户端socket就是i/o
+            handleClientEvent(loop, events[i]);//客户端socket就是i/o
         }
     }
 }
 
-// ===================== [MOD] Conn 表：安全管理连接对象生命周期 =====================
-std::shared_ptr<SimpleWebServer::Conn> SimpleWebServer::getConn(int fd) {
-    std::lock_guard<std::mutex> lk(m_conns_mtx);
-    auto it = m_conns.find(fd);
-    if (it == m_conns.end()) return nullptr;
-    return it->second;
-}
-
-void SimpleWebServer::addConn(const std::shared_ptr<Conn>& c) {
-    std::lock_guard<std::mutex> lk(m_conns_mtx);
-    m_conns[c->fd] = c;
+// ===================== [MOD] Conn 表：fd 下标表 + 每个 loop 一个对象池 =====================
+// 查找不加锁：fd 直接当下标，再用代数（和所属 loop）排除“旧连接的事件落到新连接上”
+SimpleWebServer::Conn* SimpleWebServer::lookupConn(EventLoop& loop, uint64_t key) {
+    Conn* c = m_conns->get(keyFd(key));
+    if (!c || c->gen != keyGen(key) || c->loop != &loop) return nullptr;
+    return c;
 }
 
-void SimpleWebServer::eraseConn(int fd) {
-    std::lock_guard<std::mutex> lk(m_conns_mtx);
-    m_conns.erase(fd);
+SimpleWebServer::Conn* SimpleWebServer::acquireConn(EventLoop& loop) {
+    Conn* c = nullptr;
+    {
+        std::lock_guard<std::mutex> lk(loop.free_mtx);
+        c = loop.free_conns;
+        if (c) loop.free_conns = c->next_free;
+    }
+    if (!c) c = new Conn(); // 池空才分配；稳定运行后 accept 不再 new
+    c->next_free = nullptr;
+    c->loop = &loop;
+    if (++loop.next_gen == 0) ++loop.next_gen; // 代数 0 留给监听/timerfd/eventfd
+    c->gen = loop.next_gen;
+    c->refs.store(1, std::memory_order_relaxed); // 连接表持有的那一个
+    return c;
 }
 
-// ===================== 接受新连接 =====================
-void SimpleWebServer::handleNewConnection(SimpleThreadPool&) {
-    std::unique_ptr<Socket> client_socket = m_server_socket->acceptUnique();
-    if (!client_socket) {
-        Logger::getInstance().warning("Failed to accept new connection");
-        return;
+void SimpleWebServer::unrefConn(Conn* c) {
+    if (c->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        recycleConn(c);
     }
+}
 
-    int fd = client_socket->getFd();
+// 引用归零：清状态后挂回所属 loop 的空闲链表（Socket 对象保留复用，缓冲区的存储还回每线程池）
+void SimpleWebServer::recycleConn(Conn* c) {
+    c->fd = -1;
+    c->inbuf.retrieveAll();
+    c->inbuf.release();
+    c->parser.reset();
+    c->outbuf.retrieveAll();
+    c->out_segs.clear(); // 放掉文件引用：缓存淘汰过的 fd 在这里才真正关闭
+    c->body.reset();     // 没收完的流式 body：sink 连同它持有的状态一起销毁
+    c->producer = nullptr;
+    c->producer_chunked = false;
+    c->producer_z.reset();
+    c->write_paused = false;
+    c->want_close = false;
+    c->accept_ticks = 0;
+    c->requests = 0;
+    c->busy.store(0, std::memory_order_relaxed);
+#ifdef WEBSERVER_IO_URING
+    c->sendbuf.retrieveAll();
+    c->send_vec.reset();
+    c->send_ticks = 0;
+    c->send_inflight = false;
+    c->shut_linked = false;
+    c->offloaded = false;
+    c->send_body = false;
+    c->parked.reset();
+    c->recv_armed = false;
+    c->recv_cancel = false;
+    c->recv_nobufs = false;
+#endif
+    EventLoop* loop = c->loop;
+    std::lock_guard<std::mutex> lk(loop->free_mtx);
+    c->next_free = loop->free_conns;
+    loop->free_conns = c;
+}
 
-    // [MOD] 必须非阻塞（配合 epoll）
-    if (!set_nonblocking(fd)) {
-        Logger::getInstance().warning("Failed to set nonblocking for client fd=" + std::to_string(fd));
-        // delete client_socket;
-        return;
+// ===================== 接受新连接 =====================
+// 一次唤醒连续 accept 到 EAGAIN（最多 m_accept_batch 个）：连接风暴时不用每个新连接都回一趟 epoll_wait。
+// 设上限是为了不让 accept 饿死本 loop 上已有连接的读写；没取完的监听 socket 仍然可读（LT），下一轮接着取
+void SimpleWebServer::handleNewConnection(EventLoop& loop) {
+    for (int i = 0; i < m_accept_batch && !loop.accept_paused.load(std::memory_order_relaxed); ++i) {
+        // SOCK_NONBLOCK 直接在 accept 时设好，省掉 fcntl 的两次系统调用
+        int fd = ::accept4(loop.listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return; // 队列取空了（Shared 模式下也可能被别的 loop 抢先）
+            if (errno == EINTR || errno == ECONNABORTED) continue; // 对端在握手完成后马上 RST，跳过
+            if (errno == EMFILE || errno == ENFILE) {
+                shedConnection(loop);
+                continue;
+            }
+            Logger::getInstance().warning("Failed to accept new connection: " + std::string(strerror(errno)));
+            return;
+        }
+        if (!admitConnection(loop, fd)) continue;
+        registerConnection(loop, fd);
     }
+}
 
-    // [MOD] 创建 Conn，并放入 Conn 表
-    // 为什么：需要保存 inbuf/outbuf/状态，且避免 epoll 存裸指针造成 UAF
-    auto conn = std::make_shared<Conn>();
+bool SimpleWebServer::registerConnection(EventLoop& loop, int fd) {
+    Conn* conn = acquireConn(loop);
+    Socket::adoptInto(conn->sock, fd); // Conn 托管 Socket 生命周期，回收的 Conn 连 Socket 对象一起复用
     conn->fd = fd;
-    conn->sock=std::move(client_socket); // Conn 托管 Socket 生命周期
+    if (m_metrics) conn->accept_ticks = metrics::nowTicks();
 
-    
+    // [MOD] 先放进 Conn 表再加 epoll：加进去以后事件随时可能来
+    if (!m_conns->set(fd, conn)) {
+        Logger::getInstance().error("fd exceeds connection table capacity fd=" + std::to_string(fd));
+        conn->sock->close();
+        unrefConn(conn);
+        return false;
+    }
 
-    // [MOD] 加入 epoll：事件里只带 fd，不带 ptr
+    // [MOD] 加入 epoll：事件里只带 fd + 代数，不带 ptr
     // [MOD] 增加 EPOLLONESHOT：保证同一 fd 同一时刻只会有一个 worker 在处理
     epoll_event ev;
     ev.events = EPOLLIN | EPOLLET | EPOLLONESHOT;
-    ev.data.fd = fd;
+    ev.data.u64 = eventKey(fd, conn->gen);
 
-    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+    if (epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
         Logger::getInstance().error("Error adding client fd to epoll fd=" + std::to_string(fd));
+        m_conns->clear(fd, conn);
+        conn->sock->close();
+        unrefConn(conn);
+        return false;
+    }
+    // 【新增】添加定时器：到期后由 onConnTimeout 关闭这个 fd
+    loop.timer.add(fd, TIMEOUT_MS);
+    trackConnection(loop, 1);
+
+    Logger::getInstance().debug("New connection accepted fd=" + std::to_string(fd) +
+                                " loop=" + std::to_string(loop.id));
+    return true;
+}
+
+// fd 用光时的兜底：不处理的话 backlog 里的连接一直挂着，监听 socket 一直可读，loop 空转。
+// 先让出预留 fd，accept 一个马上关掉（对端收到 FIN，而不是一直等），再把预留 fd 占回来
+void SimpleWebServer::shedConnection(EventLoop& loop) {
+    if (loop.reserve_fd != -1) {
+        ::close(loop.reserve_fd);
+        loop.reserve_fd = -1;
+    }
+    int fd = ::accept4(loop.listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd >= 0) ::close(fd);
+    loop.reserve_fd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    m_stat_shed.fetch_add(1, std::memory_order_relaxed);
+    Logger::getInstance().warning("Too many open files, rejected a new connection on loop " + std::to_string(loop.id));
+}
+
+// ===================== 过载保护 =====================
+// 连接数按 loop 和全局各记一份：accept 在 loop 线程上加，关闭可能在 worker 上减，所以都是原子的
+// （每个连接只加减一次，不在请求路径上）
+void SimpleWebServer::trackConnection(EventLoop& loop, int delta) {
+    if (delta > 0) {
+        loop.conn_count.fetch_add(1, std::memory_order_relaxed);
+        m_conn_count.fetch_add(1, std::memory_order_relaxed);
+        m_stat_accepted.fetch_add(1, std::memory_order_relaxed);
         return;
     }
-    addConn(conn);
-    // 【新增】添加定时器
-    // 回调函数：调用 closeConnection 关闭这个 fd
-    m_timer.add(fd, TIMEOUT_MS, [this, fd]() {
-        Logger::getInstance().info("Connection timeout, closing fd=" + std::to_string(fd));
-        this->closeConnection(fd);
-    });
-    
-    Logger::getInstance().debug("New connection accepted fd=" + std::to_string(fd));
+    loop.conn_count.fetch_sub(1, std::memory_order_relaxed);
+    m_conn_count.fetch_sub(1, std::memory_order_relaxed);
+    if (m_paused_loops.load(std::memory_order_seq_cst) > 0) wakePausedLoops();
+}
+
+void SimpleWebServer::noteFirstByte(Conn* c) {
+    if (c->accept_ticks == 0) return;
+    metrics::local().record(metrics::kAcceptToFirstByte, metrics::elapsedNs(c->accept_ticks));
+    c->accept_ticks = 0;
+}
+
+// 超过上限：达到上限就算；恢复要回落到 7/8 以下，避免在上限附近反复暂停/恢复
+bool SimpleWebServer::overloaded(const EventLoop& loop, bool low_water) const {
+    auto over = [low_water](size_t value, size_t limit) {
+        if (limit == 0) return false;
+        return value >= (low_water ? limit - limit / 8 : limit);
+    };
+    return over(m_conn_count.load(std::memory_order_seq_cst), m_max_conns) ||
+           over(loop.conn_count.load(std::memory_order_seq_cst), m_max_loop_conns) ||
+           over(static_cast<size_t>(std::max(m_inflight.load(std::memory_order_seq_cst), 0)), m_max_pending);
+}
+
+bool SimpleWebServer::admitConnection(EventLoop& loop, int fd) {
+    if (!overloaded(loop, false)) return true;
+    rejectConnection(fd);
+    if (m_overload_action == OverloadAction::PauseAccept) pauseAccept(loop);
+    return false;
+}
+
+// 还没建 Conn：503 直接用非阻塞 send 发出去，发不完（几乎不可能，新连接的发送缓冲区是空的）也不等。
+// 先把已经到达的请求字节读掉再关：接收队列里有没读的数据时 close 会发 RST，客户端可能连 503 都收不到
+void SimpleWebServer::rejectConnection(int fd) {
+    ChainBuffer out;
+    appendOverloadResponse(out);
+    out.sendTo(fd, out.readableBytes(), MSG_NOSIGNAL | MSG_DONTWAIT);
+    ::shutdown(fd, SHUT_WR);
+    char drain[4096];
+    while (::recv(fd, drain, sizeof(drain), MSG_DONTWAIT) > 0) {}
+    ::close(fd);
+    m_stat_rejected.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SimpleWebServer::pauseAccept(EventLoop& loop) {
+    if (loop.accept_paused.load(std::memory_order_relaxed)) return;
+    loop.accept_paused.store(true, std::memory_order_seq_cst);
+    m_paused_loops.fetch_add(1, std::memory_order_seq_cst);
+    m_stat_pauses.fetch_add(1, std::memory_order_relaxed);
+#ifdef WEBSERVER_IO_URING
+    if (loop.ring) {
+        uringCancelAccept(loop);
+    } else
+#endif
+    epoll_ctl(loop.epoll_fd, EPOLL_CTL_DEL, loop.listen_fd, nullptr);
+    Logger::getInstance().warning("Overloaded, paused accepting on loop " + std::to_string(loop.id));
+    // 先置标志再复查：和 trackConnection 的“先减计数再看标志”配对，
+    // 暂停期间刚好关掉的连接要么看到了标志（会来唤醒），要么计数已经减了（这里直接恢复）
+    maybeResumeAccept(loop);
+}
+
+void SimpleWebServer::resumeAccept(EventLoop& loop) {
+    loop.accept_paused.store(false, std::memory_order_seq_cst);
+    m_paused_loops.fetch_sub(1, std::memory_order_seq_cst);
+    if (!m_running) return;
+#ifdef WEBSERVER_IO_URING
+    if (loop.ring) {
+        if (loop.uring_accepts == 0) uringArmAccept(loop);
+        Logger::getInstance().info("Resumed accepting on loop " + std::to_string(loop.id));
+        return;
+    }
+#endif
+    epoll_event event;
+    event.events = EPOLLIN;
+    if (m_listen_mode == ListenMode::Shared) event.events |= EPOLLEXCLUSIVE;
+    event.data.u64 = eventKey(loop.listen_fd, 0);
+    if (epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, loop.listen_fd, &event) == -1) {
+        Logger::getInstance().error("Error re-adding server socket to epoll");
+        return;
+    }
+    Logger::getInstance().info("Resumed accepting on loop " + std::to_string(loop.id));
+}
+
+void SimpleWebServer::maybeResumeAccept(EventLoop& loop) {
+    if (loop.accept_paused.load(std::memory_order_seq_cst) && !overloaded(loop, true)) resumeAccept(loop);
+}
+
+// 监听 socket 只能由所属 loop 线程挂回去：别的线程（worker、其它 loop）写 eventfd 叫醒它，
+// loop 在唤醒处理里自己判断要不要恢复
+void SimpleWebServer::wakePausedLoops() {
+    for (auto& lp : m_loops) {
+        EventLoop& loop = *lp;
+        if (!loop.accept_paused.load(std::memory_order_seq_cst) || overloaded(loop, true)) continue;
+        if (std::this_thread::get_id() == loop.tid) {
+            maybeResumeAccept(loop);
+        } else if (loop.wakeup_fd != -1) {
+            uint64_t one = 1;
+            ssize_t n = ::write(loop.wakeup_fd, &one, sizeof(one));
+            (void)n;
+        }
+    }
+}
+
+// ===================== [MOD] 统一关闭连接（先从表里摘掉，再 DEL，最后 close） =====================
+// 注意：fd 由 Conn 里的 Socket 托管，不能再直接 ::close(fd)，否则 Socket 析构时会二次 close。
+// 必须先摘表再 close：close 之后同一个 fd 编号马上可能被别的 loop accept 并写进表里。
+// 调用方此后不能再碰 c（引用归零就被回收了），除非自己还持有 ConnRef。
+void SimpleWebServer::closeConnection(EventLoop& loop, Conn* c) {
+    int fd = c->fd;
+    if (!m_conns->clear(fd, c)) return; // 已经被关掉了
+    trackConnection(loop, -1);
+    if (loop.epoll_fd != -1) {
+        epoll_ctl(loop.epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    }
+#ifdef WEBSERVER_IO_URING
+    // io_uring 里的请求自己持有 file 引用，光 close 不会让在途的 multishot recv 结束；
+    // 先 shutdown，recv/send 会带着 0/EPIPE 完成，CQE 里持有的 Conn 引用随之释放
+    if (loop.ring) ::shutdown(fd, SHUT_RDWR);
+#endif
+    // 时间轮只能在 loop 线程上改；worker 关掉的连接留着节点，到期时查不到 Conn 自然忽略
+    if (std::this_thread::get_id() == loop.tid) {
+        loop.timer.cancel(fd);
+    }
+    if (c->sock) c->sock->close();
+    unrefConn(c); // 释放连接表持有的引用
 }
 
-// ===================== [MOD] 统一关闭连接（必须先 DEL 再 close 再 erase） =====================
-void SimpleWebServer::closeConnection(int fd) {
-    if (m_epoll_fd != -1) {
-        epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+// ===================== 超时回调：关闭空闲连接 =====================
+void SimpleWebServer::onConnTimeout(EventLoop& loop, int fd) {
+    Conn* c = m_conns->get(fd);
+    if (!c || c->loop != &loop) return; // 已关闭，或 fd 被别的 loop 复用
+    // 还在 worker 里处理：这时候关 fd 会和 worker 的读写竞争，推迟到下一个周期
+    if (c->busy.load(std::memory_order_acquire) > 0) {
+        loop.timer.add(fd, TIMEOUT_MS);
+        return;
     }
-    ::close(fd);//使用全局close，因为这里自定义了close函数，这里用的linux内核close，用于关闭fd
-    eraseConn(fd);
+    Logger::getInstance().info("Connection timeout, closing fd=" + std::to_string(fd));
+    closeConnection(loop, c);
 }
 
 // ===================== [MOD] re-arm ONESHOT（worker 处理完后再恢复监听） =====================
-void SimpleWebServer::rearm(int fd, uint32_t events) {
+void SimpleWebServer::rearm(EventLoop& loop, Conn* c, uint32_t events) {
     epoll_event ev;
     ev.events = events | EPOLLONESHOT; // 关键：重新武装 ONESHOT
-    ev.data.fd = fd;
-    epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+    ev.data.u64 = eventKey(c->fd, c->gen);
+    epoll_ctl(loop.epoll_fd, EPOLL_CTL_MOD, c->fd, &ev);
+    if (m_metrics) metrics::local().add(metrics::kRearms);
 }
 
-// ===================== 客户端事件：只拿 fd，交给线程池 =====================
-void SimpleWebServer::handleClientEvent(const struct epoll_event& event, SimpleThreadPool& threadPool) {
+// ===================== 客户端事件：Inline 就地处理；ThreadPool 交给线程池 =====================
+void SimpleWebServer::handleClientEvent(EventLoop& loop, const struct epoll_event& event) {
     // [MOD] 不再 event.data.ptr -> Socket*
-    // 改为：event.data.fd -> fd，再通过 Conn 表查 Conn
-    int fd = event.data.fd;
+    // 改为：event.data.u64 -> fd + 代数，再通过 Conn 表查 Conn
     uint32_t ev = event.events;//用unit32_t的原因是epoll底层就是这个
 
-    threadPool.submit([this, fd, ev]() {
-        handle_io(fd, ev);
+    Conn* c = lookupConn(loop, event.data.u64);
+    if (!c) return; // 同一批事件里这个连接已经被关掉（或 fd 已被复用）
+
+    // 【新增】只要有 IO 事件，就延长定时器（懒惰刷新，O(1)，只在 loop 线程上做）
+    loop.timer.refresh(c->fd, TIMEOUT_MS);
+
+    // run-to-completion：连接固定在本 loop 线程，不经过线程池的锁和队列
+    if (inlineDispatch()) {
+        handle_io(loop, c, ev);
+        return;
+    }
+
+    EventLoop* lp = &loop;
+    postToPool(c, TaskLane::Interactive, [this, lp, ev](Conn* conn) {
+        handle_io(*lp, conn, ev);
+    });
+}
+
+// ===================== 投递到线程池 =====================
+// 用 post 而不是 submit：没人读返回值，省掉 packaged_task + shared_ptr + future
+// - busy：告诉 loop 线程的超时回调“有 worker 在用，别关”
+// - ConnRef：保证 worker 用完之前 Conn 不会被回收给新连接
+// - m_inflight：停机时 cleanup() 等所有任务跑完再释放 Conn 和 loop
+template<typename F>
+void SimpleWebServer::postToPool(Conn* c, TaskLane lane, F&& fn) {
+    c->busy.fetch_add(1, std::memory_order_release);
+    m_inflight.fetch_add(1, std::memory_order_relaxed);
+    SimpleThreadPool::getInstance().post(lane, [this, ref = ConnRef(c), fn = std::forward<F>(fn)]() mutable {
+        ConnRef r = std::move(ref);
+        fn(r.get());
+        finishPoolTask(std::move(r));
     });
 }
 
+// 带排队超时：fn 和 on_expired 各持一个 ConnRef，线程池先析构没选中的那个，
+// 所以跑完的那个减在途计数时连接上已经没有别的任务引用了
+template<typename F, typename E>
+void SimpleWebServer::postToPool(Conn* c, TaskLane lane, int timeout_ms, F&& fn, E&& on_expired) {
+    if (timeout_ms <= 0) {
+        postToPool(c, lane, std::forward<F>(fn));
+        return;
+    }
+    c->busy.fetch_add(1, std::memory_order_release);
+    m_inflight.fetch_add(1, std::memory_order_relaxed);
+    SimpleThreadPool::getInstance().post(
+        lane, SimpleThreadPool::Clock::now() + std::chrono::milliseconds(timeout_ms),
+        [this, ref = ConnRef(c), fn = std::forward<F>(fn)]() mutable {
+            ConnRef r = std::move(ref);
+            fn(r.get());
+            finishPoolTask(std::move(r));
+        },
+        [this, ref = ConnRef(c), on_expired = std::forward<E>(on_expired)]() mutable {
+            ConnRef r = std::move(ref);
+            on_expired(r.get());
+            finishPoolTask(std::move(r));
+        });
+}
+
+void SimpleWebServer::finishPoolTask(ConnRef ref) {
+    ref->busy.fetch_sub(1, std::memory_order_release);
+    ref = ConnRef(); // 先放掉引用（可能触发回收），再减在途计数
+    m_inflight.fetch_sub(1, std::memory_order_seq_cst);
+    if (m_paused_loops.load(std::memory_order_seq_cst) > 0) wakePausedLoops(); // 任务数上限导致的暂停
+}
+
+// 和任务数超限时一样回预先拼好的 503，然后关连接（后面 pipeline 的请求一起丢掉）
+void SimpleWebServer::expireBlocking(Conn* c) {
+    m_stat_rejected_requests.fetch_add(1, std::memory_order_relaxed);
+    appendOverloadResponse(c->outbuf);
+    c->want_close = true;
+}
+
 // ===================== [MOD] 非阻塞读取：循环读到 EAGAIN =====================
 // 为什么：EPOLLET(边缘触发) 下如果不读空缓冲，可能不再触发下一次事件，导致“卡死”
-bool SimpleWebServer::readToInbuf(const std::shared_ptr<Conn>& c) {
-    char extrabuf[65536];
+// 读到 inbuf 超过上限就先停：剩下的留在内核缓冲区里（也就是对端的发送窗口），
+// 处理完 rearm 时 epoll 会再报一次可读。流式上传因此只占一个上限的内存，而且不会饿死同 loop 的其他连接
+bool SimpleWebServer::readToInbuf(Conn* c) {
+    // 每线程一块 64 KB 的读暂存区：空闲连接的 inbuf 没有存储，读到的数据先落在这里，
+    // 再按实际长度 append 进 inbuf（小请求从池里拿 1 KB，大的按需分配），读之前不用给每个连接预留空间
+    thread_local std::unique_ptr<char[]> scratch(new char[READ_SCRATCH]);
+    char* extrabuf = scratch.get();
+    const size_t limit = std::max(INBUF_HIGH_WATER, c->parser.bytesNeeded());
     // [修正] 不要在这里初始化 vec，这里初始化会导致后面循环用旧指针
     
     while (true) {
@@ -260,14 +802,18 @@ bool SimpleWebServer::readToInbuf(const std::shared_ptr<Conn>& c) {
         const size_t writable = c->inbuf.writableBytes();
         
         struct iovec vec[2];
-        vec[0].iov_base = c->inbuf.beginWrite(); // 获取最新的写位置
-        vec[0].iov_len = writable;
-        vec[1].iov_base = extrabuf;
-        vec[1].iov_len = sizeof(extrabuf);
-        
-        // 只有当 writable 小于 extrabuf 大小时，才需要启用第二块内存
-        // 这里的逻辑可以保留，或者简单点总是传 2 也可以（如果 vec[0] 很大 vec[1] 就不会被用到）
-        const int iovcnt = (writable < sizeof(extrabuf)) ? 2 : 1;
+        int iovcnt = 0;
+        if (writable > 0) {
+            vec[iovcnt].iov_base = c->inbuf.beginWrite(); // 获取最新的写位置
+            vec[iovcnt].iov_len = writable;
+            ++iovcnt;
+        }
+        // 只有当 writable 小于暂存区大小时，才需要启用第二块内存
+        if (writable < READ_SCRATCH) {
+            vec[iovcnt].iov_base = extrabuf;
+            vec[iovcnt].iov_len = READ_SCRATCH;
+            ++iovcnt;
+        }
         
         ssize_t n = ::readv(c->fd, vec, iovcnt);
         
@@ -286,24 +832,62 @@ bool SimpleWebServer::readToInbuf(const std::shared_ptr<Conn>& c) {
             c->inbuf.hasWritten(writable); 
             c->inbuf.append(extrabuf, n - writable);
         }
+        if (c->inbuf.readableBytes() >= limit) return true;
         // 循环继续，进入下一次 readv，此时 inbuf.beginWrite() 已经变了，逻辑正确
     }
 }
 
 // ===================== [MOD] 非阻塞写：循环写到 EAGAIN / 写完 =====================
 // 为什么：send 可能部分写，或者 EAGAIN（内核发送缓冲满）；不处理会导致响应截断（文件下载必崩）
-bool SimpleWebServer::writeFromOutbuf(const std::shared_ptr<Conn>& c) {
-    while (c->outbuf.readableBytes() > 0) {
-        ssize_t n = ::send(c->fd, c->outbuf.peek(), c->outbuf.readableBytes(), 0);
-
-        if (n > 0) {
-            c->outbuf.retrieve(n); // O(1) 移动读指针
-            if (c->outbuf.readableBytes() == 0) {
-                return true; // 发送完毕
+// 输出队列 = outbuf 里的内存字节 + 插在中间的外部段：
+// - 内存字节：outbuf 是块链，按块填 iovec 一次 sendmsg（最多 SEND_IOV 块），不拼成一整块
+// - 内存段：紧跟在它前面的字节（响应头）后面，body 作为最后一个 iovec 一起发，不拷进 outbuf
+// - 文件段：前面的字节带 MSG_MORE 先发（和文件开头合成一个 TCP 段），文件部分 sendfile（不经过用户态）
+bool SimpleWebServer::writeFromOutbuf(Conn* c) {
+    while (true) {
+        // 下一个段之前还有多少内存字节；没有段就是整个 outbuf
+        OutSegment* seg = c->out_segs.empty() ? nullptr : &c->out_segs.front();
+        size_t mem = seg ? seg->before : c->outbuf.readableBytes();
+        ssize_t n;
+        if (mem > 0 || (seg && !seg->file)) {
+            struct iovec iov[SEND_IOV + 1];
+            int cnt = 0;
+            size_t head = c->outbuf.gather(iov, SEND_IOV, mem, cnt);
+            // 段前面的字节这一次都带上了，才能把段接在后面
+            bool reach = seg && head == mem;
+            bool with_body = reach && !seg->file;
+            if (with_body) {
+                iov[cnt].iov_base = &seg->body[seg->offset];
+                iov[cnt].iov_len = seg->remaining;
+                ++cnt;
+            }
+            struct msghdr msg {};
+            msg.msg_iov = iov;
+            msg.msg_iovlen = static_cast<size_t>(cnt);
+            n = ::sendmsg(c->fd, &msg, reach && seg->file ? MSG_MORE : 0);
+            if (n > 0) {
+                size_t done = std::min(static_cast<size_t>(n), head);
+                c->outbuf.retrieve(done); // 发完的块直接还回块池
+                if (seg) seg->before -= done;
+                if (with_body) {
+                    seg->offset += n - done;
+                    seg->remaining -= n - done;
+                    if (seg->remaining == 0) c->out_segs.pop_front();
+                }
+                continue; // 没发完继续发
+            }
+        } else if (seg) {
+            n = ::sendfile(c->fd, seg->file->fd, &seg->offset, std::min(seg->remaining, SENDFILE_CHUNK));
+            if (n > 0) {
+                seg->remaining -= n;
+                if (seg->remaining == 0) c->out_segs.pop_front();
+                continue;
             }
-            // 没发完继续发
-        } 
-        else if (n < 0) {
+        } else {
+            return true; // 发送完毕
+        }
+
+        if (n < 0) {
             if (errno == EAGAIN || errno == EWOULDBLOCK) {
                 return true; // 内核缓冲满，等待下次 EPOLLOUT
             }
@@ -313,101 +897,16 @@ bool SimpleWebServer::writeFromOutbuf(const std::shared_ptr<Conn>& c) {
             // 真实错误
             Logger::getInstance().error("Send error fd=" + std::to_string(c->fd));
             return false;
-        } 
-        else {
-            // n == 0，视为异常断开
-            return false;
-        }
-    }
-    return true;
-}
-// ===================== [MOD] HTTP 解析：从 inbuf 中拆出一个完整请求 =====================
-// 核心目标：支持半包/粘包/keep-alive
-// 规则：
-// 1) 先找 "\r\n\r\n" 确认 header 完整
-// 2) 解析 Content-Length（不支持 chunked）
-// 3) 等待 inbuf 中 body 字节达到 Content-Length
-// 4) 消费掉这个请求的数据（inbuf erase），返回 true
-// ===================== [FIXED] HTTP 解析 =====================
-// ===================== [FIXED] HTTP 解析逻辑 =====================
-bool SimpleWebServer::tryParseOneRequest(const std::shared_ptr<Conn>& c, HttpRequest& req) {
-    const char* buf = c->inbuf.peek();
-    size_t len = c->inbuf.readableBytes();
-    
-    // 1. 查找 HTTP 头部结束标记 \r\n\r\n
-    const char* crlf = "\r\n\r\n";
-    auto it = std::search(buf, buf + len, crlf, crlf + 4);
-    
-    // 如果没找到完整的头，说明数据还没收全，返回 false 等待更多数据
-    if (it == buf + len) return false; 
-    
-    size_t header_len = (it - buf) + 4;
-    
-    // 2. 解析 Header (之前这里你是空的，必须补上！)
-    std::string header_part(buf, header_len); 
-    std::istringstream iss(header_part);
-    std::string line;
-    
-    // A. 解析请求行: GET / HTTP/1.1
-    if (std::getline(iss, line)) {
-        if (!line.empty() && line.back() == '\r') line.pop_back();
-        std::istringstream line_ss(line);
-        line_ss >> req.method >> req.path >> req.version;
-    }
-
-    // B. 解析 Headers
-    while (std::getline(iss, line) && line != "\r") {
-        if (!line.empty() && line.back() == '\r') line.pop_back();
-        if (line.empty()) break;
-        
-        size_t colon = line.find(':');
-        if (colon != std::string::npos) {
-            std::string key = line.substr(0, colon);
-            std::string val = line.substr(colon + 1);
-            // 去除 value 前导空格
-            size_t first_not_space = val.find_first_not_of(' ');
-            if (first_not_space != std::string::npos) {
-                val = val.substr(first_not_space);
-            }
-            req.headers[key] = val;
-        }
-    }
-    
-    // 3. 解析 Content-Length (为了处理 Post 请求 Body)
-    size_t body_len = 0;
-    auto cl_it = req.headers.find("Content-Length");
-    if (cl_it != req.headers.end()) {
-        try {
-            body_len = std::stoul(cl_it->second);
-        } catch (...) {
-            body_len = 0;
         }
+        // n == 0：对端异常断开，或者文件在发送途中被截断（Content-Length 已经发出去了，只能断开）
+        return false;
     }
-    
-    // 4. 检查 Body 是否完整
-    // 如果 buffer 总长度 < 头长度 +体长度，说明 Body 还没收全
-    if (len < header_len + body_len) return false; 
-    
-    // 5. 提取 Body
-    req.body.assign(buf + header_len, body_len);
-    
-    // 6. [关键] 从 Buffer 中彻底移除这个请求的数据（移动读指针）
-    c->inbuf.retrieve(header_len + body_len);
-    
-    return true;
 }
 
 // ===================== keep-alive 逻辑（复用你原意，但更安全） =====================
+// Connection 头和版本号在解析时已经算好了（HTTP/1.1 默认 keep-alive；HTTP/1.0 默认 close）
 bool SimpleWebServer::shouldKeepAlive(const HttpRequest& request) {
-    auto conn_it = request.headers.find("Connection");
-    if (conn_it != request.headers.end()) {
-        std::string v = conn_it->second;
-        std::transform(v.begin(), v.end(), v.begin(), ::tolower);
-        if (v == "close") return false;
-        if (v == "keep-alive") return true;
-    }
-    // HTTP/1.1 默认 keep-alive；HTTP/1.0 默认 close
-    return request.version != "HTTP/1.0";
+    return request.keep_alive;
 }
 
 void SimpleWebServer::setConnectionHeader(HttpResponse& response, bool keep_alive) {
@@ -415,33 +914,32 @@ void SimpleWebServer::setConnectionHeader(HttpResponse& response, bool keep_aliv
 }
 
 // ===================== 构建响应（保留你原路由机制） =====================
-void SimpleWebServer::build_response(const HttpRequest& request, HttpResponse& response) {
+void SimpleWebServer::build_response(const HttpRequest& request, const Route* route, HttpResponse& response,
+                                     BodySink* sink) {
     response.version = "HTTP/1.1";
-    response.headers["Server"] = "SimpleWebServer/1.0";
+    response.status_code = 200;
     response.headers["Content-Type"] = "text/html; charset=utf-8";
 
-    HandlerFunc handler = findRouteHandler(request);
-    if (handler) {
-        handler(request, response);
+    if (sink) {
+        if (sink->on_end) sink->on_end(response);
+    } else if (route && route->stream) {
+        // 流式路由但 body 和头一起到齐了：整块当成一段交出去
+        BodySink s = route->stream(request);
+        if (s.on_data && !request.body.empty()) s.on_data(request.body);
+        if (s.on_end) s.on_end(response);
+    } else if (route && route->handler) {
+        route->handler(request, response);
     } else {
         buildNotFoundResponse(response);
     }
-
-    // [MOD] Content-Length 必须准确（对 keep-alive 很关键）
-    response.headers["Content-Length"] = std::to_string(response.body.size());
 }
 
-SimpleWebServer::HandlerFunc SimpleWebServer::findRouteHandler(const HttpRequest& request) {
-    if (request.method == "GET") {
-        auto it = m_get_routes.find(request.path);
-        if (it != m_get_routes.end()) return it->second;
-    } else if (request.method == "POST") {
-        auto it = m_post_routes.find(request.path);
-        if (it != m_post_routes.end()) return it->second;
-    }
-    auto it = m_any_routes.find(request.path);
-    if (it != m_any_routes.end()) return it->second;
-    return nullptr;
+// HEAD 没有单独注册时走 GET 的 handler，respond() 里再把 body 去掉
+const SimpleWebServer::Route* SimpleWebServer::findRouteHandler(HttpRequest& request) const {
+    HttpMethod m = request.method_id;
+    const Route* route = m_router.find(m, request.path, request.params);
+    if (!route && m == HttpMethod::kHead) route = m_router.find(HttpMethod::kGet, request.path, request.params);
+    return route;
 }
 
 void SimpleWebServer::buildNotFoundResponse(HttpResponse& response) {
@@ -450,34 +948,465 @@ void SimpleWebServer::buildNotFoundResponse(HttpResponse& response) {
     response.body = "<html><body><h1>404 Not Found</h1></body></html>";
 }
 
-// ===================== [MOD] 响应组包：append 到 outbuf（不直接 send） =====================
+// ===================== 状态码表 =====================
+struct StatusText {
+    int code;
+    const char* msg;
+};
+static const StatusText kStatusTexts[] = {
+    {200, "OK"},
+    {206, "Partial Content"},
+    {304, "Not Modified"},
+    {400, "Bad Request"},
+    {403, "Forbidden"},
+    {404, "Not Found"},
+    {413, "Payload Too Large"},
+    {416, "Range Not Satisfiable"},
+    {431, "Request Header Fields Too Large"},
+    {500, "Internal Server Error"},
+    {501, "Not Implemented"},
+    {503, "Service Unavailable"},
+};
+static const int kMaxStatus = 600;
+
+// 预先拼好的 "HTTP/1.1 200 OK\r\n"，下标是状态码；表里没有的是空串
+static const std::vector<std::string>& statusLines() {
+    static const std::vector<std::string> lines = [] {
+        std::vector<std::string> v(kMaxStatus);
+        for (const auto& st : kStatusTexts) {
+            v[st.code] = "HTTP/1.1 " + std::to_string(st.code) + " " + st.msg + "\r\n";
+        }
+        return v;
+    }();
+    return lines;
+}
+
+// "Date: ...\r\n"：每个线程缓存一份，同一秒内的响应直接拷贝，不用每次 gmtime + strftime
+static void appendDateHeader(ChainBuffer& out) {
+    thread_local time_t cached_sec = 0;
+    thread_local char cached[64];
+    thread_local size_t cached_len = 0;
+    time_t now = ::time(nullptr);
+    if (now != cached_sec) {
+        struct tm tmv;
+        gmtime_r(&now, &tmv);
+        cached_len = strftime(cached, sizeof(cached), "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &tmv);
+        cached_sec = now;
+    }
+    out.append(cached, cached_len);
+}
+
+static const char kServerLine[] = "Server: SimpleWebServer/1.0\r\n";
+
+// 过载时的 503：start() 里拼一次，accept 路径和排队超限的请求直接拷字节（中间插 Date）
+static void buildOverloadResponse(int retry_after, std::string& head, std::string& rest) {
+    static const char kBody[] = "503 Service Unavailable: server overloaded, retry later\n";
+    head = statusLines()[503] + kServerLine;
+    rest = "Retry-After: " + std::to_string(retry_after) + "\r\n"
+           "Content-Type: text/plain\r\n"
+           "Content-Length: " + std::to_string(sizeof(kBody) - 1) + "\r\n"
+           "Connection: close\r\n\r\n" + kBody;
+}
+
+void SimpleWebServer::appendOverloadResponse(ChainBuffer& out) const {
+    out.append(m_overload_head);
+    appendDateHeader(out);
+    out.append(m_overload_rest);
+}
+
+static void appendHeaderLine(ChainBuffer& out, const std::string& key, const std::string& value) {
+    out.append(key);
+    out.append(": ", 2);
+    out.append(value);
+    out.append("\r\n", 2);
+}
+
+// ===================== [MOD] 响应组包：直接格式化进 outbuf（不直接 send） =====================
 // 为什么：非阻塞下 send 可能部分写/EAGAIN，必须先放到 outbuf，再由 writeFromOutbuf() 可靠发送
-void SimpleWebServer::append_response(const std::shared_ptr<Conn>& c, const HttpResponse& response) {
-    std::ostringstream oss;
-    oss << response.version << " " << response.status_code << " " << response.status_msg << "\r\n";
+// 不经过 ostringstream / 临时 string：状态行查表，Server/Date/Content-Length 由这里直接写，
+// 其余头逐个 append；大 body 移进输出队列成为一个段，和头一起 writev，不拷贝
+void SimpleWebServer::append_response(Conn* c, HttpResponse&& response, bool head_only, bool chunked) {
+    ChainBuffer& out = c->outbuf;
+
+    int code = response.status_code;
+    const std::string* line = nullptr;
+    if (code > 0 && code < kMaxStatus && response.version == "HTTP/1.1") {
+        line = &statusLines()[code];
+        // handler 自己写了不一样的原因短语：按它的来
+        if (line->empty() || (!response.status_msg.empty() &&
+                              line->compare(13, line->size() - 15, response.status_msg) != 0)) {
+            line = nullptr;
+        }
+    }
+    if (line) {
+        out.append(*line);
+    } else {
+        char num[16];
+        auto r = std::to_chars(num, num + sizeof(num), code);
+        out.append(response.version);
+        out.append(" ", 1);
+        out.append(num, r.ptr - num);
+        out.append(" ", 1);
+        out.append(response.status_msg);
+        out.append("\r\n", 2);
+    }
+
+    if (response.headers.find("Server") == response.headers.end()) {
+        out.append(kServerLine, sizeof(kServerLine) - 1);
+    }
+    appendDateHeader(out);
     for (const auto& [k, v] : response.headers) {
-        oss << k << ": " << v << "\r\n";
+        if (k == "Content-Length" || k == "Transfer-Encoding") continue; // 以实际 body 为准，下面统一写
+        appendHeaderLine(out, k, v);
     }
-    oss << "\r\n";
-    
-    std::string header = oss.str();
-    
-    // 直接 append 到 buffer
-    c->outbuf.append(header);
-    c->outbuf.append(response.body);
+    if (response.producer) {
+        // 流式响应：长度未知，chunked 编码（HTTP/1.0 没有 chunked，什么都不写，发完关连接）
+        if (chunked) out.append("Transfer-Encoding: chunked\r\n", 28);
+        out.append("\r\n", 2);
+        if (head_only) return;
+        ChunkWriter w(out, chunked, c->producer_z.get());
+        w.write(response.body);
+        c->producer = std::move(response.producer);
+        c->producer_chunked = chunked;
+        return;
+    }
+    // [MOD] Content-Length 必须准确（对 keep-alive 很关键）；304 没有 body，不带 Content-Length
+    if (code != 304) {
+        char num[24];
+        auto r = std::to_chars(num, num + sizeof(num), response.file ? response.file_length : response.body.size());
+        out.append("Content-Length: ", 16);
+        out.append(num, r.ptr - num);
+        out.append("\r\n", 2);
+    }
+    out.append("\r\n", 2);
+
+    if (head_only) return;
+    if (response.file) {
+        if (response.file_length == 0) return;
+        OutSegment seg;
+        seg.file = std::move(response.file);
+        seg.offset = response.file_offset;
+        seg.remaining = response.file_length;
+        queueSegment(c, std::move(seg));
+    } else if (response.body.size() >= BODY_REF_THRESHOLD) {
+        OutSegment seg;
+        seg.remaining = response.body.size();
+        seg.body = std::move(response.body);
+        queueSegment(c, std::move(seg));
+    } else {
+        out.append(response.body);
+    }
+}
+
+// ===================== 预序列化响应 =====================
+static std::string headerLine(const std::string& key, const std::string& value) {
+    return key + ": " + value + "\r\n";
+}
+
+// 强 ETag：body 的 64 位 FNV-1a
+static std::string bodyEtag(const std::string& body) {
+    uint64_t h = 1469598103934665603ull;
+    for (unsigned char ch : body) h = (h ^ ch) * 1099511628211ull;
+    char hex[24];
+    auto r = std::to_chars(hex, hex + sizeof(hex), h, 16);
+    return "\"" + std::string(hex, r.ptr) + "\"";
+}
+
+// headers 里必须有 ETag（finishPrebuilts 保证）
+SimpleWebServer::PrebuiltVariant SimpleWebServer::buildPrebuilt(const std::string& content_type, const std::string& body,
+                                                                const std::unordered_map<std::string, std::string>& headers) {
+    PrebuiltVariant pre;
+    const std::string& etag = headers.at("ETag");
+    pre.etag = etag.compare(0, 2, "W/") == 0 ? etag.substr(2) : etag;
+
+    std::string server = headers.count("Server") ? "" : kServerLine;
+    pre.head = statusLines()[200] + server;
+    pre.not_modified_head = statusLines()[304] + server;
+
+    // 304 只带 RFC 7232 4.1 要求的那几个头，不带 Content-Type / Content-Length
+    std::string common = headerLine("Content-Type", content_type);
+    std::string validators = headerLine("ETag", etag);
+    for (const auto& [k, v] : headers) {
+        if (k == "Content-Length" || k == "Transfer-Encoding" || k == "Connection" || k == "Date" ||
+            k == "ETag" || k == "Content-Type") {
+            continue;
+        }
+        if (k == "Cache-Control" || k == "Expires" || k == "Vary" || k == "Content-Location") {
+            validators += headerLine(k, v);
+        } else {
+            common += headerLine(k, v);
+        }
+    }
+    common += validators;
+    char num[24];
+    auto r = std::to_chars(num, num + sizeof(num), body.size());
+    std::string length = "Content-Length: " + std::string(num, r.ptr) + "\r\n\r\n";
+    for (int keep = 0; keep < 2; ++keep) {
+        std::string conn = keep ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+        pre.rest[keep] = common + conn + length + body;
+        pre.not_modified[keep] = validators + conn + "\r\n";
+    }
+    pre.body_size = body.size();
+    return pre;
+}
+
+// If-None-Match："*" 或逗号分隔的实体标签列表；用弱比较（两边都忽略 W/ 前缀，RFC 7232 3.2）
+static bool etagMatches(std::string_view header, std::string_view etag) {
+    while (!header.empty()) {
+        size_t comma = header.find(',');
+        std::string_view tag = header.substr(0, comma);
+        while (!tag.empty() && (tag.front() == ' ' || tag.front() == '\t')) tag.remove_prefix(1);
+        while (!tag.empty() && (tag.back() == ' ' || tag.back() == '\t')) tag.remove_suffix(1);
+        if (tag == "*") return true;
+        if (tag.compare(0, 2, "W/") == 0) tag.remove_prefix(2);
+        if (tag == etag) return true;
+        if (comma == std::string_view::npos) break;
+        header.remove_prefix(comma + 1);
+    }
+    return false;
+}
+
+// 每个编码一个版本：identity 总是有；内容可压缩时还有 gzip / deflate（各自的 ETag，都带 Vary: Accept-Encoding）
+void SimpleWebServer::finishPrebuilts() {
+    for (auto& p : m_prebuilts) {
+        auto headers = std::move(p->headers);
+        if (!headers.count("ETag")) headers["ETag"] = bodyEtag(p->body);
+        bool compress = false;
+#ifdef WEBSERVER_ZLIB
+        compress = m_compression && p->body.size() >= m_compress_min && !headers.count("Content-Encoding") &&
+                   compression::compressible(p->content_type);
+#endif
+        if (compress) {
+            auto vary = headers.find("Vary");
+            if (vary == headers.end()) headers["Vary"] = "Accept-Encoding";
+            else vary->second += ", Accept-Encoding";
+        }
+        p->variants[0] = buildPrebuilt(p->content_type, p->body, headers);
+#ifdef WEBSERVER_ZLIB
+        if (compress) {
+            for (compression::Coding coding : {compression::kGzip, compression::kDeflate}) {
+                std::string zipped;
+                if (!compression::compress(coding, m_compress_level, p->body, zipped)) continue;
+                auto h = headers;
+                h["Content-Encoding"] = compression::codingName(coding);
+                h["ETag"] = compression::variantEtag(headers["ETag"], coding);
+                p->variants[coding] = buildPrebuilt(p->content_type, zipped, h);
+            }
+        }
+#endif
+        p->content_type.clear();
+        std::string().swap(p->body);
+    }
+    m_prebuilts.clear();
+}
+
+// 不建 HttpResponse：三次 append（Date 前、Date、Date 后）
+void SimpleWebServer::respondPrebuilt(Conn* c, const HttpRequest& req, const Prebuilt& p) {
+    int v = 0; // identity
+#ifdef WEBSERVER_ZLIB
+    if (!p.variants[compression::kGzip].head.empty() || !p.variants[compression::kDeflate].head.empty()) {
+        compression::Coding coding = compression::negotiate(req.headers.get("Accept-Encoding"));
+        if (!p.variants[coding].head.empty()) v = coding;
+    }
+#endif
+    const PrebuiltVariant& pre = p.variants[v];
+    bool keep_alive = shouldKeepAlive(req);
+    if (!keep_alive) c->want_close = true;
+    ChainBuffer& out = c->outbuf;
+    std::string_view inm = req.headers.get("If-None-Match");
+    if (!inm.empty() && etagMatches(inm, pre.etag)) {
+        out.append(pre.not_modified_head);
+        appendDateHeader(out);
+        out.append(pre.not_modified[keep_alive]);
+        return;
+    }
+    out.append(pre.head);
+    appendDateHeader(out);
+    const std::string& rest = pre.rest[keep_alive];
+    out.append(rest.data(), req.method_id == HttpMethod::kHead ? rest.size() - pre.body_size : rest.size());
+}
+
+// ===================== 响应压缩 =====================
+#ifdef WEBSERVER_ZLIB
+// 文件整个读进内存（只对不超过 MAX_COMPRESS_FILE 的文件调用）
+static bool readWholeFile(const CachedFile& f, std::string& out) {
+    out.resize(static_cast<size_t>(f.size));
+    size_t done = 0;
+    while (done < out.size()) {
+        ssize_t n = ::pread(f.fd, &out[done], out.size() - done, static_cast<off_t>(done));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// 可压缩的响应：先打上 Vary（不管这次压没压，缓存都得按 Accept-Encoding 区分），
+// 再按协商结果换成压缩后的 body；流式响应只挂一个压缩器，由 ChunkWriter 边写边压
+void SimpleWebServer::compressResponse(Conn* c, const HttpRequest& req, HttpResponse& res, bool head_only) {
+    int code = res.status_code;
+    if (code < 200 || code == 204 || code == 206 || code == 304) return;
+    if (res.headers.count("Content-Encoding")) return;
+    auto ct = res.headers.find("Content-Type");
+    if (ct == res.headers.end() || !compression::compressible(ct->second)) return;
+    if (!res.producer) {
+        size_t size = res.file ? res.file_length : res.body.size();
+        if (size < m_compress_min) return;
+        // 只压整个文件：Range 请求已经是 206，不会走到这里；太大的文件不读进内存
+        if (res.file && (res.file_offset != 0 || size != static_cast<size_t>(res.file->size) || size > MAX_COMPRESS_FILE)) {
+            return;
+        }
+    }
+    auto vary = res.headers.find("Vary");
+    if (vary == res.headers.end()) res.headers["Vary"] = "Accept-Encoding";
+    else vary->second += ", Accept-Encoding";
+
+    compression::Coding coding = compression::negotiate(req.headers.get("Accept-Encoding"));
+    if (coding == compression::kIdentity) return;
+
+    if (res.producer) {
+        // HEAD 不会发 body，不用建压缩器，头和 GET 一样写 Content-Encoding
+        if (!head_only) {
+            auto z = std::make_shared<compression::Deflater>(coding, m_compress_level);
+            if (!z->ok()) return;
+            c->producer_z = std::move(z);
+        }
+        res.headers["Content-Encoding"] = compression::codingName(coding);
+        return;
+    }
+
+    // 同一份内容只压一次：带 ETag 的响应按 ETag，静态文件按 inode + 大小 + mtime 做键
+    auto etag = res.headers.find("ETag");
+    std::string key;
+    if (res.file) {
+        key = "f:" + std::to_string(res.file->ino) + ":" + std::to_string(res.file->size) + ":" +
+              std::to_string(res.file->mtime);
+    } else if (etag != res.headers.end()) {
+        key = "e:" + etag->second;
+    }
+    if (!key.empty()) {
+        key += ':';
+        key += compression::codingName(coding);
+        key += ':';
+        key += std::to_string(m_compress_level);
+    }
+
+    compression::Cache::Body zipped = key.empty() ? nullptr : m_compress_cache.get(key);
+    if (!zipped) {
+        std::string file_body;
+        if (res.file && !readWholeFile(*res.file, file_body)) return;
+        const std::string& src = res.file ? file_body : res.body;
+        auto out = std::make_shared<std::string>();
+        if (!compression::compress(coding, m_compress_level, src, *out)) return;
+        zipped = std::move(out);
+        if (!key.empty()) m_compress_cache.put(key, zipped);
+    }
+    res.body = *zipped;
+    res.file.reset();
+    res.file_offset = 0;
+    res.file_length = 0;
+    res.headers["Content-Encoding"] = compression::codingName(coding);
+    if (etag != res.headers.end()) etag->second = compression::variantEtag(etag->second, coding);
+}
+#endif
+
+// ===================== 流式响应：chunked 编码 =====================
+void ChunkWriter::write(std::string_view data) {
+    if (data.empty()) return;
+#ifdef WEBSERVER_ZLIB
+    if (m_z) {
+        // 压缩器攒够一块才有输出，这次可能什么都不写
+        thread_local std::string zipped;
+        zipped.clear();
+        m_z->write(data, zipped);
+        emit(zipped);
+        return;
+    }
+#endif
+    emit(data);
+}
+
+void ChunkWriter::emit(std::string_view data) {
+    if (data.empty()) return;
+    if (m_chunked) {
+        char hex[24];
+        auto r = std::to_chars(hex, hex + sizeof(hex) - 2, data.size(), 16);
+        *r.ptr++ = '\r';
+        *r.ptr++ = '\n';
+        m_out.append(hex, r.ptr - hex);
+    }
+    m_out.append(data.data(), data.size());
+    if (m_chunked) m_out.append("\r\n", 2);
 }
 
-void SimpleWebServer::sendBadRequest(const std::shared_ptr<Conn>& c) {
+void ChunkWriter::finish() {
+#ifdef WEBSERVER_ZLIB
+    if (m_z) {
+        thread_local std::string zipped;
+        zipped.clear();
+        m_z->write(std::string_view(), zipped, Z_FINISH);
+        emit(zipped);
+    }
+#endif
+    if (m_chunked) m_out.append("0\r\n\r\n", 5);
+}
+
+// 还没发出去的字节：outbuf + 各段剩余 +（io_uring）在途的 sendbuf
+size_t SimpleWebServer::pendingOutputBytes(const Conn* c) {
+    size_t n = c->outbuf.readableBytes();
+    for (const auto& s : c->out_segs) n += s.remaining;
+#ifdef WEBSERVER_IO_URING
+    n += c->sendbuf.readableBytes();
+#endif
+    return n;
+}
+
+// 超过高水位暂停，发到低水位以下才恢复：不会在水位线附近每发一点就生成一点
+bool SimpleWebServer::outputPaused(Conn* c) {
+    size_t pending = pendingOutputBytes(c);
+    if (c->write_paused) {
+        if (pending >= m_write_low) return true;
+        c->write_paused = false;
+        return false;
+    }
+    if (pending >= m_write_high) {
+        c->write_paused = true;
+        return true;
+    }
+    return false;
+}
+
+bool SimpleWebServer::pumpProducer(Conn* c) {
+    ChunkWriter w(c->outbuf, c->producer_chunked, c->producer_z.get());
+    while (pendingOutputBytes(c) < m_write_high) {
+        if (!c->producer(w)) {
+            w.finish();
+            c->producer = nullptr;
+            c->producer_z.reset();
+            return true;
+        }
+    }
+    return false;
+}
+
+// 段排在 outbuf 当前末尾：before 要扣掉已经分给前面各段的字节
+void SimpleWebServer::queueSegment(Conn* c, OutSegment&& seg) {
+    size_t queued = 0;
+    for (const auto& s : c->out_segs) queued += s.before;
+    seg.before = c->outbuf.readableBytes() - queued;
+    c->out_segs.push_back(std::move(seg));
+}
+
+void SimpleWebServer::sendErrorResponse(Conn* c, int code) {
     HttpResponse r;
     r.version = "HTTP/1.1";
-    r.status_code = 400;
-    r.status_msg = "Bad Request";
+    r.status_code = code;
+    r.status_msg = status_code_to_message(code);
     r.headers["Content-Type"] = "text/plain";
-    r.body = "400 Bad Request";
-    r.headers["Content-Length"] = std::to_string(r.body.size());
+    r.body = std::to_string(code) + " " + r.status_msg;
     r.headers["Connection"] = "close";
     c->want_close = true;
-    append_response(c, r);
+    append_response(c, std::move(r));
 }
 
 // ===================== [MOD] worker 入口：一次事件尽可能读/解析/写，然后 rearm =====================
@@ -486,122 +1415,411 @@ void SimpleWebServer::sendBadRequest(const std::shared_ptr<Conn>& c) {
 // - EPOLLET 下读/写都要循环到 EAGAIN
 // - 不在 worker 里 sleep 不忙等：下一次请求靠 epoll 触发
 // ===================== [FIXED] worker 入口 =====================
-void SimpleWebServer::handle_io(int fd, uint32_t events) {
-    auto c = getConn(fd);
-    if (!c) return;
-
+void SimpleWebServer::handle_io(EventLoop& loop, Conn* c, uint32_t events) {
     if (events & (EPOLLERR | EPOLLHUP)) {
-        closeConnection(fd);
+        closeConnection(loop, c);
         return;
     }
-    // 【新增】只要有 IO 事件，就延长定时器
-    if (m_timer.getNextTick() > 0) { // 简单检查一下避免无效调用
-        m_timer.adjust(fd, TIMEOUT_MS);
-    }
-    // ----------------- [修复] 读事件：真正执行读取和解析 -----------------
+    // ----------------- [修复] 读事件：先把数据从内核读到 Buffer -----------------
     if (events & EPOLLIN) {
-        // 1. 尝试把数据从内核读到 Buffer
-        bool readAck = readToInbuf(c);
-        
         // 如果 readToInbuf 返回 true (EAGAIN 或 读到数据)，继续处理
         // 如果返回 false (对端关闭或出错)，直接断开
-        if (!readAck) {
-            closeConnection(fd);
+        uint64_t t0 = m_metrics ? metrics::nowTicks() : 0;
+        size_t before = c->inbuf.readableBytes();
+        bool ok = readToInbuf(c);
+        if (m_metrics) {
+            metrics::ThreadMetrics& m = metrics::local();
+            m.record(metrics::kRead, metrics::elapsedNs(t0));
+            size_t got = c->inbuf.readableBytes() - before;
+            m.add(metrics::kBytesIn, got);
+            if (got > 0) noteFirstByte(c);
+        }
+        if (!ok) {
+            closeConnection(loop, c);
             return;
         }
+    }
+
+    // ThreadPool 模式下这里已经在 worker 上（Interactive 通道），blocking 路由同样要挪到 Batch 通道，
+    // 否则慢请求就在 Interactive 任务里跑，照样挡住后面的请求处理
+    processRequests(loop, c, true);
+}
+
+// ===================== 解析 + 业务处理（处理粘包/Pipeline） =====================
+// req 里都是指向 inbuf 的视图：处理完一个请求才把它从 inbuf 里丢掉
+// 要关闭的连接（Connection: close / 解析出错）后面 pipeline 的请求不再处理
+// body 两种收法：
+// - 普通路由 + Content-Length：等整个 body 进 inbuf，handler 直接看视图（不拷贝）
+// - 流式路由 / chunked：头部拷出来，body 到一段交一段（pumpBody），inbuf 不会攒下整个 body
+void SimpleWebServer::processRequests(EventLoop& loop, Conn* c, bool offload) {
+#ifdef WEBSERVER_IO_URING
+    if (c->parked) {
+        if (c->send_inflight) return; // 还在等 SEND：后面的请求也不解析，保持顺序
+        std::unique_ptr<ParkedRequest> p = std::move(c->parked);
+        uringOffload(loop, c, std::move(p->req), p->route);
+        return;
+    }
+#endif
+    HttpRequest req;
+    while (true) {
+        // 输出积压太多：不再生成新的输出（producer 和后面的请求都等着），发到低水位以下由 EPOLLOUT 带回来
+        if (outputPaused(c)) break;
+        if (c->producer) {
+            if (!pumpProducer(c)) break;
+            continue; // 流式响应写完了，接着处理 pipeline 里后面的请求
+        }
+        if (c->want_close) break;
 
-        // 2. 循环处理 Buffer 中的请求（处理粘包/Pipeline）
-        HttpRequest req;
-        while (tryParseOneRequest(c, req)) {
-            HttpResponse res;
-            
-            // 保持连接逻辑
-            bool keep_alive = shouldKeepAlive(req);
-            
-            // 业务处理
-            build_response(req, res);
-            
-            // 设置 Connection 头
-            setConnectionHeader(res, keep_alive);
-            if (!keep_alive) c->want_close = true;
+        const Route* route = nullptr;
+        size_t consumed = 0;
+        if (c->body && c->body->active) {
+            if (pumpBody(c) != HttpParser::kComplete) break;
+            BodyState& b = *c->body;
+            if (b.streaming) {
+                respond(c, b.req, b.route, &b.sink);
+                b.sink = BodySink();
+                continue;
+            }
+            // chunked 收完了：body 在 b.buf 里，剩下的和普通请求一样（inbuf 里已经没有这个请求的字节）
+            req = b.req;
+            req.body = b.buf;
+            route = b.route;
+        } else {
+            uint64_t t0 = m_metrics ? metrics::nowTicks() : 0;
+            HttpParser::Result r = c->parser.parse(c->inbuf.peek(), c->inbuf.readableBytes(), req);
+            if (m_metrics) metrics::local().record(metrics::kParse, metrics::elapsedNs(t0));
+            if (r == HttpParser::kIncomplete) break;
+            if (r == HttpParser::kError) {
+                sendErrorResponse(c, c->parser.errorStatus());
+                c->inbuf.retrieveAll();
+                break;
+            }
+            route = findRouteHandler(req);
+            if (r == HttpParser::kHead) {
+                if (beginBody(c, req, route)) continue;
+                break; // 整块等 body（或者已经回了 413）
+            }
+            if (!(route && route->stream) && req.content_length > m_max_body_size) {
+                sendErrorResponse(c, 413);
+                c->inbuf.retrieveAll();
+                break;
+            }
+            consumed = c->parser.consumed();
+        }
 
-            // 追加到写缓冲区
-            append_response(c, res);
-            
-            // 重置 req 以便下一次循环使用
-            req = HttpRequest();
+        // 线程池任务已经太多：不再排队，直接 503 + 关连接（后面 pipeline 的请求一起丢掉）
+        if (offload && route && route->blocking && m_max_pending > 0 &&
+            static_cast<size_t>(m_inflight.load(std::memory_order_relaxed)) >= m_max_pending) {
+            m_stat_rejected_requests.fetch_add(1, std::memory_order_relaxed);
+            appendOverloadResponse(c->outbuf);
+            c->want_close = true;
+            c->inbuf.retrieveAll();
+            break;
         }
+
+        // blocking 路由不能卡住 reactor：连同后面 pipeline 的请求一起交给线程池。
+        // 此时 fd 还处于 ONESHOT 未 rearm 状态，所以不会有别的线程同时碰这个连接。
+        if (offload && route && route->blocking) {
+            EventLoop* lp = &loop;
+            req.own(); // worker 跑的时候 inbuf 可能被追加/搬家，请求先拷一份
+            c->inbuf.retrieve(consumed);
+#ifdef WEBSERVER_IO_URING
+            if (loop.ring) {
+                if (c->send_inflight) {
+                    // 在途 SEND 带着 out_segs 队首的 body，完成时 loop 要改它；worker 的 respond 也要往 out_segs 里追加。
+                    // 请求先停在连接上，SEND 完成后（uringOnSend）再交出去
+                    c->parked = std::make_unique<ParkedRequest>(ParkedRequest{std::move(req), route});
+                    break;
+                }
+                uringOffload(loop, c, std::move(req), route);
+                return;
+            }
+#endif
+            postToPool(
+                c, TaskLane::Batch, m_blocking_timeout_ms,
+                [this, lp, req = std::move(req), route](Conn* conn) {
+                    respond(conn, req, route);
+                    processRequests(*lp, conn, false);
+                },
+                [this, lp](Conn* conn) {
+                    expireBlocking(conn);
+                    processRequests(*lp, conn, false);
+                });
+            return;
+        }
+
+        respond(c, req, route);
+        c->inbuf.retrieve(consumed);
     }
 
+    // 这一轮的请求都处理完了：读空的 inbuf 把存储还回池里，收完的 body 状态也不留着，
+    // 空闲的 keep-alive 连接只剩 Conn 本身
+    if (c->inbuf.readableBytes() == 0) c->inbuf.release();
+    if (c->body && !c->body->active) c->body.reset();
+    flushAndRearm(loop, c);
+}
+
+#ifdef WEBSERVER_IO_URING
+// io_uring 下 multishot recv 一直在往 inbuf 里收，worker 只能碰 req 和输出队列（outbuf / out_segs；调用方保证没有在途的 SEND，
+// 交出去以后 uringFlush 看到 offloaded 也不会再发）。生成完响应就把连接交还给 loop，剩下的 pipeline 请求由 loop 接着解析
+void SimpleWebServer::uringOffload(EventLoop& loop, Conn* c, HttpRequest&& req, const Route* route) {
+    EventLoop* lp = &loop;
+    c->offloaded = true;
+    auto hand_back = [lp](Conn* conn) {
+        {
+            std::lock_guard<std::mutex> lk(lp->ready_mtx);
+            lp->ready.emplace_back(conn);
+        }
+        uint64_t one = 1;
+        ssize_t n = ::write(lp->wakeup_fd, &one, sizeof(one));
+        (void)n;
+    };
+    postToPool(
+        c, TaskLane::Batch, m_blocking_timeout_ms,
+        [this, hand_back, req = std::move(req), route](Conn* conn) {
+            respond(conn, req, route);
+            hand_back(conn);
+        },
+        [this, hand_back](Conn* conn) {
+            expireBlocking(conn);
+            hand_back(conn);
+        });
+}
+#endif
+
+// 头到了、body 还没到齐（parse 返回 kHead）
+bool SimpleWebServer::beginBody(Conn* c, HttpRequest& req, const Route* route) {
+    bool streaming = route && route->stream;
+    if (!streaming && req.content_length > m_max_body_size) {
+        sendErrorResponse(c, 413);
+        c->inbuf.retrieveAll();
+        return false;
+    }
+    // 客户端等我们点头再发 body（curl 上传大文件默认这样），不回的话它要干等 1 秒
+    if (req.version == "HTTP/1.1" && HttpHeaders::iequals(req.headers.get("Expect"), "100-continue")) {
+        c->outbuf.append("HTTP/1.1 100 Continue\r\n\r\n", 25);
+    }
+    if (!streaming && !req.chunked) return false; // Content-Length：等 body 到齐后 parse 返回 kComplete
+
+    if (!c->body) c->body = std::make_unique<BodyState>();
+    BodyState& b = *c->body;
+    req.own();
+    c->inbuf.retrieve(c->parser.consumed());
+    b.req = req;
+    b.route = route;
+    b.streaming = streaming;
+    if (b.buf.capacity() > INBUF_HIGH_WATER) std::string().swap(b.buf); // 上一个大 body 的空间不留着
+    b.buf.clear();
+    if (streaming) b.sink = route->stream(b.req);
+    b.active = true;
+    return true;
+}
+
+// 把 inbuf 里能解出来的 body 都交出去；返回 kComplete 表示 body 收完，kIncomplete 表示要等数据，kError 已经回了错误
+HttpParser::Result SimpleWebServer::pumpBody(Conn* c) {
+    BodyState& b = *c->body;
+    while (true) {
+        std::string_view frag;
+        HttpParser::Result r = c->parser.parseBody(c->inbuf.peek(), c->inbuf.readableBytes(), frag);
+        int error = r == HttpParser::kError ? c->parser.errorStatus() : 0;
+        if (!error && !frag.empty()) {
+            if (b.streaming) {
+                if (b.sink.on_data) b.sink.on_data(frag);
+            } else if (b.buf.size() + frag.size() > m_max_body_size) {
+                error = 413;
+            } else {
+                b.buf.append(frag.data(), frag.size());
+            }
+        }
+        if (error) {
+            b.active = false;
+            b.sink = BodySink();
+            sendErrorResponse(c, error);
+            c->inbuf.retrieveAll();
+            return HttpParser::kError;
+        }
+        size_t n = c->parser.consumed();
+        c->inbuf.retrieve(n);
+        if (r == HttpParser::kComplete) {
+            b.active = false;
+            return r;
+        }
+        if (n == 0) return HttpParser::kIncomplete;
+    }
+}
+
+void SimpleWebServer::respond(Conn* c, const HttpRequest& req, const Route* route, BodySink* sink) {
+    metrics::ThreadMetrics* m = m_metrics ? &metrics::local() : nullptr;
+    uint64_t t0 = 0;
+    if (m) {
+        m->add(metrics::kRequests);
+        if (c->requests > 0) m->add(metrics::kKeepAliveReuse);
+        t0 = metrics::nowTicks();
+    }
+    ++c->requests;
+    if (route && route->prebuilt) {
+        respondPrebuilt(c, req, *route->prebuilt);
+        if (m) m->record(metrics::kSerialize, metrics::elapsedNs(t0));
+        return;
+    }
+    HttpResponse res;
+
+    // 保持连接逻辑
+    bool keep_alive = shouldKeepAlive(req);
+
+    // 业务处理
+    build_response(req, route, res, sink);
+    if (m) {
+        uint64_t t1 = metrics::nowTicks();
+        m->record(metrics::kHandler, metrics::ticksToNs(t1 - t0));
+        t0 = t1;
+    }
+
+    // 流式响应给 HTTP/1.0 客户端：没有 chunked，只能靠关连接表示结束
+    bool chunked = req.version != "HTTP/1.0";
+    if (res.producer && !chunked) keep_alive = false;
+
+    // 设置 Connection 头
+    setConnectionHeader(res, keep_alive);
+    if (!keep_alive) c->want_close = true;
+
+    bool head_only = req.method_id == HttpMethod::kHead;
+#ifdef WEBSERVER_ZLIB
+    if (m_compression) compressResponse(c, req, res, head_only);
+#endif
+
+    // 追加到写缓冲区；HEAD：头（包括 Content-Length）和 GET 一样，但不发 body
+    append_response(c, std::move(res), head_only, chunked);
+    if (m) m->record(metrics::kSerialize, metrics::elapsedNs(t0));
+}
+
+void SimpleWebServer::flushAndRearm(EventLoop& loop, Conn* c) {
+#ifdef WEBSERVER_IO_URING
+    if (loop.ring) {
+        uringFlush(loop, c);
+        uringPaceRecv(loop, c); // inbuf 消化到上限以下 / 暂停解除了：recv 重新挂上
+        return;
+    }
+#endif
     // ----------------- 写事件 / 或者 outbuf 有积压数据就尝试写 -----------------
-    if ((events & EPOLLOUT) || c->outbuf.readableBytes() > 0) {
-        if (!writeFromOutbuf(c)) {
-            closeConnection(fd);
+    if (hasPendingOutput(c)) {
+        uint64_t t0 = m_metrics ? metrics::nowTicks() : 0;
+        size_t before = m_metrics ? pendingOutputBytes(c) : 0;
+        bool ok = writeFromOutbuf(c);
+        if (m_metrics) {
+            metrics::ThreadMetrics& m = metrics::local();
+            m.record(metrics::kWrite, metrics::elapsedNs(t0));
+            m.add(metrics::kBytesOut, before - pendingOutputBytes(c));
+        }
+        if (!ok) {
+            closeConnection(loop, c);
             return;
         }
     }
 
     // ----------------- 优雅关闭逻辑 -----------------
-    if (c->want_close && c->outbuf.readableBytes() == 0) {
-        closeConnection(fd);
+    if (c->want_close && !hasPendingOutput(c) && !c->producer) {
+        closeConnection(loop, c);
         return;
     }
 
     // ----------------- rearm ONESHOT -----------------
-    if (c->outbuf.readableBytes() > 0) {
-        rearm(fd, EPOLLOUT | EPOLLET);
+    // 还有要生成的输出（流式响应 / 水位暂停）时也等可写：就算已经发空了，EPOLLOUT 也会马上回来继续
+    if (hasPendingOutput(c) || c->producer || c->write_paused) {
+        rearm(loop, c, EPOLLOUT | EPOLLET);
     } else {
-        rearm(fd, EPOLLIN | EPOLLET);
+        rearm(loop, c, EPOLLIN | EPOLLET);
     }
 }
 
 // ===================== 路由注册 =====================
-void SimpleWebServer::get(const std::string& path, HandlerFunc handler) { m_get_routes[path] = handler; }
-void SimpleWebServer::post(const std::string& path, HandlerFunc handler) { m_post_routes[path] = handler; }
-void SimpleWebServer::any(const std::string& path, HandlerFunc handler) { m_any_routes[path] = handler; }
+void SimpleWebServer::get(const std::string& path, HandlerFunc handler, bool blocking) { addRoute(HttpMethod::kGet, path, {std::move(handler), blocking, nullptr, nullptr}); }
+void SimpleWebServer::post(const std::string& path, HandlerFunc handler, bool blocking) { addRoute(HttpMethod::kPost, path, {std::move(handler), blocking, nullptr, nullptr}); }
+void SimpleWebServer::any(const std::string& path, HandlerFunc handler, bool blocking) { addRoute(HttpMethod::kOther, path, {std::move(handler), blocking, nullptr, nullptr}); }
+void SimpleWebServer::route(HttpMethod method, const std::string& path, HandlerFunc handler, bool blocking) { addRoute(method, path, {std::move(handler), blocking, nullptr, nullptr}); }
+void SimpleWebServer::postStream(const std::string& path, StreamHandlerFunc handler) { addRoute(HttpMethod::kPost, path, {nullptr, false, std::move(handler), nullptr}); }
+
+void SimpleWebServer::getPrebuilt(const std::string& path, const std::string& content_type, std::string body,
+                                  const std::unordered_map<std::string, std::string>& headers) {
+    auto pre = std::make_shared<Prebuilt>();
+    pre->content_type = content_type;
+    pre->body = std::move(body);
+    pre->headers = headers;
+    m_prebuilts.push_back(pre);
+    Route route;
+    route.prebuilt = std::move(pre);
+    addRoute(HttpMethod::kGet, path, std::move(route));
+}
+
+void SimpleWebServer::addRoute(HttpMethod method, const std::string& path, Route route) {
+    bool ok = method == HttpMethod::kOther ? m_router.addAny(path, std::move(route))
+                                           : m_router.add(method, path, std::move(route));
+    if (!ok) Logger::getInstance().error("Invalid or conflicting route pattern: " + path);
+}
 
 // ===================== 清理资源 =====================
 void SimpleWebServer::cleanup() {
-    if (m_epoll_fd != -1) {
-        close(m_epoll_fd);
-        m_epoll_fd = -1;
+    // 线程池里还有任务在用 Conn / EventLoop：等它们跑完
+    while (m_inflight.load(std::memory_order_acquire) > 0) {
+        std::this_thread::yield();
     }
 
-    if (m_server_socket) {
-        delete m_server_socket;
-        m_server_socket = nullptr;
-    }
+    for (auto& loop : m_loops) {
+        if (loop->epoll_fd != -1) {
+            close(loop->epoll_fd);
+            loop->epoll_fd = -1;
+        }
+        if (loop->wakeup_fd != -1) {
+            close(loop->wakeup_fd);
+            loop->wakeup_fd = -1;
+        }
+        loop->listener.reset();
+        loop->listen_fd = -1;
+        if (loop->reserve_fd != -1) {
+            close(loop->reserve_fd);
+            loop->reserve_fd = -1;
+        }
+#ifdef WEBSERVER_IO_URING
+        {
+            std::lock_guard<std::mutex> lk(loop->ready_mtx);
+            loop->ready.clear(); // 还没交还给 loop 的连接：放掉引用（可能回收到下面的空闲链表）
+        }
+        loop->ring.reset();
+#endif
 
-    // [MOD] 关闭所有活跃连接（Conn 表）
-    {
-        std::lock_guard<std::mutex> lk(m_conns_mtx);
-        for (auto& [fd, _] : m_conns) {
-            ::close(fd);
+        // 释放池里的空闲 Conn
+        std::lock_guard<std::mutex> lk(loop->free_mtx);
+        while (loop->free_conns) {
+            Conn* c = loop->free_conns;
+            loop->free_conns = c->next_free;
+            delete c;
         }
-        m_conns.clear();
     }
+
+    // [MOD] 关闭所有活跃连接（Conn 表）：Conn 里的 Socket 析构时会 close(fd)
+    if (m_conns) {
+        m_conns->forEach([](int, Conn* c) { delete c; });
+        m_conns.reset();
+    }
+    m_loops.clear();
 }
 
+// 可能在信号处理函数里被调用：只置标志 + 写 eventfd，真正的清理由 start() 收尾
 void SimpleWebServer::stop() {
     m_running = false;
-    if (m_server_socket != nullptr) {
-        m_server_socket->close();
-    }
-    if (m_epoll_fd != -1) {
-        close(m_epoll_fd);
-        m_epoll_fd = -1;
+    for (auto& loop : m_loops) {
+        if (loop->wakeup_fd != -1) {
+            uint64_t one = 1;
+            ssize_t n = ::write(loop->wakeup_fd, &one, sizeof(one));
+            (void)n;
+        }
     }
 }
 
 // ===================== 状态码到消息 =====================
 std::string SimpleWebServer::status_code_to_message(int code) {
-    static std::unordered_map<int, std::string> messages = {
-        {200, "OK"},
-        {400, "Bad Request"},
-        {404, "Not Found"},
-        {500, "Internal Server Error"}
-    };
-    auto it = messages.find(code);
-    if (it != messages.end()) return it->second;
+    for (const auto& st : kStatusTexts) {
+        if (st.code == code) return st.msg;
+    }
     return "Unknown Status";
 }
\ No newline at end of file
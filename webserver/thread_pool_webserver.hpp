@@ -5,22 +5,51 @@
 #include <unordered_map>
 #include <functional>
 #include <vector>
-#include <memory>          // [MOD] Conn 表用 shared_ptr/unique_ptr
+#include <list>
+#include <memory>          // [MOD] Conn 托管 Socket 用 unique_ptr
 #include <mutex>           // [MOD] Conn 表多线程访问需要互斥锁
+#include <thread>
+#include <atomic>
 #include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <algorithm>
 #include <sstream>
 #include"Buffer.hpp"
-#include "heapTimer.hpp"
-// ===================== HTTP请求结构体 =====================
-// [KEEP] 保留你的定义。注意：std::string 可以存二进制（含 '\0'），前提是你必须按长度处理，不能用 C 字符串逻辑。
-typedef struct {
-    std::string method;
-    std::string path;
-    std::string version;
-    std::unordered_map<std::string, std::string> headers;
-    std::string body;
-} HttpRequest;
+#include "chainBuffer.hpp"  // 输出缓冲：16 KB 块串成的链，writev 直接发，不扩容不搬移
+#include "timingWheel.hpp"
+#include "fdTable.hpp"
+#include "fileCache.hpp"
+#include "httpParser.hpp"   // HttpRequest（string_view 视图）+ 增量解析器
+#include "radixRouter.hpp"  // 按方法分树的压缩前缀树路由
+#include "metrics.hpp"      // 每线程的分阶段耗时直方图 + 计数器
+#include "../thread_learning/task_lanes.hpp" // 线程池的优先级通道
+#ifdef WEBSERVER_ZLIB
+#include "compression.hpp"  // gzip / deflate 响应压缩
+#endif
+namespace compression { class Deflater; } // 没开 zlib 时只有声明，指针永远为空
+
+// ===================== 流式响应 =====================
+// handler 不想（或不能）把整个 body 放进内存时，不填 body，改填 HttpResponse::producer：
+// 头部先发出去（Transfer-Encoding: chunked），之后服务器在输出积压低于水位时反复调用 producer，
+// 它每次往 ChunkWriter 里写一块或几块，返回 false 表示写完了（服务器补上结束块）。
+// 积压超过高水位就不再调用（暂停），等 EPOLLOUT 把数据发到低水位以下再接着调，内存占用有上限。
+// producer 在连接所属的 loop 线程（ThreadPool 模式下是 worker）上执行，不要阻塞；
+// 每次调用要么写点东西，要么返回 false。开了压缩时写进来的是明文，ChunkWriter 压缩后再分块
+class ChunkWriter {
+public:
+    void write(std::string_view data);   // 空数据忽略（空块在 chunked 编码里表示结束）
+private:
+    friend class SimpleWebServer;
+    ChunkWriter(ChainBuffer& out, bool chunked, compression::Deflater* z = nullptr)
+        : m_out(out), m_chunked(chunked), m_z(z) {}
+    void emit(std::string_view data);    // 写一块（已经压缩过的）
+    void finish();
+    ChainBuffer& m_out;
+    bool m_chunked;                      // false：HTTP/1.0 客户端，原样写，靠关闭连接表示结束
+    compression::Deflater* m_z;          // 非空：Content-Encoding 是 gzip / deflate
+};
+using ResponseProducer = std::function<bool(ChunkWriter&)>;
 
 // ===================== HTTP响应结构体 =====================
 typedef struct {
@@ -29,40 +58,222 @@ typedef struct {
     std::string status_msg;
     std::unordered_map<std::string, std::string> headers;
     std::string body;
+    // 文件响应：body 为空，由发送路径直接从 fd 发 [file_offset, file_offset + file_length)
+    std::shared_ptr<const CachedFile> file;
+    off_t file_offset = 0;
+    size_t file_length = 0;
+    // 流式响应：非空时 body（如果有）作为第一块，后面的由 producer 生成
+    ResponseProducer producer;
 } HttpResponse;
 
+// ===================== 流式请求体 =====================
+// postStream 路由用：头部一到就调 handler 拿到一个 BodySink，之后 body 每到一段（chunked 已解码）调一次 on_data，
+// 收完调 on_end 填响应。body 不在 inbuf 里攒，上传多大连接占的内存都不变。
+// 连接中途断开、chunked 格式错误时 on_end 不会被调用（sink 随连接一起销毁）
+struct BodySink {
+    std::function<void(std::string_view)> on_data;   // 视图只在调用期间有效
+    std::function<void(HttpResponse&)> on_end;
+};
+
 // Forward declaration
 class Socket;
 class SimpleThreadPool;
+#ifdef WEBSERVER_IO_URING
+class IoUring;
+#endif
 
 // ===================== Web服务器类 =====================
 class SimpleWebServer {
 public:
-    SimpleWebServer(int port = 8080);
+    // loop_num：事件循环（reactor）个数；<=0 表示每个核心一个
+    SimpleWebServer(int port = 8080, int loop_num = 1);
     ~SimpleWebServer();
 
     void start();
     void stop();
 
+    // 多 reactor 模式：必须在 start() 之前调用
+    void setLoopNum(int loop_num);
+
     using HandlerFunc = std::function<void(const HttpRequest&, HttpResponse&)>;
 
-    void get(const std::string& path, HandlerFunc handler);
-    void post(const std::string& path, HandlerFunc handler);
-    void any(const std::string& path, HandlerFunc handler);
+    // blocking = true：handler 可能阻塞（查库、读大文件……），Inline 模式下也会被挪到线程池执行
+    // path 可以带参数：/users/:id 匹配一段，/files/*path 匹配剩下的全部，handler 里用 req.param("id") 取；
+    // 同一位置静态段优先于参数、参数优先于通配。HEAD 没有单独注册时走 GET 的路由
+    void get(const std::string& path, HandlerFunc handler, bool blocking = false);
+    void post(const std::string& path, HandlerFunc handler, bool blocking = false);
+    void any(const std::string& path, HandlerFunc handler, bool blocking = false);
+    void route(HttpMethod method, const std::string& path, HandlerFunc handler, bool blocking = false);
+
+    // 流式 POST：handler 在头部解析完时调用（req.body 为空），返回的 BodySink 逐段接收 body；
+    // 在 loop 线程上执行，on_data 里不要做阻塞操作
+    using StreamHandlerFunc = std::function<BodySink(const HttpRequest&)>;
+    void postStream(const std::string& path, StreamHandlerFunc handler);
+    // 普通（非流式）路由的请求体上限，超了回 413；chunked 解码后的长度也算。默认 8 MB，必须在 start() 之前调用
+    void setMaxBodySize(size_t bytes);
+
+    // 固定内容的 GET 路由：整个响应（状态行、头、body）注册时序列化一次，之后每个请求只拷贝字节 + 补一个 Date 头，
+    // 不调 handler、不建 HttpResponse。自动带上按 body 算的强 ETag（headers 里给了 ETag 就用给的），
+    // If-None-Match 命中时回预先拼好的 304。body 会整段拷进 outbuf，适合小而热的端点
+    void getPrebuilt(const std::string& path, const std::string& content_type, std::string body,
+                     const std::unordered_map<std::string, std::string>& headers = {});
+
+    // ===================== 响应压缩 =====================
+    // 客户端 Accept-Encoding 接受 gzip / deflate、Content-Type 是文本类、body 不小于 min_size 时压缩（zlib，level 1~9）；
+    // 流式响应边生成边压。带 ETag 的响应和静态文件的压缩结果放进 LRU（按字节数限容量），同一份内容只压一次；
+    // getPrebuilt 路由在 start() 里预先压好各个编码的版本。Range 请求、206/304 不压缩。
+    // 默认开启：1 KB 起压，level 6，缓存 16 MB。都必须在 start() 之前调用；编译时没有 zlib 则不生效
+    void setCompression(bool enabled, size_t min_size = 1024, int level = 6);
+    void setCompressionCache(size_t bytes);
+
+    // 静态文件：GET/HEAD prefix 开头的路径映射到 root_dir 下的文件，用 sendfile 零拷贝发送
+    // 支持 Range（单区间）和 If-Modified-Since；打开的 fd 和 stat 结果缓存在 FileCache 里
+    void serveStatic(const std::string& prefix, const std::string& root_dir, bool blocking = false);
+
+    // ===================== 请求分发方式 =====================
+    // Auto      ：1 个 loop 用 ThreadPool，多个 loop 用 Inline（默认）
+    // ThreadPool：每个就绪事件都 post 到 SimpleThreadPool，由 worker 执行 handle_io
+    // Inline    ：run-to-completion，handle_io 直接在 loop 线程执行，只有 blocking 路由才进线程池
+    enum class DispatchMode { Auto, ThreadPool, Inline };
+    void setDispatchMode(DispatchMode mode);
+
+    // ===================== I/O 后端 =====================
+    // Epoll  ：epoll_wait + readv/send，每个请求一次 epoll_ctl(MOD) rearm（默认）
+    // IoUring：multishot accept + 提供缓冲区的 multishot recv + 链式 send，一次 io_uring_enter 批量提交/收割
+    //          编译时没开 WEBSERVER_IO_URING，或者内核不支持（建环/注册缓冲区失败）时自动退回 Epoll
+    //          io_uring 后端总是 run-to-completion，只有 blocking 路由进线程池
+    enum class IoBackend { Epoll, IoUring };
+    void setBackend(IoBackend backend);
+
+    // ===================== 监听方式 =====================
+    // ReusePort：每个 loop 一个 SO_REUSEPORT 监听 socket，内核按四元组分流（默认）
+    // Shared   ：所有 loop 共用一个监听 socket，epoll 用 EPOLLEXCLUSIVE 注册，一个新连接只叫醒一个 loop
+    enum class ListenMode { ReusePort, Shared };
+    void setListenMode(ListenMode mode);
+    // loop i 绑到允许的第 i 个 CPU 上（按 NUMA 节点排序，CPU 比 loop 少时轮着绑），默认不绑；必须在 start() 之前调用。
+    // 不管绑不绑，loop 1.. 的线程都叫 loop-<i>（loop 0 是 start() 的调用线程，不改它的名字）
+    void setPinLoops(bool enabled);
+    // 每次监听 socket 可读时最多连续 accept 多少个（读到 EAGAIN 会提前结束）；必须在 start() 之前调用
+    void setAcceptBatch(int n);
+    // 输出积压水位：超过 high 就暂停生成输出（流式响应的 producer、pipeline 里后面的请求），
+    // 发到 low 以下再继续。默认 64 KB / 256 KB，必须在 start() 之前调用
+    void setWriteWatermarks(size_t low, size_t high);
+
+    // ===================== 过载保护 =====================
+    // 上限：连接总数、每个 loop 的连接数、线程池里的任务数（排队 + 在跑），0 表示不限（默认都不限）。
+    // 超过任一上限时新连接按 OverloadAction 处理：
+    //   Reject     ：照常 accept，直接回一个预先拼好的 503（带 Retry-After）然后关掉，客户端马上知道要退避（默认）
+    //   PauseAccept：这个连接同样回 503，然后把监听 socket 从 epoll 摘掉（io_uring 下取消 multishot accept），
+    //                新连接留在内核 backlog 里排队；各项回落到上限的 7/8 以下再恢复 accept
+    // 任务数超限时，要交给线程池的 blocking 路由也不再排队，直接回 503。
+    // 已经接进来的连接照常服务：过载时先保住它们的吞吐，而不是所有人一起变慢。都必须在 start() 之前调用
+    enum class OverloadAction { Reject, PauseAccept };
+    void setConnectionLimits(size_t max_total, size_t max_per_loop = 0);
+    void setMaxPendingTasks(size_t max_tasks);
+    void setOverloadAction(OverloadAction action, int retry_after_sec = 1);
+    // 线程池分通道排队：reactor 投过去的读写处理走 Interactive，blocking 路由走 Batch，
+    // 一批慢请求排着队时普通请求照样按权重先出队。blocking 请求排队超过 ms 毫秒还没轮到就不再执行，
+    // 回 503（和任务数超限一样，计入 rejected_requests）并关连接；0 表示不限（默认）。必须在 start() 之前调用
+    void setBlockingQueueTimeout(int ms);
+
+    struct OverloadStats {
+        uint64_t accepted = 0;           // 接进来并注册的连接
+        uint64_t rejected = 0;           // accept 之后直接回 503 关掉的连接
+        uint64_t rejected_requests = 0;  // 线程池任务太多，回 503 的 blocking 请求
+        uint64_t shed = 0;               // fd 用光（EMFILE/ENFILE）时拒掉的连接
+        uint64_t accept_pauses = 0;      // 暂停 accept 的次数
+        size_t connections = 0;          // 当前连接数
+        size_t pending_tasks = 0;        // 当前线程池里的任务数
+        size_t paused_loops = 0;         // 当前暂停 accept 的 loop 数
+    };
+    // 任意线程都可以调；各项分别读取，彼此之间不是同一时刻的快照
+    OverloadStats overloadStats() const;
+
+    // ===================== 运行指标 =====================
+    // 每个线程各记一份分阶段耗时直方图（accept 到首字节、读、解析、handler、组包、写）和计数器
+    // （收发字节、请求数、keep-alive 复用、rearm 次数），GET path 时才汇总，按 Prometheus 文本格式返回，
+    // 连同上面的过载计数一起。记录一个样本几纳秒，主要开销是每个阶段两次 rdtsc（见 bench/metrics_bench）。
+    // 默认开启、路径 /metrics；path 为空只记录不注册路由（自己调 renderMetrics）。必须在 start() 之前调用
+    void setMetrics(bool enabled, const std::string& path = "/metrics");
+    void renderMetrics(std::string& out) const;
 
 private:
     // ===================== 网络相关 =====================
     int m_port;
-    Socket* m_server_socket;
-    int m_epoll_fd;
+    int m_loop_num;
+    DispatchMode m_dispatch_mode;
+    IoBackend m_backend;
+    ListenMode m_listen_mode;
+    int m_accept_batch;
+    bool m_pin_loops = false;
+    static const int DEFAULT_ACCEPT_BATCH = 64;
     static const int MAX_EVENTS = 1000;
-    bool m_running;
-    heapTimer m_timer; // 定时器管理器
+    std::atomic<bool> m_running;
+    std::atomic<int> m_inflight{0};  // 已投递到线程池还没跑完的任务数；停机时要等它归零
     static const int TIMEOUT_MS = 60000; // 默认超时时间 60秒（Keep-Alive）
+    size_t m_max_body_size;
+    static constexpr size_t DEFAULT_MAX_BODY = 8 << 20;
+    static constexpr size_t INBUF_HIGH_WATER = 256 * 1024; // 一次读事件最多把 inbuf 读到多大（整块等 body 时放宽到整个请求）
+    size_t m_write_low;
+    size_t m_write_high;
+    static constexpr size_t DEFAULT_WRITE_LOW = 64 * 1024;
+    static constexpr size_t DEFAULT_WRITE_HIGH = 256 * 1024;
+    // ===================== 过载保护 =====================
+    size_t m_max_conns = 0;
+    size_t m_max_loop_conns = 0;
+    size_t m_max_pending = 0;
+    OverloadAction m_overload_action = OverloadAction::Reject;
+    int m_retry_after = 1;
+    int m_blocking_timeout_ms = 0;
+    std::string m_overload_head;                  // 503 的状态行 + Server（Date 在发送时插进来）
+    std::string m_overload_rest;                  // Date 之后的头 + body
+    std::atomic<size_t> m_conn_count{0};
+    std::atomic<int> m_paused_loops{0};
+    std::atomic<uint64_t> m_stat_accepted{0};
+    std::atomic<uint64_t> m_stat_rejected{0};
+    std::atomic<uint64_t> m_stat_rejected_requests{0};
+    std::atomic<uint64_t> m_stat_shed{0};
+    std::atomic<uint64_t> m_stat_pauses{0};
+    bool m_metrics = true;
+    std::string m_metrics_path = "/metrics";
     // ===================== 路由表 =====================
-    std::unordered_map<std::string, HandlerFunc> m_get_routes;
-    std::unordered_map<std::string, HandlerFunc> m_post_routes;
-    std::unordered_map<std::string, HandlerFunc> m_any_routes;
+    // getPrebuilt 的响应：Date 头每秒都变，所以按 Date 前 / Date 后拆开存，发送时中间插一行 Date
+    struct PrebuiltVariant {
+        std::string head;              // 状态行 + Server；空表示没有这个编码的版本
+        std::string rest[2];           // Date 之后的头 + 空行 + body；下标 1 是 keep-alive，0 是 close
+        size_t body_size = 0;          // HEAD 请求从 rest 末尾去掉这么多
+        std::string etag;              // 比较用的形式（去掉了 W/ 前缀）
+        std::string not_modified_head; // 304 的状态行 + Server
+        std::string not_modified[2];   // 304 Date 之后的部分（ETag、缓存相关头、Connection）
+    };
+    struct Prebuilt {
+        PrebuiltVariant variants[3];   // 下标是编码：0 identity，1 gzip，2 deflate（compression::Coding）
+        // 注册时的原始内容：start() 里按压缩设置生成各个版本，然后清空
+        std::string content_type;
+        std::string body;
+        std::unordered_map<std::string, std::string> headers;
+    };
+    struct Route {
+        HandlerFunc handler;
+        bool blocking = false;   // true：不在 reactor 线程上跑
+        StreamHandlerFunc stream; // 非空：流式路由（handler 为空，不会是 blocking）
+        std::shared_ptr<const Prebuilt> prebuilt; // 非空：固定响应，直接拷字节
+    };
+    RadixRouter<Route> m_router;  // 静态文件路由注册成 prefix*path 通配
+    void addRoute(HttpMethod method, const std::string& path, Route route); // method 为 kOther 表示不限方法
+    FileCache m_file_cache;
+    std::vector<std::shared_ptr<Prebuilt>> m_prebuilts; // 等 start() 序列化的 getPrebuilt 路由
+    bool m_compression = true;
+    size_t m_compress_min = 1024;
+    int m_compress_level = 6;
+    static constexpr size_t MAX_COMPRESS_FILE = 1 << 20; // 静态文件超过这个大小就不压（要整个读进内存）
+#ifdef WEBSERVER_ZLIB
+    compression::Cache m_compress_cache;
+#endif
+    static constexpr size_t SENDFILE_CHUNK = 1 << 20;  // 单次 sendfile 最多发多少
+    static constexpr size_t READ_SCRATCH = 64 * 1024;  // 每个 reactor 线程共用的读暂存区
+    static constexpr int SEND_IOV = 32;                // 一次 writev / SENDMSG 最多带 outbuf 的几个块（32 * 16 KB）
+    static constexpr size_t BODY_REF_THRESHOLD = 16 * 1024; // body 超过这个大小就不拷进 outbuf，挂成段直接 writev
 
     // =====================================================================
     // [MOD] 新增：Conn 连接上下文 + Conn 表（fd -> Conn）
@@ -72,21 +283,136 @@ private:
     // 2) HTTP 是流式协议，会发生半包/粘包/keep-alive 多请求，必须有 inbuf/outbuf 保存状态
     // 3) 非阻塞 send 可能部分写，需要 outbuf 支持“未发送完继续发”
     // =====================================================================
+    struct EventLoop;
+
+    // 输出队列里的外部段：先发完 outbuf 里的 before 个字节，再从段里发 remaining 个字节
+    // 段的内容要么是文件（sendfile），要么是从 HttpResponse 移过来的大 body（writev，不拷进 outbuf）
+    // （before 是相对前一个段的，outbuf 后面追加数据不会影响已经排队的段）
+    struct OutSegment {
+        size_t before = 0;
+        std::shared_ptr<const CachedFile> file;  // 非空：文件段
+        std::string body;                        // 文件为空时：内存段
+        off_t offset = 0;                        // 文件偏移 / body 里的下标
+        size_t remaining = 0;
+    };
+
+#ifdef WEBSERVER_IO_URING
+    // 多块 SENDMSG 的参数：内核在 SEND 完成前都可能读它，所以不能放栈上
+    struct SendVec {
+        struct msghdr msg {};
+        struct iovec iov[SEND_IOV + 1] {};       // sendbuf 的块 + 最后可能跟一个大 body
+    };
+
+    // 等在途 SEND 完成才能交给线程池的 blocking 请求（头部和 body 都已经拷出来，inbuf 里没有它的字节了）
+    struct ParkedRequest {
+        HttpRequest req;
+        const Route* route = nullptr;
+    };
+#endif
+
+    // 逐段收 body 的状态（流式路由，或 chunked 请求）：头部已经拷出来，inbuf 里只剩 body
+    struct BodyState {
+        bool active = false;
+        bool streaming = false;                  // true：交给 sink；false：解码后攒进 buf，收完按普通请求处理
+        HttpRequest req;                         // 已 own() 的请求头
+        const Route* route = nullptr;
+        BodySink sink;
+        std::string buf;                         // 不超过 m_max_body_size
+    };
+
     struct Conn {
         int fd = -1;                             // [MOD] 连接 fd
+        uint32_t gen = 0;                        // 代数：每次从池里取出都会变，epoll 事件里带着它识别过期事件
         std::unique_ptr<Socket> sock;            // [MOD] Conn 托管 Socket 生命周期（避免裸指针）
-        Buffer inbuf;                       // [MOD] 读缓冲区：半包/粘包/keep-alive 需要
-        Buffer outbuf;                      // [MOD] 写缓冲区：部分写/大响应/文件传输需要
+        Buffer inbuf;                            // [MOD] 读缓冲区：半包/粘包/keep-alive 需要（有数据才拿存储，读空就还回每线程池）
+        ChainBuffer outbuf;                      // [MOD] 写缓冲区：部分写/大响应/文件传输需要（分块链，积压再大也不搬数据）
+        HttpParser parser;                       // 增量解析状态：半包时记住扫描到哪里
+        std::list<OutSegment> out_segs;          // 和 outbuf 交错发送的外部段（文件 / 大 body）；list 空的时候不分配（deque 空的也要 ~600 字节）
+        std::unique_ptr<BodyState> body;         // 第一次逐段收 body 时才分配，之后连接复用
+        ResponseProducer producer;               // 正在流式发送的响应：写完之前不处理 pipeline 里后面的请求
+        bool producer_chunked = false;
+        std::shared_ptr<compression::Deflater> producer_z; // 流式响应的压缩器（没压缩为空）
+        bool write_paused = false;               // 积压超过高水位，还没发到低水位以下
         bool want_close = false;                 // [MOD] 标记是否需要关闭连接
+        uint64_t accept_ticks = 0;               // accept 时的 metrics::nowTicks()；读到第一个字节后清零
+        uint32_t requests = 0;                   // 这个连接上已经回了几个请求（keep-alive 复用计数）
+        EventLoop* loop = nullptr;               // 所属事件循环：连接整个生命周期都留在这个 loop 上
+        std::atomic<int> busy{0};                // 正在线程池里处理的任务数；>0 时超时回调不能关它
+        std::atomic<int> refs{0};                // 引用计数：连接表持有 1 个，投递到线程池的任务各持有 1 个
+        Conn* next_free = nullptr;               // 空闲链表指针（在池里时才有意义）
+#ifdef WEBSERVER_IO_URING
+        // io_uring 后端：内核直接读 sendbuf 的块，发送期间不能释放，所以和 outbuf 分开（整块挪过来，不拷贝）
+        ChainBuffer sendbuf;
+        bool send_inflight = false;              // 有一个 SEND 在内核里
+        bool shut_linked = false;                // SEND 后面链了 SHUTDOWN：等它完成再 close，否则 fd 复用后会 shutdown 到新连接
+        bool offloaded = false;                  // blocking 路由在线程池里跑：这期间 loop 不解析，recv 也停着
+        bool send_body = false;                  // 在途的 SENDMSG 第二块是 out_segs 队首的 body
+        uint64_t send_ticks = 0;                 // 在途 SEND 的提交时间（metrics 的 write 阶段）
+        std::unique_ptr<SendVec> send_vec;       // 多块 SENDMSG 才分配，发空了就释放：空闲连接不背着 ~600 字节的 iovec
+        std::unique_ptr<ParkedRequest> parked;   // 非空：blocking 请求在等在途 SEND 完成，这期间不解析后面的请求
+        bool recv_armed = false;                 // 有一个 multishot recv 挂在内核里（持有一个引用）
+        bool recv_cancel = false;                // 已经发了取消（背压），等它最后一个 CQE
+        bool recv_nobufs = false;                // 在 loop.recv_nobufs 里等提供缓冲区
+#endif
+    };
+
+    // 侵入式引用：投递到线程池的任务持有它，保证 worker 用完之前 Conn 不会被回收复用
+    class ConnRef {
+    public:
+        explicit ConnRef(Conn* c = nullptr) : c_(c) { if (c_) c_->refs.fetch_add(1, std::memory_order_relaxed); }
+        ConnRef(const ConnRef& o) : ConnRef(o.c_) {}
+        ConnRef(ConnRef&& o) noexcept : c_(o.c_) { o.c_ = nullptr; }
+        ConnRef& operator=(ConnRef o) noexcept { std::swap(c_, o.c_); return *this; }
+        ~ConnRef() { if (c_) SimpleWebServer::unrefConn(c_); }
+        Conn* get() const { return c_; }
+        Conn* operator->() const { return c_; }
+    private:
+        Conn* c_;
+    };
 
+    // =====================================================================
+    // 事件循环（reactor）：每个 loop 独占一个 epoll fd、一个 SO_REUSEPORT 监听 Socket、
+    // 一个 Conn 池和一个定时器。内核按四元组把新连接分给不同的监听 socket，
+    // 所以 loop 之间没有共享状态，也就没有锁竞争（fd 下标表是全局的，但查找不加锁）。
+    //
+    // loop 数 == 1：保持原来的模型（loop 线程 accept，I/O 交给线程池）
+    // loop 数 > 1 ：handle_io 直接在所属 loop 线程里执行，连接不会跨线程
+    //
+    // 定时器只在 loop 线程上操作（accept / 事件分发 / timerfd 到期都在 loop 线程），
+    // worker 线程不碰时间轮，所以不需要加锁
+    // =====================================================================
+    struct EventLoop {
+        int id = 0;
+        int epoll_fd = -1;
+        int wakeup_fd = -1;                                     // eventfd：stop() 用来唤醒 epoll_wait
+        std::unique_ptr<Socket> listener;                       // 本 loop 的监听 socket（Shared 模式下只有 loop 0 持有）
+        int listen_fd = -1;                                     // 本 loop 监听的 fd（Shared 模式下是 loop 0 的）
+        int reserve_fd = -1;                                    // 预留 fd：EMFILE/ENFILE 时让出来 accept 一个再关掉
+        TimingWheel timer;                                      // 本 loop 的 keep-alive 时间轮（timerfd 驱动）
+        std::thread::id tid;                                    // 运行本 loop 的线程
+        Conn* free_conns = nullptr;                             // 回收的 Conn（侵入式空闲链表）
+        std::mutex free_mtx;                                    // 只在 accept/回收时加；Inline 模式下无竞争
+        uint32_t next_gen = 0;                                  // 本 loop 分配的下一个代数
+        std::thread thread;                                     // loop 0 跑在 start() 调用线程上
+        std::atomic<size_t> conn_count{0};                      // 本 loop 的连接数（worker 关连接时也会减）
+        std::atomic<bool> accept_paused{false};                 // 过载：监听 socket 已经从本 loop 摘掉
+#ifdef WEBSERVER_IO_URING
+        std::unique_ptr<IoUring> ring;                          // 非空表示这个 loop 走 io_uring 后端
+        int uring_pending = 0;                                  // 持有 Conn 引用的在途 recv/send 个数
+        int uring_accepts = 0;                                  // 挂着的 multishot accept 个数（取消后没回 CQE 前可能有两个）
+        std::mutex ready_mtx;                                   // worker 跑完 blocking 路由后把连接交还给 loop
+        std::vector<ConnRef> ready;
+        std::vector<ConnRef> recv_nobufs;                       // recv 因为提供缓冲区用光（-ENOBUFS）停了的连接，有缓冲区还回去再重挂
+        bool recycled_last = false;                             // 上一轮有没有缓冲区还给内核
+#endif
     };
 
-    std::unordered_map<int, std::shared_ptr<Conn>> m_conns; // [MOD] Conn 表：活跃连接目录
-    std::mutex m_conns_mtx;                                  // [MOD] 多线程访问保护
+    std::vector<std::unique_ptr<EventLoop>> m_loops;
+    std::unique_ptr<FdTable<Conn>> m_conns;                     // fd -> Conn，所有 loop 共用
 
     // ===================== 你原来的“阻塞式处理一个连接”接口（建议删除/不再使用） =====================
     // [MOD] 这些函数是“accept 后把 Socket* 交给 worker 然后 while 循环读写”的风格。
-    // 在 fd+Conn表 + EPOLLONESHOT 的事件驱动模型中，这些将被 handle_io/tryParseOneRequest/append_response 替代。
+    // 在 fd+Conn表 + EPOLLONESHOT 的事件驱动模型中，这些将被 handle_io/HttpParser/append_response 替代。
     // 你可以先保留声明以便逐步迁移，但新实现里不应该再调用它们。
     //
     // void handle_connection(Socket* client_socket);              // [MOD] 不再使用（事件驱动替代）
@@ -98,12 +424,27 @@ private:
     // bool isValidClientSocket(Socket* client_socket);            // [MOD] 不再使用
 
     // ===================== 初始化/事件循环相关（保留 + 小调整） =====================
-    bool initializeServerSocket();
-    bool initializeEpoll();
-    int epollWait(struct epoll_event* events,int timeout);
-    bool isServerSocketEvent(const struct epoll_event& event);
-    void processEvents(struct epoll_event* events, int nfds, SimpleThreadPool& threadPool);
-    void handleNewConnection(SimpleThreadPool& threadPool);
+    bool initializeServerSocket(EventLoop& loop);
+    bool initializeEpoll(EventLoop& loop);
+    void runLoop(EventLoop& loop);
+    int epollWait(EventLoop& loop, struct epoll_event* events, int timeout);
+    bool isServerSocketEvent(EventLoop& loop, const struct epoll_event& event);
+    void processEvents(EventLoop& loop, struct epoll_event* events, int nfds);
+    void handleNewConnection(EventLoop& loop);
+    bool registerConnection(EventLoop& loop, int fd);              // 新 fd -> Conn 表 + epoll + 时间轮
+    void shedConnection(EventLoop& loop);                          // fd 用光时拒掉队首连接
+
+    // ===================== 过载保护 =====================
+    bool overloaded(const EventLoop& loop, bool low_water) const;  // low_water：按 7/8 的恢复线判断
+    bool admitConnection(EventLoop& loop, int fd);                 // 超限时回 503 + 关掉 fd（必要时暂停 accept），返回 false
+    void rejectConnection(int fd);
+    void appendOverloadResponse(ChainBuffer& out) const;
+    void pauseAccept(EventLoop& loop);                             // 只在 loop 线程上调
+    void resumeAccept(EventLoop& loop);
+    void maybeResumeAccept(EventLoop& loop);
+    void wakePausedLoops();                                        // 连接关闭 / 任务跑完时调，任意线程
+    void trackConnection(EventLoop& loop, int delta);
+    void noteFirstByte(Conn* c);                                   // accept 到首字节的耗时
 
     // =====================================================================
     // [MOD] 修改：addToEpollAndSubmitTask / handleClientEvent 只用 fd，不再用 Socket*
@@ -112,42 +453,111 @@ private:
     // 1) epoll_event.data.ptr 指向 Socket* 容易悬空
     // 2) fd 作为稳定标识符，配合 Conn 表能安全拿到连接上下文
     // =====================================================================
-    void handleClientEvent(const struct epoll_event& event, SimpleThreadPool& threadPool); // [MOD] event.data.fd
+    void handleClientEvent(EventLoop& loop, const struct epoll_event& event); // [MOD] event.data.fd
 
     void cleanup();
 
+#ifdef WEBSERVER_IO_URING
+    // ===================== io_uring 后端（uring_webserver.cpp） =====================
+    // user_data = Conn* | 操作类型（Conn 至少 8 字节对齐，低 3 位空着）；监听/timerfd/eventfd 的指针部分是 0
+    enum UringOp : uint64_t { kOpAccept = 1, kOpTimer = 2, kOpWakeup = 3, kOpRecv = 4, kOpSend = 5, kOpShutdown = 6,
+                              kOpCancel = 7 };
+    static constexpr uint64_t kOpMask = 7;
+    static constexpr uint16_t kBufGroup = 0;
+    static constexpr unsigned URING_ENTRIES = 1024;
+    static constexpr unsigned URING_BUF_COUNT = 1024;   // 每个 loop 的提供缓冲区个数（2 的幂）
+    static constexpr unsigned URING_BUF_SIZE = 4096;
+    static constexpr size_t URING_FILE_CHUNK = 256 * 1024; // 文件段每次 pread 进 sendbuf 的大小
+
+    bool initializeUring(EventLoop& loop);
+    void runUringLoop(EventLoop& loop);
+    void handleCqe(EventLoop& loop, const struct io_uring_cqe& cqe);
+    void uringArmAccept(EventLoop& loop);
+    void uringCancelAccept(EventLoop& loop);
+    void uringArmPoll(EventLoop& loop, int fd, UringOp op);
+    void uringArmRecv(EventLoop& loop, Conn* c);
+    void uringRetryNobufs(EventLoop& loop);
+    bool uringRecvBlocked(const Conn* c) const;          // inbuf 到上限 / 暂时不解析：recv 该停
+    void uringPaceRecv(EventLoop& loop, Conn* c);         // 按 uringRecvBlocked 取消或重挂 recv
+    void uringOnAccept(EventLoop& loop, int res, uint32_t flags);
+    void uringOnRecv(EventLoop& loop, Conn* c, int res, uint32_t flags);
+    void uringOnSend(EventLoop& loop, Conn* c, int res);
+    void uringOnShutdown(EventLoop& loop, Conn* c);
+    void uringOnWakeup(EventLoop& loop);
+    void uringFlush(EventLoop& loop, Conn* c);
+    bool uringFillSendbuf(EventLoop& loop, Conn* c);
+    void uringDrain(EventLoop& loop);
+    void uringOffload(EventLoop& loop, Conn* c, HttpRequest&& req, const Route* route); // blocking 路由交给线程池
+    bool connAlive(Conn* c) const { return c->fd >= 0 && m_conns->get(c->fd) == c; }
+#endif
+
     // ===================== [MOD] Conn 表操作 =====================
-    std::shared_ptr<Conn> getConn(int fd);        // [MOD] fd -> Conn
-    void addConn(const std::shared_ptr<Conn>& c); // [MOD] 插入 Conn 表
-    void eraseConn(int fd);                       // [MOD] 从 Conn 表删除
+    // epoll_event.data.u64 = 代数 << 32 | fd；监听/timerfd/eventfd 的代数是 0
+    static uint64_t eventKey(int fd, uint32_t gen) { return (static_cast<uint64_t>(gen) << 32) | static_cast<uint32_t>(fd); }
+    static int keyFd(uint64_t key) { return static_cast<int>(key & 0xffffffffu); }
+    static uint32_t keyGen(uint64_t key) { return static_cast<uint32_t>(key >> 32); }
+
+    Conn* lookupConn(EventLoop& loop, uint64_t key);               // 无锁查找；过期事件返回 nullptr
+    Conn* acquireConn(EventLoop& loop);                            // 从池里取（池空才 new）
+    static void unrefConn(Conn* c);                                // 引用归零时回收到所属 loop 的池
+    static void recycleConn(Conn* c);
 
     // ===================== [MOD] EPOLLONESHOT：防止同 fd 并发处理 =====================
-    void rearm(int fd, uint32_t events);          // [MOD] worker 处理完后重新监听
-    void closeConnection(int fd);                 // [MOD] 统一关闭：DEL + close + erase
+    void rearm(EventLoop& loop, Conn* c, uint32_t events);         // [MOD] worker 处理完后重新监听
+    void closeConnection(EventLoop& loop, Conn* c);                // [MOD] 统一关闭：摘表 + DEL + close
 
     // ===================== [MOD] 线程池 worker 入口：处理一次事件（读/解析/写） =====================
-    void handle_io(int fd, uint32_t events);      // [MOD] 新的核心处理函数
+    void handle_io(EventLoop& loop, Conn* c, uint32_t events);     // [MOD] 新的核心处理函数
+    void onConnTimeout(EventLoop& loop, int fd);                   // 时间轮到期回调（loop 线程）
+    bool inlineDispatch() const;                                   // 当前是否 run-to-completion
+    template<typename F>
+    void postToPool(Conn* c, TaskLane lane, F&& fn);               // 带 ConnRef 保活 + 计数的投递
+    template<typename F, typename E>
+    void postToPool(Conn* c, TaskLane lane, int timeout_ms, F&& fn, E&& on_expired); // 排队超时改跑 on_expired
+    void finishPoolTask(ConnRef ref);                              // 任务跑完：放掉引用、减在途计数
+    void expireBlocking(Conn* c);                                  // blocking 请求排队超时：回 503 并准备关连接
 
-    // ===================== [MOD] 非阻塞读写：循环到 EAGAIN =====================
-    bool readToInbuf(const std::shared_ptr<Conn>& c);      // [MOD] 读到 inbuf
-    bool writeFromOutbuf(const std::shared_ptr<Conn>& c);  // [MOD] 写 outbuf
+    // 解析 inbuf 里的请求并生成响应，最后写 outbuf + rearm。
+    // offload = true 时遇到 blocking 路由会把剩余工作整体交给线程池的 Batch 通道，然后立即返回
+    // （reactor 上和 Interactive 通道的 worker 上都是 true；已经在 Batch 通道里接着处理 pipeline 时是 false）
+    void processRequests(EventLoop& loop, Conn* c, bool offload);
+    void respond(Conn* c, const HttpRequest& req, const Route* route, BodySink* sink = nullptr);
+    void respondPrebuilt(Conn* c, const HttpRequest& req, const Prebuilt& pre);
+    bool outputPaused(Conn* c);                                     // 高低水位判断（带滞回）
+    bool pumpProducer(Conn* c);                                     // 调 producer 到高水位；true 表示响应写完了
+    static size_t pendingOutputBytes(const Conn* c);
+    bool beginBody(Conn* c, HttpRequest& req, const Route* route); // 头到了 body 没到：true 表示切到逐段收
+    HttpParser::Result pumpBody(Conn* c);                           // 把 inbuf 里的 body 交给 sink / 攒进 buf
+    void flushAndRearm(EventLoop& loop, Conn* c);
 
-    // ===================== [MOD] HTTP 解析：从 Conn.inbuf 拆出完整请求 =====================
-    bool tryParseOneRequest(const std::shared_ptr<Conn>& c, HttpRequest& req); // [MOD]
+    // ===================== [MOD] 非阻塞读写：循环到 EAGAIN =====================
+    bool readToInbuf(Conn* c);      // [MOD] 读到 inbuf
+    bool writeFromOutbuf(Conn* c);  // [MOD] 写 outbuf（以及排在里面的文件段）
+    static bool hasPendingOutput(const Conn* c) { return c->outbuf.readableBytes() > 0 || !c->out_segs.empty(); }
+    static void queueSegment(Conn* c, OutSegment&& seg);
 
     // ===================== 业务构建响应（保留你原来的路由机制） =====================
-    void build_response(const HttpRequest& request, HttpResponse& response);
+    void build_response(const HttpRequest& request, const Route* route, HttpResponse& response, BodySink* sink = nullptr);
     std::string status_code_to_message(int code);
-    SimpleWebServer::HandlerFunc findRouteHandler(const HttpRequest& request);
+    const Route* findRouteHandler(HttpRequest& request) const; // 返回指针，不再拷贝 std::function；顺带填 request.params
     void buildNotFoundResponse(HttpResponse& response);
+    void serveFile(const std::string& prefix, const std::string& root, const HttpRequest& req, HttpResponse& res);
 
     // ===================== [MOD] 响应发送：append 到 outbuf，不直接 send =====================
-    void append_response(const std::shared_ptr<Conn>& c, const HttpResponse& response); // [MOD]
-    void sendBadRequest(const std::shared_ptr<Conn>& c);                                // [MOD]
+    // head_only：只写头（Content-Length 照常按 body/文件算）；大 body 会被移走
+    // chunked：流式响应用 chunked 编码（HTTP/1.0 客户端传 false，靠关连接结束）
+    void append_response(Conn* c, HttpResponse&& response, bool head_only = false, bool chunked = true); // [MOD]
+    void sendErrorResponse(Conn* c, int code);                   // [MOD] 解析失败：回 400/431/501 并关闭
+    static PrebuiltVariant buildPrebuilt(const std::string& content_type, const std::string& body,
+                                         const std::unordered_map<std::string, std::string>& headers);
+    void finishPrebuilts();                                      // start() 里调：生成各编码版本
+    void compressResponse(Conn* c, const HttpRequest& req, HttpResponse& res, bool head_only);
 
     // ===================== keep-alive 逻辑（仍然需要） =====================
     bool shouldKeepAlive(const HttpRequest& request);
     void setConnectionHeader(HttpResponse& response, bool keep_alive);
+
+    friend struct WebServerBench;                                // bench/webserver_bench.cpp：直接测 append_response 的组包开销
 };
 
 #endif // SIMPLE_WEBSERVER_HPP
\ No newline at end of file
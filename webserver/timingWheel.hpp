@@ -0,0 +1,218 @@
+#ifndef TIMINGWHEEL_HPP
+#define TIMINGWHEEL_HPP
+#include<vector>
+#include<algorithm>
+#include<functional>
+#include<cstdint>
+#include<unistd.h>
+#include<sys/timerfd.h>
+// ===================== 分层时间轮（hierarchical timing wheel） =====================
+// 替代 heapTimer 管理 keep-alive 超时：
+// 1) 节点按 id（连接 fd）放在数组里，双向链表用下标串起来：add/refresh/cancel 都是 O(1)，没有堆调整
+// 2) 整个时间轮只有一个到期回调，节点里不存 std::function，不会为每个定时器分配内存
+// 3) refresh 是懒惰的：只改到期 tick，不挪链表；槽位到期时发现还没到点就重新挂回去
+// 4) 由 timerfd 驱动：时间轮非空时按 tick 周期触发，空了就停掉，空闲时不占 CPU
+//
+// 层级：L0 256 个槽（每槽 1 tick），L1~L3 各 64 个槽（每槽 256/16384/1048576 tick）
+// tick=100ms 时 L0 覆盖 25.6s，L1 覆盖约 27 分钟，L2 约 29 小时，L3 约 77 天
+// 线程模型：只允许所属 loop 线程调用
+class TimingWheel{
+public:
+    typedef std::function<void(int)> expireCallback;//参数是到期的 id
+private:
+    static constexpr int kL0Bits=8;
+    static constexpr int kLnBits=6;
+    static constexpr int kLevels=4;
+    static constexpr uint32_t kL0Size=1u<<kL0Bits;
+    static constexpr uint32_t kLnSize=1u<<kLnBits;
+    static constexpr uint32_t kSlots=kL0Size+(kLevels-1)*kLnSize;
+    static constexpr int kNil=-1;
+
+    struct Node{
+        int prev=kNil;
+        int next=kNil;
+        int slot=kNil;          //所在槽位（kNil 表示没挂在轮上）
+        uint64_t expire=0;      //到期 tick（绝对值）
+    };
+    std::vector<Node> nodes_;   //下标就是 id
+    std::vector<int> heads_;    //每个槽位的链表头
+    std::vector<int> expired_;  //本 tick 到期的 id（复用，不每次分配）
+    uint64_t current_;          //当前 tick
+    int tickMs_;
+    int timerFd_;
+    size_t size_;               //挂着的节点数
+    bool armed_;
+    expireCallback cb_;
+
+    void ensure_(int id){
+        if(static_cast<size_t>(id)>=nodes_.size()){
+            nodes_.resize(std::max<size_t>(id+1,nodes_.size()*2));
+        }
+    }
+    //根据到期时间选层和槽
+    int slotFor_(uint64_t expire) const{
+        if(expire<current_)expire=current_;//已经过期的挂到当前槽，马上处理
+        uint64_t delta=expire-current_;
+        if(delta<kL0Size){
+            return static_cast<int>(expire&(kL0Size-1));
+        }
+        for(int level=1;level<kLevels;++level){
+            int shift=kL0Bits+level*kLnBits;
+            if(level==kLevels-1||delta<(uint64_t(1)<<shift)){
+                if(level==kLevels-1&&delta>=(uint64_t(1)<<shift)){
+                    expire=current_+(uint64_t(1)<<shift)-1;//超出最大范围就截断
+                }
+                int idx=static_cast<int>((expire>>(shift-kLnBits))&(kLnSize-1));
+                return static_cast<int>(kL0Size+(level-1)*kLnSize)+idx;
+            }
+        }
+        return 0;
+    }
+    void link_(int id){
+        Node& n=nodes_[id];
+        int s=slotFor_(n.expire);
+        n.slot=s;
+        n.prev=kNil;
+        n.next=heads_[s];
+        if(n.next!=kNil)nodes_[n.next].prev=id;
+        heads_[s]=id;
+    }
+    void unlink_(int id){
+        Node& n=nodes_[id];
+        if(n.prev!=kNil)nodes_[n.prev].next=n.next;
+        else heads_[n.slot]=n.next;
+        if(n.next!=kNil)nodes_[n.next].prev=n.prev;
+        n.prev=n.next=n.slot=kNil;
+    }
+    //把整个槽摘下来，返回链表头
+    int detach_(int s){
+        int head=heads_[s];
+        heads_[s]=kNil;
+        return head;
+    }
+    //高层槽位降级：重新按剩余时间挂到低层
+    void cascade_(int level){
+        int shift=kL0Bits+(level-1)*kLnBits;
+        int idx=static_cast<int>((current_>>shift)&(kLnSize-1));
+        int id=detach_(static_cast<int>(kL0Size+(level-1)*kLnSize)+idx);
+        while(id!=kNil){
+            int next=nodes_[id].next;
+            link_(id);
+            id=next;
+        }
+        if(idx==0&&level+1<kLevels)cascade_(level+1);
+    }
+    //走一个 tick
+    void step_(){
+        ++current_;
+        if((current_&(kL0Size-1))==0)cascade_(1);
+        //先把到期的节点全部摘下来再回调：回调里可能 add/cancel 任意 id，不能边遍历边回调
+        int id=detach_(static_cast<int>(current_&(kL0Size-1)));
+        while(id!=kNil){
+            Node& n=nodes_[id];
+            int next=n.next;
+            n.prev=n.next=n.slot=kNil;
+            if(n.expire>current_){
+                link_(id);//被 refresh 过，还没到期
+            }else{
+                --size_;
+                expired_.push_back(id);
+            }
+            id=next;
+        }
+        for(int e:expired_){
+            if(contains(e))continue;//前面的回调又把它加回来了
+            if(cb_)cb_(e);
+        }
+        expired_.clear();
+    }
+    void arm_(bool on){
+        if(timerFd_<0||armed_==on)return;
+        struct itimerspec its{};
+        if(on){
+            its.it_value.tv_sec=tickMs_/1000;
+            its.it_value.tv_nsec=(tickMs_%1000)*1000000L;
+            its.it_interval=its.it_value;
+        }
+        timerfd_settime(timerFd_,0,&its,nullptr);
+        armed_=on;
+    }
+    uint64_t ticksFor_(int timeoutMs) const{
+        //向上取整再 +1：当前 tick 已经走了一部分，保证不会提前到期
+        return static_cast<uint64_t>((timeoutMs+tickMs_-1)/tickMs_)+1;
+    }
+public:
+    explicit TimingWheel(int tickMs=100)
+        :heads_(kSlots,kNil),current_(0),tickMs_(tickMs>0?tickMs:1),size_(0),armed_(false){
+        timerFd_=timerfd_create(CLOCK_MONOTONIC,TFD_NONBLOCK|TFD_CLOEXEC);
+        nodes_.resize(64);
+    }
+    ~TimingWheel(){
+        if(timerFd_>=0)::close(timerFd_);
+    }
+    TimingWheel(const TimingWheel&)=delete;
+    TimingWheel& operator=(const TimingWheel&)=delete;
+
+    //注册到 epoll 的 fd
+    int timerFd() const{return timerFd_;}
+    void setCallback(const expireCallback& cb){cb_=cb;}
+    //预留 id 空间，避免运行中扩容
+    void reserve(size_t n){if(n>nodes_.size())nodes_.resize(n);}
+    size_t size() const{return size_;}
+    bool contains(int id) const{
+        return id>=0&&static_cast<size_t>(id)<nodes_.size()&&nodes_[id].slot!=kNil;
+    }
+
+    //添加（已存在则重置到期时间）
+    void add(int id,int timeoutMs){
+        if(id<0)return;
+        ensure_(id);
+        if(contains(id)){
+            unlink_(id);
+            --size_;
+        }
+        nodes_[id].expire=current_+ticksFor_(timeoutMs);
+        link_(id);
+        if(size_++==0)arm_(true);
+    }
+    //延长到期时间：只改 expire，不动链表
+    void refresh(int id,int timeoutMs){
+        if(!contains(id))return;
+        uint64_t expire=current_+ticksFor_(timeoutMs);
+        Node& n=nodes_[id];
+        if(expire>=n.expire){
+            n.expire=expire;
+        }else{
+            //缩短的情况不能懒惰处理，否则会晚到期
+            unlink_(id);
+            n.expire=expire;
+            link_(id);
+        }
+    }
+    //主动删除，不触发回调
+    void cancel(int id){
+        if(!contains(id))return;
+        unlink_(id);
+        if(--size_==0)arm_(false);
+    }
+    //timerfd 可读时调用：按触发次数推进
+    void handleRead(){
+        uint64_t expirations=0;
+        if(::read(timerFd_,&expirations,sizeof(expirations))!=sizeof(expirations))return;
+        advance(expirations);
+    }
+    //推进 n 个 tick（也可以不用 timerfd，手动驱动）
+    void advance(uint64_t n){
+        while(n-->0&&size_>0){
+            step_();
+        }
+        if(size_==0)arm_(false);
+    }
+    void clear(){
+        for(auto& h:heads_)h=kNil;
+        for(auto& n:nodes_)n=Node();
+        size_=0;
+        arm_(false);
+    }
+};
+#endif
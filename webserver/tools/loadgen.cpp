@@ -0,0 +1,715 @@
+// ===================== HTTP 负载生成器 =====================
+// 替代 thread_learning/ 里的 client_long.py / client_short.py：
+// Python 版一个连接一个线程，GIL 先饱和，服务器还没压满；而且只报平均延迟，看不到尾部。
+// 这里每个线程一个 epoll，非阻塞 socket，一个线程就能压几百个连接。
+//
+// 两种发送节奏：
+//   闭环（默认）：每个连接保持 pipeline 深度个请求在途，回来一个补一个。服务器越慢发得越少，
+//                 测的是“最大吞吐”，延迟只能说明在这个吞吐下的情况
+//   开环（-R）  ：按固定速率发（总速率平均分给各个连接，发送时刻错开），服务器慢了请求照样到点，
+//                 在客户端排队。延迟从“计划发送时刻”算起（coordinated omission 修正）：
+//                 服务器卡住 1 秒，这 1 秒里本该发出的请求都会记上它们真实等待的时间，
+//                 而不是像闭环那样只记一个慢样本。同时给出从实际发出时刻算的（未修正）作为对照
+// 两种连接方式：
+//   keep-alive（默认）：连接一直复用，断了（服务器 Connection: close / 出错）自动重连
+//   短连接（-s）       ：每个请求新建连接（Connection: close），延迟包括建连时间
+//
+// 延迟用 metrics::Histogram 记（对数-线性分桶，误差 < 1/16），max 单独记精确值。
+//
+// 用法：./loadgen [选项] http://127.0.0.1:8080/hello
+//   -c N       连接数（默认 50）
+//   -t N       线程数（默认 1，连接平均分给各线程）
+//   -d SEC     持续时间（默认 10 秒）
+//   -p N       每个连接的 pipeline 深度（默认 1；短连接模式固定为 1）
+//   -R RATE    开环：总请求速率 req/s（不给就是闭环）
+//   -s         短连接
+//   -m METHOD  请求方法（默认 GET）
+//   -b BODY    请求体（带 Content-Length）
+//   -H "K: V"  追加请求头，可以给多次
+//   -T SEC     单个请求超时（默认 5 秒），超时的连接关掉重连
+#include "Socket.hpp"
+#include "metrics.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <getopt.h>
+#include <netdb.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <time.h>
+
+static uint64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// ===================== 参数 =====================
+struct Options {
+    int connections = 50;
+    int threads = 1;
+    double duration = 10;
+    int pipeline = 1;
+    double rate = 0;            // 0：闭环
+    bool short_conn = false;
+    double timeout = 5;
+    std::string method = "GET";
+    std::string body;
+    std::vector<std::string> headers;
+    std::string url;
+    // 从 url 解析出来的
+    std::string ip;
+    int port = 80;
+    std::string host;           // Host 头
+    std::string path = "/";
+};
+
+// http://host[:port][/path]；host 按 IPv4 解析（Socket::connect 只认点分十进制）
+static bool parseUrl(Options& o) {
+    std::string_view u = o.url;
+    if (u.substr(0, 7) == "http://") u.remove_prefix(7);
+    size_t slash = u.find('/');
+    std::string_view authority = u.substr(0, slash);
+    if (slash != std::string_view::npos) o.path = std::string(u.substr(slash));
+    if (authority.empty()) return false;
+    o.host = std::string(authority);
+    std::string name(authority);
+    size_t colon = authority.rfind(':');
+    if (colon != std::string_view::npos) {
+        name = std::string(authority.substr(0, colon));
+        o.port = std::atoi(std::string(authority.substr(colon + 1)).c_str());
+        if (o.port <= 0 || o.port > 65535) return false;
+    }
+    struct addrinfo hints {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* res = nullptr;
+    if (getaddrinfo(name.c_str(), nullptr, &hints, &res) != 0 || !res) return false;
+    char buf[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &reinterpret_cast<struct sockaddr_in*>(res->ai_addr)->sin_addr, buf, sizeof(buf));
+    freeaddrinfo(res);
+    o.ip = buf;
+    return true;
+}
+
+static std::string buildRequest(const Options& o) {
+    std::string r = o.method + " " + o.path + " HTTP/1.1\r\nHost: " + o.host + "\r\n";
+    for (const auto& h : o.headers) r += h + "\r\n";
+    r += o.short_conn ? "Connection: close\r\n" : "Connection: keep-alive\r\n";
+    if (!o.body.empty() || o.method == "POST" || o.method == "PUT") {
+        r += "Content-Length: " + std::to_string(o.body.size()) + "\r\n";
+    }
+    return r + "\r\n" + o.body;
+}
+
+// ===================== 响应解析 =====================
+// 增量解析，body 不保存，只数字节：支持 Content-Length、chunked、以及两者都没有时读到 EOF
+class ResponseParser {
+public:
+    enum Result { kIncomplete, kComplete, kError };
+
+    void reset(bool head_request) {
+        state_ = kHead;
+        head_request_ = head_request;
+        status_ = 0;
+        close_ = false;
+        remaining_ = 0;
+    }
+    // 从 data 解析，consumed 返回吃掉的字节数；kComplete 时一个响应结束（后面可能是下一个响应）
+    Result feed(const char* data, size_t len, size_t& consumed) {
+        consumed = 0;
+        while (true) {
+            std::string_view in(data + consumed, len - consumed);
+            switch (state_) {
+            case kHead: {
+                size_t end = in.find("\r\n\r\n");
+                if (end == std::string_view::npos) return in.size() > kMaxHead ? kError : kIncomplete;
+                if (!parseHead(in.substr(0, end + 2))) return kError;
+                consumed += end + 4;
+                break;
+            }
+            case kBody: {
+                size_t n = std::min<size_t>(remaining_, in.size());
+                consumed += n;
+                remaining_ -= n;
+                if (remaining_ > 0) return kIncomplete;
+                state_ = kDone;
+                break;
+            }
+            case kChunkSize: {
+                size_t eol = in.find("\r\n");
+                if (eol == std::string_view::npos) return in.size() > 64 ? kError : kIncomplete;
+                size_t size = 0;
+                size_t i = 0;
+                for (; i < eol; ++i) {
+                    int d = hexDigit(in[i]);
+                    if (d < 0) break;
+                    size = size * 16 + static_cast<size_t>(d);
+                }
+                if (i == 0) return kError;
+                consumed += eol + 2;
+                if (size == 0) {
+                    state_ = kTrailer;
+                } else {
+                    remaining_ = size + 2; // 数据 + CRLF
+                    state_ = kChunkData;
+                }
+                break;
+            }
+            case kChunkData: {
+                size_t n = std::min<size_t>(remaining_, in.size());
+                consumed += n;
+                remaining_ -= n;
+                if (remaining_ > 0) return kIncomplete;
+                state_ = kChunkSize;
+                break;
+            }
+            case kTrailer: {
+                size_t eol = in.find("\r\n");
+                if (eol == std::string_view::npos) return kIncomplete;
+                consumed += eol + 2;
+                if (eol == 0) state_ = kDone;
+                break;
+            }
+            case kUntilClose:
+                consumed += in.size();
+                return kIncomplete; // 等 EOF
+            case kDone:
+                return kComplete;
+            }
+        }
+    }
+    bool untilClose() const { return state_ == kUntilClose; }
+    int status() const { return status_; }
+    bool close() const { return close_; }
+
+private:
+    enum State { kHead, kBody, kChunkSize, kChunkData, kTrailer, kUntilClose, kDone };
+    static constexpr size_t kMaxHead = 64 * 1024;
+
+    static int hexDigit(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+    static bool iequals(std::string_view a, std::string_view b) {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); ++i) {
+            if ((a[i] | 0x20) != (b[i] | 0x20)) return false;
+        }
+        return true;
+    }
+    static std::string_view trim(std::string_view s) {
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+        return s;
+    }
+
+    // head：状态行 + 头，每行以 CRLF 结尾（不含最后的空行）
+    bool parseHead(std::string_view head) {
+        size_t eol = head.find("\r\n");
+        std::string_view line = head.substr(0, eol);
+        if (line.size() < 12 || line.substr(0, 5) != "HTTP/") return false;
+        status_ = std::atoi(std::string(line.substr(9, 3)).c_str());
+        bool http10 = line.substr(5, 3) == "1.0";
+        close_ = http10;
+        long long length = -1;
+        bool chunked = false;
+        head.remove_prefix(eol + 2);
+        while (!head.empty()) {
+            eol = head.find("\r\n");
+            line = head.substr(0, eol);
+            head.remove_prefix(eol + 2);
+            size_t colon = line.find(':');
+            if (colon == std::string_view::npos) continue;
+            std::string_view key = line.substr(0, colon);
+            std::string_view value = trim(line.substr(colon + 1));
+            if (iequals(key, "Content-Length")) {
+                length = std::atoll(std::string(value).c_str());
+            } else if (iequals(key, "Transfer-Encoding")) {
+                chunked = value.find("chunked") != std::string_view::npos;
+            } else if (iequals(key, "Connection")) {
+                if (iequals(value, "close")) close_ = true;
+                if (iequals(value, "keep-alive")) close_ = false;
+            }
+        }
+        if (head_request_ || status_ == 204 || status_ == 304 || status_ / 100 == 1) {
+            state_ = kDone;
+        } else if (chunked) {
+            state_ = kChunkSize;
+        } else if (length >= 0) {
+            remaining_ = static_cast<size_t>(length);
+            state_ = kBody;
+        } else {
+            state_ = kUntilClose;
+            close_ = true;
+        }
+        return true;
+    }
+
+    State state_ = kHead;
+    bool head_request_ = false;
+    int status_ = 0;
+    bool close_ = false;
+    size_t remaining_ = 0;
+};
+
+// ===================== 统计 =====================
+struct Stats {
+    metrics::Histogram latency;      // 开环：从计划时刻算（修正后）；闭环：从发出时刻算
+    metrics::Histogram uncorrected;  // 从实际发出时刻算
+    uint64_t max_latency = 0;
+    uint64_t max_uncorrected = 0;
+    uint64_t completed = 0;
+    uint64_t status[6] = {};         // 按百位：1xx ~ 5xx，下标 0 是解析不出来的
+    uint64_t connect_errors = 0;
+    uint64_t read_errors = 0;        // 连接断开 / 响应格式错，在途请求各算一次
+    uint64_t timeouts = 0;
+    uint64_t connects = 0;
+    uint64_t bytes_in = 0;
+    uint64_t bytes_out = 0;
+    uint64_t unsent = 0;             // 开环：结束时还排在客户端、没发出去的请求（服务器跟不上计划速率）
+};
+
+// ===================== 每个线程一个 epoll =====================
+class Worker {
+public:
+    Worker(const Options& o, const std::string& request, int first_conn, int conn_count, uint64_t start, uint64_t end)
+        : opt_(o), request_(request), end_(end), head_(o.method == "HEAD") {
+        depth_ = o.short_conn ? 1 : std::max(1, o.pipeline);
+        timeout_ = static_cast<uint64_t>(o.timeout * 1e9);
+        conns_.resize(static_cast<size_t>(conn_count));
+        if (o.rate > 0) {
+            // 每个连接的间隔 = 连接数 / 总速率；各连接的第一次按全局编号错开，合起来是均匀的
+            double gap = 1e9 / o.rate;
+            interval_ = static_cast<uint64_t>(gap * o.connections);
+            for (int i = 0; i < conn_count; ++i) {
+                conns_[i].next_due = start + static_cast<uint64_t>(gap * (first_conn + i));
+            }
+        }
+    }
+
+    void run() {
+        epfd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epfd_ < 0) {
+            std::perror("epoll_create1");
+            return;
+        }
+        if (!opt_.short_conn) {
+            for (auto& c : conns_) startConnect(c, nowNs());
+        }
+        std::vector<epoll_event> events(256);
+        while (true) {
+            uint64_t now = nowNs();
+            if (now >= end_) break;
+            int wait_ms = static_cast<int>(std::min<uint64_t>((end_ - now) / 1000000 + 1, 10));
+            if (interval_ > 0) {
+                // 开环：睡到下一个计划时刻（毫秒精度，到点的一次性补发，时刻本身不丢）
+                uint64_t next = end_;
+                for (const auto& c : conns_) next = std::min(next, c.next_due);
+                wait_ms = next <= now ? 0 : static_cast<int>(std::min<uint64_t>((next - now) / 1000000, 10));
+            }
+            int n = epoll_wait(epfd_, events.data(), static_cast<int>(events.size()), wait_ms);
+            now = nowNs();
+            for (int i = 0; i < n; ++i) {
+                onEvent(conns_[events[i].data.u64], events[i].events, now);
+            }
+            for (auto& c : conns_) tick(c, now);
+        }
+        // 开环：到结束时还没发出去的，说明服务器跟不上；不算进延迟，单独报
+        for (auto& c : conns_) {
+            stats_.unsent += c.backlog.size();
+            if (c.sock) c.sock->close();
+        }
+        ::close(epfd_);
+    }
+
+    const Stats& stats() const { return stats_; }
+
+private:
+    struct Pending {
+        uint64_t intended;   // 计划发送时刻（闭环 = 发出时刻）
+        uint64_t sent;
+    };
+    struct Conn {
+        std::unique_ptr<Socket> sock;
+        bool connecting = false;
+        uint64_t connect_start = 0;
+        uint64_t retry_at = 0;             // 连不上时的退避
+        std::string in;
+        std::string out;
+        size_t out_off = 0;
+        std::deque<Pending> inflight;
+        std::deque<uint64_t> backlog;      // 开环：到点了但 pipeline 满了，还没发出去
+        uint64_t next_due = 0;
+        bool sent_on_conn = false;         // 短连接：这条连接上的请求已经写进 out
+        ResponseParser parser;
+    };
+
+    bool connected(const Conn& c) const { return c.sock && !c.connecting; }
+
+    void startConnect(Conn& c, uint64_t now) {
+        c.sock = std::make_unique<Socket>();
+        if (!c.sock->is_valid() || !c.sock->setNonBlocking()) {
+            c.sock.reset();
+            ++stats_.connect_errors;
+            c.retry_at = now + 10000000;
+            return;
+        }
+        int one = 1;
+        setsockopt(c.sock->getFd(), IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (!c.sock->connect(opt_.ip, opt_.port)) {
+            c.sock.reset();
+            ++stats_.connect_errors;
+            c.retry_at = now + 10000000;
+            return;
+        }
+        c.connecting = true;
+        c.connect_start = now;
+        c.parser.reset(head_);
+        epoll_event ev {};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+        ev.data.u64 = static_cast<uint64_t>(&c - conns_.data());
+        epoll_ctl(epfd_, EPOLL_CTL_ADD, c.sock->getFd(), &ev);
+        ++stats_.connects;
+    }
+
+    // 连接作废：在途请求都算失败（error 为空表示正常关闭，比如短连接读完了）
+    void closeConn(Conn& c, uint64_t* error) {
+        if (error) *error += c.inflight.size();
+        c.inflight.clear();
+        if (c.sock) {
+            epoll_ctl(epfd_, EPOLL_CTL_DEL, c.sock->getFd(), nullptr);
+            c.sock.reset();
+        }
+        c.connecting = false;
+        c.in.clear();
+        c.out.clear();
+        c.out_off = 0;
+    }
+
+    void onEvent(Conn& c, uint32_t events, uint64_t now) {
+        if (!c.sock) return;
+        if (c.connecting) {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            getsockopt(c.sock->getFd(), SOL_SOCKET, SO_ERROR, &err, &len);
+            if (err != 0 || (events & (EPOLLERR | EPOLLHUP))) {
+                ++stats_.connect_errors; // 短连接在途的那个请求随连接一起作废，不重复计数
+                closeConn(c, nullptr);
+                c.retry_at = now + 10000000;
+                return;
+            }
+            if (!(events & EPOLLOUT)) return;
+            c.connecting = false;
+        }
+        if (events & EPOLLIN) {
+            if (!readResponses(c, now)) return;
+        }
+        if (c.sock && c.out_off < c.out.size()) flush(c);
+        if (c.sock) fill(c, now);
+    }
+
+    // 读到 EAGAIN，拆出完整的响应；连接被关掉返回 false
+    bool readResponses(Conn& c, uint64_t now) {
+        char buf[65536];
+        while (true) {
+            ssize_t n = ::recv(c.sock->getFd(), buf, sizeof(buf), 0);
+            if (n > 0) {
+                stats_.bytes_in += static_cast<uint64_t>(n);
+                c.in.append(buf, static_cast<size_t>(n));
+                if (!parseResponses(c, now)) return false;
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+            if (n < 0 && errno == EINTR) continue;
+            // EOF：没有长度的响应读到这里才算完整
+            if (c.parser.untilClose() && !c.inflight.empty()) complete(c, now);
+            bool clean = c.inflight.empty();
+            closeConn(c, clean ? nullptr : &stats_.read_errors);
+            return false;
+        }
+    }
+
+    bool parseResponses(Conn& c, uint64_t now) {
+        size_t off = 0;
+        while (off < c.in.size()) {
+            size_t used = 0;
+            ResponseParser::Result r = c.parser.feed(c.in.data() + off, c.in.size() - off, used);
+            off += used;
+            if (r == ResponseParser::kIncomplete) break;
+            if (r == ResponseParser::kError || c.inflight.empty()) {
+                ++stats_.read_errors; // 对不上请求的响应 / 格式错：这个连接的状态已经不可信
+                closeConn(c, &stats_.read_errors);
+                return false;
+            }
+            bool close = c.parser.close() || opt_.short_conn;
+            complete(c, now);
+            if (close) {
+                closeConn(c, &stats_.read_errors); // 服务器要关：后面 pipeline 的请求作废
+                return false;
+            }
+        }
+        c.in.erase(0, off);
+        return true;
+    }
+
+    void complete(Conn& c, uint64_t now) {
+        Pending p = c.inflight.front();
+        c.inflight.pop_front();
+        uint64_t lat = now - p.intended;
+        uint64_t unc = now - p.sent;
+        stats_.latency.record(lat);
+        stats_.uncorrected.record(unc);
+        stats_.max_latency = std::max(stats_.max_latency, lat);
+        stats_.max_uncorrected = std::max(stats_.max_uncorrected, unc);
+        int cls = c.parser.status() / 100;
+        ++stats_.status[cls >= 1 && cls <= 5 ? cls : 0];
+        ++stats_.completed;
+        c.parser.reset(head_);
+    }
+
+    void flush(Conn& c) {
+        while (c.out_off < c.out.size()) {
+            ssize_t n = ::send(c.sock->getFd(), c.out.data() + c.out_off, c.out.size() - c.out_off, MSG_NOSIGNAL);
+            if (n > 0) {
+                c.out_off += static_cast<size_t>(n);
+                stats_.bytes_out += static_cast<uint64_t>(n);
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return; // 等 EPOLLOUT
+            if (n < 0 && errno == EINTR) continue;
+            closeConn(c, &stats_.read_errors);
+            return;
+        }
+        c.out.clear();
+        c.out_off = 0;
+    }
+
+    void send(Conn& c, uint64_t intended, uint64_t now) {
+        c.out.append(request_);
+        c.inflight.push_back({intended, now});
+    }
+
+    // 在途没满就补请求：闭环一直补满，开环只发已经到点的
+    void fill(Conn& c, uint64_t now) {
+        if (!connected(c)) return;
+        size_t before = c.inflight.size();
+        if (opt_.short_conn) {
+            // 短连接：请求在建连时就记上了（建连时间算在延迟里），连上以后才真正写出去
+            if (!c.inflight.empty() && !c.sent_on_conn) {
+                c.out.append(request_);
+                c.sent_on_conn = true;
+            }
+        } else if (interval_ == 0) {
+            while (c.inflight.size() < static_cast<size_t>(depth_)) send(c, now, now);
+        } else {
+            while (!c.backlog.empty() && c.inflight.size() < static_cast<size_t>(depth_)) {
+                send(c, c.backlog.front(), now);
+                c.backlog.pop_front();
+            }
+        }
+        if (c.inflight.size() != before || !c.out.empty()) flush(c);
+    }
+
+    void tick(Conn& c, uint64_t now) {
+        if (interval_ > 0) {
+            while (c.next_due <= now && c.next_due < end_) {
+                c.backlog.push_back(c.next_due);
+                c.next_due += interval_;
+            }
+        }
+        if (!c.inflight.empty() && now - c.inflight.front().sent > timeout_) {
+            ++stats_.timeouts;
+            closeConn(c, nullptr); // 同一连接上 pipeline 的其它请求一起作废，只记一次超时
+        }
+        if (!c.sock && now >= c.retry_at) {
+            if (opt_.short_conn) {
+                // 有活才建连：闭环马上下一个，开环要等到点
+                uint64_t intended = now;
+                if (interval_ > 0) {
+                    if (c.backlog.empty()) return;
+                    intended = c.backlog.front();
+                    c.backlog.pop_front();
+                }
+                startConnect(c, now);
+                if (c.sock) {
+                    c.inflight.push_back({intended, now});
+                    c.sent_on_conn = false;
+                }
+            } else {
+                startConnect(c, now);
+            }
+            return;
+        }
+        fill(c, now);
+    }
+
+    const Options& opt_;
+    const std::string& request_;
+    uint64_t end_;
+    bool head_;
+    int depth_ = 1;
+    uint64_t timeout_ = 0;
+    uint64_t interval_ = 0;   // 开环：每个连接两次请求的间隔（纳秒）；0 表示闭环
+    int epfd_ = -1;
+    std::vector<Conn> conns_;
+    Stats stats_;
+};
+
+// ===================== 输出 =====================
+static std::string fmtDuration(uint64_t ns) {
+    char buf[32];
+    if (ns < 1000) std::snprintf(buf, sizeof(buf), "%lluns", static_cast<unsigned long long>(ns));
+    else if (ns < 1000000) std::snprintf(buf, sizeof(buf), "%.2fus", static_cast<double>(ns) / 1e3);
+    else if (ns < 1000000000) std::snprintf(buf, sizeof(buf), "%.2fms", static_cast<double>(ns) / 1e6);
+    else std::snprintf(buf, sizeof(buf), "%.2fs", static_cast<double>(ns) / 1e9);
+    return buf;
+}
+
+static std::string fmtBytes(double b) {
+    char buf[32];
+    if (b < 1024) std::snprintf(buf, sizeof(buf), "%.0fB", b);
+    else if (b < 1024 * 1024) std::snprintf(buf, sizeof(buf), "%.2fKB", b / 1024);
+    else if (b < 1024.0 * 1024 * 1024) std::snprintf(buf, sizeof(buf), "%.2fMB", b / 1024 / 1024);
+    else std::snprintf(buf, sizeof(buf), "%.2fGB", b / 1024 / 1024 / 1024);
+    return buf;
+}
+
+// 一行分位数：桶取上界（误差 < 1/16），不超过精确的 max
+static void printLatency(const char* name, const std::vector<uint64_t>& buckets, uint64_t count, uint64_t sum,
+                         uint64_t max) {
+    auto q = [&](double p) { return fmtDuration(std::min(metrics::quantile(buckets.data(), count, p), max)); };
+    std::printf("  %-12s %10s %10s %10s %10s %10s %10s\n", name, fmtDuration(count ? sum / count : 0).c_str(),
+                q(0.50).c_str(), q(0.90).c_str(), q(0.99).c_str(), q(0.999).c_str(), fmtDuration(max).c_str());
+}
+
+static void usage(const char* prog) {
+    std::fprintf(stderr,
+                 "usage: %s [-c conns] [-t threads] [-d sec] [-p depth] [-R rate] [-s] [-m method] [-b body]\n"
+                 "          [-H \"Key: Value\"]... [-T timeout_sec] http://host[:port]/path\n",
+                 prog);
+}
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    int ch;
+    while ((ch = getopt(argc, argv, "c:t:d:p:R:sm:b:H:T:h")) != -1) {
+        switch (ch) {
+        case 'c': opt.connections = std::atoi(optarg); break;
+        case 't': opt.threads = std::atoi(optarg); break;
+        case 'd': opt.duration = std::atof(optarg); break;
+        case 'p': opt.pipeline = std::atoi(optarg); break;
+        case 'R': opt.rate = std::atof(optarg); break;
+        case 's': opt.short_conn = true; break;
+        case 'm': opt.method = optarg; break;
+        case 'b': opt.body = optarg; break;
+        case 'H': opt.headers.push_back(optarg); break;
+        case 'T': opt.timeout = std::atof(optarg); break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    opt.url = argv[optind];
+    if (!parseUrl(opt)) {
+        std::fprintf(stderr, "cannot resolve url: %s\n", opt.url.c_str());
+        return 1;
+    }
+    if (opt.connections < 1 || opt.threads < 1 || opt.duration <= 0 || opt.pipeline < 1 || opt.timeout <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    opt.threads = std::min(opt.threads, opt.connections);
+    signal(SIGPIPE, SIG_IGN);
+
+    const std::string request = buildRequest(opt);
+    std::printf("Running %.0fs test @ %s\n  %d threads, %d connections, %s, pipeline %d, %s\n", opt.duration,
+                opt.url.c_str(), opt.threads, opt.connections, opt.short_conn ? "short connections" : "keep-alive",
+                opt.short_conn ? 1 : opt.pipeline,
+                opt.rate > 0 ? ("open loop @ " + std::to_string(static_cast<long long>(opt.rate)) + " req/s").c_str()
+                             : "closed loop");
+
+    uint64_t start = nowNs();
+    uint64_t end = start + static_cast<uint64_t>(opt.duration * 1e9);
+    std::vector<std::unique_ptr<Worker>> workers;
+    int first = 0;
+    for (int i = 0; i < opt.threads; ++i) {
+        int n = opt.connections / opt.threads + (i < opt.connections % opt.threads ? 1 : 0);
+        workers.push_back(std::make_unique<Worker>(opt, request, first, n, start, end));
+        first += n;
+    }
+    std::vector<std::thread> threads;
+    for (auto& w : workers) threads.emplace_back([&w] { w->run(); });
+    for (auto& t : threads) t.join();
+    double elapsed = static_cast<double>(nowNs() - start) / 1e9;
+
+    // ===================== 汇总 =====================
+    Stats total;
+    std::vector<uint64_t> lat(metrics::Histogram::kBuckets, 0);
+    std::vector<uint64_t> unc(metrics::Histogram::kBuckets, 0);
+    uint64_t lat_sum = 0;
+    uint64_t unc_sum = 0;
+    for (const auto& w : workers) {
+        const Stats& s = w->stats();
+        lat_sum += s.latency.addTo(lat.data());
+        unc_sum += s.uncorrected.addTo(unc.data());
+        total.max_latency = std::max(total.max_latency, s.max_latency);
+        total.max_uncorrected = std::max(total.max_uncorrected, s.max_uncorrected);
+        total.completed += s.completed;
+        for (int i = 0; i < 6; ++i) total.status[i] += s.status[i];
+        total.connect_errors += s.connect_errors;
+        total.read_errors += s.read_errors;
+        total.timeouts += s.timeouts;
+        total.connects += s.connects;
+        total.bytes_in += s.bytes_in;
+        total.bytes_out += s.bytes_out;
+        total.unsent += s.unsent;
+    }
+
+    std::printf("  Latency      %10s %10s %10s %10s %10s %10s\n", "mean", "p50", "p90", "p99", "p99.9", "max");
+    if (opt.rate > 0) {
+        printLatency("corrected", lat, total.completed, lat_sum, total.max_latency);
+        printLatency("uncorrected", unc, total.completed, unc_sum, total.max_uncorrected);
+    } else {
+        printLatency("", lat, total.completed, lat_sum, total.max_latency);
+    }
+    std::printf("  %llu requests in %.2fs, %s read, %s written, %llu connects\n",
+                static_cast<unsigned long long>(total.completed), elapsed,
+                fmtBytes(static_cast<double>(total.bytes_in)).c_str(),
+                fmtBytes(static_cast<double>(total.bytes_out)).c_str(),
+                static_cast<unsigned long long>(total.connects));
+    uint64_t bad = total.status[0] + total.status[1] + total.status[3] + total.status[4] + total.status[5];
+    if (bad > 0) {
+        std::printf("  Non-2xx responses: 3xx %llu, 4xx %llu, 5xx %llu, other %llu\n",
+                    static_cast<unsigned long long>(total.status[3]), static_cast<unsigned long long>(total.status[4]),
+                    static_cast<unsigned long long>(total.status[5]),
+                    static_cast<unsigned long long>(total.status[0] + total.status[1]));
+    }
+    if (total.connect_errors + total.read_errors + total.timeouts > 0) {
+        std::printf("  Socket errors: connect %llu, read %llu, timeout %llu\n",
+                    static_cast<unsigned long long>(total.connect_errors),
+                    static_cast<unsigned long long>(total.read_errors),
+                    static_cast<unsigned long long>(total.timeouts));
+    }
+    std::printf("Requests/sec: %.2f\n", static_cast<double>(total.completed) / elapsed);
+    std::printf("Transfer/sec: %s\n", fmtBytes(static_cast<double>(total.bytes_in) / elapsed).c_str());
+    if (opt.rate > 0) {
+        std::printf("Target rate:  %.2f req/s, %llu requests never sent (client-side backlog at end)\n", opt.rate,
+                    static_cast<unsigned long long>(total.unsent));
+    }
+    return 0;
+}
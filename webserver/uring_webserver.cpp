@@ -0,0 +1,461 @@
+#include "thread_pool_webserver.hpp"
+#include "Socket.hpp"
+#include "ioUring.hpp"
+#include "logger.hpp"
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <sys/utsname.h>
+
+// =====================================================================
+// io_uring 后端：和 epoll 后端共用 Conn / 缓冲区 / 路由 / 时间轮，只换掉 I/O 驱动方式
+//
+// epoll：每个请求 epoll_wait + readv(到 EAGAIN) + send + epoll_ctl(MOD)，至少 4 次系统调用
+// io_uring：
+// 1) 监听 socket 挂一个 multishot accept，新连接直接以 CQE 的形式出来
+// 2) 每个连接挂一个 multishot recv，缓冲区由内核从提供缓冲区（PROVIDE_BUFFERS 交进去的一组）里挑，
+//    收完拷进 inbuf 立刻还回去。inbuf 攒到上限或者连接暂时不解析时取消 recv，消化完再重挂（uringPaceRecv），
+//    和 epoll 下 readToInbuf 读到上限就停一样，数据留在 socket 里，背压交给对端的发送窗口
+// 3) 响应用 SEND 提交；要关连接时后面链一个 SHUTDOWN，发完内核立即发 FIN
+// 4) 一轮循环只有一次 io_uring_enter：上一轮攒下的 SQE 全部提交，同时等下一批 CQE
+//
+// 生命周期：每个在途的 recv/send 持有一个 Conn 引用，最后一个 CQE（没有 F_MORE）回来才放掉，
+// 所以 CQE 里的 Conn* 不会指向已经被回收复用的对象
+// =====================================================================
+
+static uint64_t uringData(void* p, uint64_t op) { return reinterpret_cast<uint64_t>(p) | op; }
+
+// ===================== 初始化 =====================
+bool SimpleWebServer::initializeUring(EventLoop& loop) {
+    // multishot recv 要 6.0+；更老的内核建环能成功，但 recv 会直接 EINVAL，所以提前判断
+    struct utsname u;
+    int major = 0, minor = 0;
+    if (uname(&u) != 0 || std::sscanf(u.release, "%d.%d", &major, &minor) != 2 || major < 6) {
+        return false;
+    }
+
+    auto ring = std::make_unique<IoUring>();
+    if (!ring->init(URING_ENTRIES) || !ring->setupProvidedBufs(kBufGroup, URING_BUF_COUNT, URING_BUF_SIZE)) {
+        return false;
+    }
+    if (loop.timer.timerFd() == -1) return false;
+
+    loop.wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (loop.wakeup_fd == -1) {
+        Logger::getInstance().error("Error creating eventfd");
+        return false;
+    }
+
+    EventLoop* lp = &loop;
+    loop.timer.setCallback([this, lp](int fd) { onConnTimeout(*lp, fd); });
+    loop.ring = std::move(ring);
+
+    uringArmAccept(loop);
+    uringArmPoll(loop, loop.timer.timerFd(), kOpTimer);
+    uringArmPoll(loop, loop.wakeup_fd, kOpWakeup);
+
+    Logger::getInstance().debug("io_uring initialized successfully for loop " + std::to_string(loop.id));
+    return true;
+}
+
+void SimpleWebServer::uringArmAccept(EventLoop& loop) {
+    io_uring_sqe* sqe = loop.ring->getSqe();
+    if (!sqe) {
+        Logger::getInstance().error("io_uring SQ full, cannot arm accept");
+        return;
+    }
+    IoUring::prepAcceptMultishot(sqe, loop.listen_fd, uringData(nullptr, kOpAccept));
+    ++loop.uring_accepts;
+}
+
+// 过载暂停：取消挂着的 multishot accept，它会带着 -ECANCELED（没有 F_MORE）结束，暂停期间不再重挂
+void SimpleWebServer::uringCancelAccept(EventLoop& loop) {
+    io_uring_sqe* sqe = loop.ring->getSqe();
+    if (!sqe) {
+        Logger::getInstance().error("io_uring SQ full, cannot cancel accept");
+        return;
+    }
+    IoUring::prepCancel(sqe, uringData(nullptr, kOpAccept), uringData(nullptr, kOpCancel));
+}
+
+// timerfd / eventfd 用 multishot poll：可读时出一个 CQE，由对应的处理函数自己 read
+void SimpleWebServer::uringArmPoll(EventLoop& loop, int fd, UringOp op) {
+    io_uring_sqe* sqe = loop.ring->getSqe();
+    if (!sqe) {
+        Logger::getInstance().error("io_uring SQ full, cannot arm poll fd=" + std::to_string(fd));
+        return;
+    }
+    IoUring::prepPollMultishot(sqe, fd, POLLIN, uringData(nullptr, op));
+}
+
+void SimpleWebServer::uringArmRecv(EventLoop& loop, Conn* c) {
+    io_uring_sqe* sqe = loop.ring->getSqe();
+    if (!sqe) {
+        closeConnection(loop, c);
+        return;
+    }
+    IoUring::prepRecvMultishot(sqe, c->fd, kBufGroup, uringData(c, kOpRecv));
+    c->refs.fetch_add(1, std::memory_order_relaxed);
+    ++loop.uring_pending;
+    c->recv_armed = true;
+}
+
+// multishot recv 不停地往 inbuf 里追加，不加限制的话不读响应、只管 pipeline 的客户端能把 inbuf 撑到几百 MB。
+// 上限和 epoll 的 readToInbuf 一样（整块等 body 时放宽到整个请求）；输出积压暂停、blocking 请求等在途 SEND、
+// 请求在线程池里这几种状态下 processRequests 不会消化 inbuf，也要停
+bool SimpleWebServer::uringRecvBlocked(const Conn* c) const {
+    return c->inbuf.readableBytes() >= std::max(INBUF_HIGH_WATER, c->parser.bytesNeeded()) ||
+           c->write_paused || c->parked || c->offloaded;
+}
+
+// 该停而 recv 还挂着：取消它（之前已经在路上的几个 CQE 照样收进 inbuf）；不该停而没挂着：重挂。
+// 每个 recv CQE 之后和 processRequests 收尾（flushAndRearm）都调一次，重复调用没有副作用
+void SimpleWebServer::uringPaceRecv(EventLoop& loop, Conn* c) {
+    if (!connAlive(c) || c->recv_nobufs) return; // 等缓冲区的由 uringRetryNobufs 负责
+    bool blocked = uringRecvBlocked(c);
+    if (c->recv_armed) {
+        if (!blocked || c->recv_cancel) return;
+        io_uring_sqe* sqe = loop.ring->getSqe();
+        if (!sqe) return; // 下一个 CQE 再试
+        IoUring::prepCancel(sqe, uringData(c, kOpRecv), uringData(nullptr, kOpCancel));
+        c->recv_cancel = true;
+    } else if (!blocked) {
+        uringArmRecv(loop, c);
+    }
+}
+
+// 提供缓冲区有还回去的了：-ENOBUFS 停下的连接重新挂 recv（还没还之前重挂只会马上又 -ENOBUFS，白白空转）
+void SimpleWebServer::uringRetryNobufs(EventLoop& loop) {
+    std::vector<ConnRef> waiting;
+    waiting.swap(loop.recv_nobufs);
+    for (auto& ref : waiting) {
+        ref->recv_nobufs = false;
+        uringPaceRecv(loop, ref.get());
+    }
+}
+
+// ===================== 事件循环 =====================
+void SimpleWebServer::runUringLoop(EventLoop& loop) {
+    loop.tid = std::this_thread::get_id();
+    auto onCqe = [this, &loop](const io_uring_cqe& cqe) { handleCqe(loop, cqe); };
+
+    while (m_running) {
+        // 提交上一轮所有 SQE，同时等至少一个 CQE：整轮只有这一次系统调用
+        if (loop.ring->submitAndWait(1) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            Logger::getInstance().error(std::string("Error in io_uring_enter: ") + std::strerror(errno));
+            break;
+        }
+        loop.ring->forEachCqe(onCqe);
+        // 看两轮：上一轮还的缓冲区这一轮才提交，内核报 -ENOBUFS 时可能还没拿到
+        bool recycled = loop.ring->takeRecycled();
+        if ((recycled || loop.recycled_last) && !loop.recv_nobufs.empty()) uringRetryNobufs(loop);
+        loop.recycled_last = recycled;
+    }
+
+    uringDrain(loop);
+}
+
+// 停机：关掉本 loop 的连接，等在途 recv/send 都完成，把它们持有的 Conn 引用放掉
+void SimpleWebServer::uringDrain(EventLoop& loop) {
+    m_conns->forEach([this, &loop](int, Conn* c) {
+        if (c->loop == &loop) closeConnection(loop, c);
+    });
+    loop.recv_nobufs.clear();
+    auto onCqe = [this, &loop](const io_uring_cqe& cqe) { handleCqe(loop, cqe); };
+    while (loop.uring_pending > 0) {
+        if (loop.ring->submitAndWait(1) < 0 && errno != EINTR) break;
+        loop.ring->forEachCqe(onCqe);
+    }
+}
+
+void SimpleWebServer::handleCqe(EventLoop& loop, const io_uring_cqe& cqe) {
+    Conn* c = reinterpret_cast<Conn*>(cqe.user_data & ~kOpMask);
+    bool more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+
+    switch (cqe.user_data & kOpMask) {
+    case kOpAccept:
+        uringOnAccept(loop, cqe.res, cqe.flags);
+        break;
+    case kOpTimer:
+        loop.timer.handleRead();
+        maybeResumeAccept(loop);
+        if (!more && m_running) uringArmPoll(loop, loop.timer.timerFd(), kOpTimer);
+        break;
+    case kOpWakeup:
+        uringOnWakeup(loop);
+        if (!more && m_running) uringArmPoll(loop, loop.wakeup_fd, kOpWakeup);
+        break;
+    case kOpRecv:
+        uringOnRecv(loop, c, cqe.res, cqe.flags);
+        break;
+    case kOpSend:
+        uringOnSend(loop, c, cqe.res);
+        break;
+    case kOpShutdown:
+        uringOnShutdown(loop, c);
+        break;
+    default:
+        break; // IoUring 内部归还缓冲区
+    }
+}
+
+// ===================== accept =====================
+void SimpleWebServer::uringOnAccept(EventLoop& loop, int res, uint32_t flags) {
+    // 没有 F_MORE 说明内核结束了这个 multishot（出错、CQ 溢出或被过载暂停取消），没在暂停就重新挂一个
+    if (!(flags & IORING_CQE_F_MORE)) {
+        --loop.uring_accepts;
+        if (m_running && !loop.accept_paused.load(std::memory_order_relaxed) && loop.uring_accepts == 0) {
+            uringArmAccept(loop);
+        }
+    }
+    if (res < 0) {
+        if (res == -EMFILE || res == -ENFILE) {
+            shedConnection(loop);
+        } else if (res != -ECANCELED) {
+            Logger::getInstance().warning("Failed to accept new connection");
+        }
+        return;
+    }
+    int fd = res;
+    if (!m_running) { // 正在停机排空，不再接新连接
+        ::close(fd);
+        return;
+    }
+    // 暂停 accept 之前内核已经接进来、还在 CQ 里的连接也走这里：照样回 503
+    if (!admitConnection(loop, fd)) return;
+
+    Conn* conn = acquireConn(loop);
+    Socket::adoptInto(conn->sock, fd);
+    conn->fd = fd;
+    if (m_metrics) conn->accept_ticks = metrics::nowTicks();
+
+    if (!m_conns->set(fd, conn)) {
+        Logger::getInstance().error("fd exceeds connection table capacity fd=" + std::to_string(fd));
+        conn->sock->close();
+        unrefConn(conn);
+        return;
+    }
+    loop.timer.add(fd, TIMEOUT_MS);
+    trackConnection(loop, 1);
+    uringArmRecv(loop, conn);
+
+    Logger::getInstance().debug("New connection accepted fd=" + std::to_string(fd) +
+                                " loop=" + std::to_string(loop.id));
+}
+
+// ===================== recv =====================
+void SimpleWebServer::uringOnRecv(EventLoop& loop, Conn* c, int res, uint32_t flags) {
+    bool more = (flags & IORING_CQE_F_MORE) != 0;
+    bool alive = connAlive(c);
+    if (!more) { // 这个 recv 结束了（对端关闭 / 出错 / 被取消 / 缓冲区用光）
+        c->recv_armed = false;
+        c->recv_cancel = false;
+    }
+
+    if (res > 0 && (flags & IORING_CQE_F_BUFFER)) {
+        uint16_t bid = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+        if (alive) {
+            c->inbuf.append(loop.ring->bufAddr(bid), static_cast<size_t>(res));
+            // 读是内核异步做的，没有 read 阶段可计时，只记字节数和首字节
+            if (m_metrics) {
+                metrics::local().add(metrics::kBytesIn, static_cast<uint64_t>(res));
+                noteFirstByte(c);
+            }
+        }
+        loop.ring->recycleBuf(bid); // 拷完立刻还给内核，提供缓冲区不会被慢连接占住
+    }
+
+    if (alive) {
+        if (res > 0) {
+            loop.timer.refresh(c->fd, TIMEOUT_MS);
+            // blocking 路由还在线程池里：先攒着，worker 交还连接后再接着解析
+            if (!c->offloaded) processRequests(loop, c, true);
+            uringPaceRecv(loop, c); // 到上限 / 不解析了就取消；内核自己结束的 multishot 重挂
+        } else if (res == -ENOBUFS && !more) {
+            // 提供缓冲区暂时用光了，数据还在 socket 里：有缓冲区还回来再挂（uringRetryNobufs）
+            c->recv_nobufs = true;
+            loop.recv_nobufs.emplace_back(c);
+        } else if (res == -ECANCELED && !more) {
+            uringPaceRecv(loop, c); // 背压取消的：取消生效前要是已经不用停了，马上重挂
+        } else if (!more) {
+            closeConnection(loop, c); // 0：对端关闭；其它负值：出错
+        }
+    }
+
+    if (!more) {
+        --loop.uring_pending;
+        unrefConn(c);
+    }
+}
+
+// ===================== send =====================
+// 内核直接读 sendbuf 的块，所以发送期间只往 outbuf 里追加；
+// 前一个 SEND 完成、sendbuf 发空以后再从输出队列里取下一段，继续发积压的部分。
+// sendbuf 按块填 iovec，一个 SENDMSG 最多带 SEND_IOV 块，多出来的下一轮再发
+void SimpleWebServer::uringFlush(EventLoop& loop, Conn* c) {
+    if (!connAlive(c) || c->send_inflight || c->shut_linked || c->offloaded) return;
+
+    if (c->sendbuf.readableBytes() == 0 && !c->send_body && !uringFillSendbuf(loop, c)) {
+        c->send_vec.reset(); // 输出发空了：没有在途的 SEND，iovec 不用留着
+        if (connAlive(c) && c->want_close && !c->producer) closeConnection(loop, c);
+        return;
+    }
+
+    io_uring_sqe* sqe = loop.ring->getSqe();
+    if (!sqe) {
+        closeConnection(loop, c);
+        return;
+    }
+    // MSG_WAITALL：流 socket 上内核会自己把短写补完，不用回到用户态再提交
+    // 先填到栈上：单块（绝大多数响应）直接 SEND 块里的地址，多块才需要一份跟连接走的 iovec
+    struct iovec iov[SEND_IOV + 1];
+    int cnt = 0;
+    size_t head = c->sendbuf.gather(iov, SEND_IOV, c->sendbuf.readableBytes(), cnt);
+    bool all = head == c->sendbuf.readableBytes();
+    if (c->send_body && !all) c->send_body = false; // 头还没全带上：body 等 sendbuf 发空后重新挂
+    if (c->send_body) {
+        // 响应头在 sendbuf，大 body 留在段里：body 作为最后一块一起发，不拷贝
+        OutSegment& seg = c->out_segs.front();
+        iov[cnt].iov_base = &seg.body[seg.offset];
+        iov[cnt].iov_len = seg.remaining;
+        ++cnt;
+    }
+    if (cnt == 1) {
+        IoUring::prepSend(sqe, c->fd, iov[0].iov_base, iov[0].iov_len,
+                          MSG_NOSIGNAL | MSG_WAITALL, uringData(c, kOpSend));
+    } else {
+        if (!c->send_vec) c->send_vec = std::make_unique<SendVec>();
+        SendVec& v = *c->send_vec;
+        std::copy(iov, iov + cnt, v.iov);
+        v.msg = msghdr{};
+        v.msg.msg_iov = v.iov;
+        v.msg.msg_iovlen = static_cast<size_t>(cnt);
+        IoUring::prepSendmsg(sqe, c->fd, &v.msg, MSG_NOSIGNAL | MSG_WAITALL, uringData(c, kOpSend));
+    }
+    c->refs.fetch_add(1, std::memory_order_relaxed);
+    ++loop.uring_pending;
+    c->send_inflight = true;
+    if (m_metrics) c->send_ticks = metrics::nowTicks();
+
+    // 最后一个响应：SEND 后面链一个 SHUTDOWN(SHUT_WR)，发完立刻发 FIN；短写时链条断开，SHUTDOWN 被取消
+    bool last = all && c->outbuf.readableBytes() == 0 && c->out_segs.size() == (c->send_body ? 1u : 0u) &&
+                !c->producer;
+    if (c->want_close && last) {
+        sqe->flags |= IOSQE_IO_LINK;
+        io_uring_sqe* sh = loop.ring->getSqe();
+        if (sh) {
+            IoUring::prepShutdown(sh, c->fd, SHUT_WR, uringData(c, kOpShutdown));
+            c->refs.fetch_add(1, std::memory_order_relaxed);
+            ++loop.uring_pending;
+            c->shut_linked = true;
+        } else {
+            sqe->flags &= ~IOSQE_IO_LINK;
+        }
+    }
+}
+
+// 把输出队列的下一段放进 sendbuf；没有可发的（或者读文件出错、连接已关）返回 false
+// - 前面没有段：outbuf 整个和 sendbuf 交换，不拷贝
+// - 段之前的内存字节：整块从 outbuf 挪到 sendbuf，只有最后不满一块的部分要拷
+// - 内存段：不拷，置 send_body，由 SENDMSG 直接引用
+// - 文件段：这个内核 ABI 里没有 sendfile，按 URING_FILE_CHUNK 分块 preadv 进 sendbuf 的块，内存占用有上限
+bool SimpleWebServer::uringFillSendbuf(EventLoop& loop, Conn* c) {
+    if (c->out_segs.empty()) {
+        if (c->outbuf.readableBytes() == 0) return false;
+        swap(c->sendbuf, c->outbuf);
+        return true;
+    }
+    OutSegment& seg = c->out_segs.front();
+    if (seg.before > 0) {
+        c->outbuf.moveTo(c->sendbuf, seg.before);
+        seg.before = 0;
+    }
+    if (!seg.file) {
+        c->send_body = true;
+        return true;
+    }
+    constexpr int kFileIov = static_cast<int>(URING_FILE_CHUNK / ChainBuffer::kBlockSize) + 1; // 尾块可能已经写了一部分
+    struct iovec iov[kFileIov];
+    int cnt = 0;
+    c->sendbuf.prepare(iov, kFileIov, std::min(seg.remaining, URING_FILE_CHUNK), cnt);
+    ssize_t n = ::preadv(seg.file->fd, iov, cnt, seg.offset);
+    if (n <= 0) {
+        c->sendbuf.commit(0);
+        // 文件在发送途中被截断或读出错：Content-Length 已经发出去了，只能断开
+        Logger::getInstance().error("Read file error fd=" + std::to_string(c->fd));
+        closeConnection(loop, c);
+        return false;
+    }
+    c->sendbuf.commit(static_cast<size_t>(n));
+    seg.offset += n;
+    seg.remaining -= static_cast<size_t>(n);
+    if (seg.remaining == 0) c->out_segs.pop_front();
+    return true;
+}
+
+void SimpleWebServer::uringOnSend(EventLoop& loop, Conn* c, int res) {
+    c->send_inflight = false;
+    bool body = c->send_body;
+    c->send_body = false; // 没发完的 body 下一轮 uringFillSendbuf 重新挂上
+    if (connAlive(c)) {
+        if (res <= 0) {
+            closeConnection(loop, c);
+        } else {
+            size_t n = static_cast<size_t>(res);
+            if (m_metrics) {
+                // write 阶段 = SEND 从提交到完成（包括在 SQ 里等下一次 io_uring_enter 的时间）
+                metrics::ThreadMetrics& m = metrics::local();
+                m.record(metrics::kWrite, metrics::elapsedNs(c->send_ticks));
+                m.add(metrics::kBytesOut, n);
+            }
+            size_t head = std::min(n, c->sendbuf.readableBytes());
+            c->sendbuf.retrieve(head);
+            if (body) {
+                OutSegment& seg = c->out_segs.front();
+                seg.offset += n - head;
+                seg.remaining -= n - head;
+                if (seg.remaining == 0) c->out_segs.pop_front();
+            }
+            // 流式响应 / 水位暂停 / 有 blocking 请求在等这个 SEND：回到 processRequests 看是否降到低水位、
+            // 该接着生成输出或交给线程池；否则没发完接着发，发完了看 outbuf 有没有新积压 / 是否该关闭
+            if ((c->producer || c->write_paused || c->parked) && !c->offloaded) {
+                processRequests(loop, c, true);
+            } else {
+                uringFlush(loop, c);
+            }
+        }
+    }
+    --loop.uring_pending;
+    unrefConn(c);
+}
+
+// 链在最后一个 SEND 后面的 SHUTDOWN 完成（短写时是 -ECANCELED）：到这里才轮到 close
+void SimpleWebServer::uringOnShutdown(EventLoop& loop, Conn* c) {
+    c->shut_linked = false;
+    uringFlush(loop, c);
+    --loop.uring_pending;
+    unrefConn(c);
+}
+
+// ===================== eventfd：停机 + blocking 路由交还 =====================
+void SimpleWebServer::uringOnWakeup(EventLoop& loop) {
+    uint64_t one;
+    while (::read(loop.wakeup_fd, &one, sizeof(one)) > 0) {}
+
+    std::vector<ConnRef> batch;
+    {
+        std::lock_guard<std::mutex> lk(loop.ready_mtx);
+        batch.swap(loop.ready);
+    }
+    // worker 已经把响应写进 outbuf：解析剩下的 pipeline 请求，然后一起发出去
+    for (auto& ref : batch) {
+        Conn* c = ref.get();
+        c->offloaded = false;
+        if (connAlive(c)) processRequests(loop, c, true);
+    }
+    maybeResumeAccept(loop); // 过载暂停中：别的线程关了连接 / 跑完了任务
+}